@@ -144,6 +144,15 @@ void BasicDB::UpdateResourceShares(std::vector<ycsbc::utils::MultiTenantResource
   *out_ << "UPDATE_RESOURCE_SHARES " << std::endl;
 }
 
+void BasicDB::UpdateMemtableShares(const std::vector<ycsbc::utils::MemtableShare> &shares) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  *out_ << "UPDATE_MEMTABLE_SHARES";
+  for (const auto &share : shares) {
+    *out_ << ' ' << share.client_id << ':' << share.write_buffer_size_bytes << 'x' << share.max_write_buffer_number;
+  }
+  *out_ << std::endl;
+}
+
 std::vector<ycsbc::utils::MultiTenantResourceUsage> BasicDB::GetResourceUsage() {
   std::lock_guard<std::mutex> lock(mutex_);
   *out_ << "GET_RESOURCE_USAGE " << std::endl;
@@ -62,6 +62,8 @@ class BasicDB : public DB {
 
   void UpdateResourceShares(std::vector<ycsbc::utils::MultiTenantResourceShares> res_opts);
 
+  void UpdateMemtableShares(const std::vector<ycsbc::utils::MemtableShare> &shares);
+
   std::vector<ycsbc::utils::MultiTenantResourceUsage> GetResourceUsage();
   
   void PrintDbStats();
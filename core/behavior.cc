@@ -10,11 +10,14 @@
 #include <yaml-cpp/yaml.h>
 #include <functional>
 #include <cassert>
+#include <algorithm>
+#include <limits>
+#include <set>
 
 namespace ycsbc
 {
 
-    void enforceRequestRate(int interval_us)
+    void enforceRequestRate(int64_t interval_us)
     {
         auto start = std::chrono::high_resolution_clock::now();
         while (true)
@@ -61,7 +64,7 @@ namespace ycsbc
         std::this_thread::sleep_for(std::chrono::seconds(duration_s));
     }
 
-    void executeReplayBehavior(const std::string &trace_file, int client_id, double scale_ratio, const std::function<void()> &send_request)
+    std::vector<int64_t> loadReplayIntervalsUs(const std::string &trace_file, int client_id, double scale_ratio)
     {
         assert(scale_ratio > 0 && "Scale ratio must be greater than 0.");
 
@@ -97,6 +100,8 @@ namespace ycsbc
         }
 
         // Process intervals with scaling
+        std::vector<int64_t> intervals_us;
+        intervals_us.reserve(intervals.size());
         for (const auto &interval : intervals)
         {
             if (!interval.isNumeric())
@@ -105,15 +110,277 @@ namespace ycsbc
             }
             double scaled_interval_seconds = interval.asDouble() / scale_ratio;
             int scaled_interval_microseconds = static_cast<int>(scaled_interval_seconds * 1'000'000);
-            scaled_interval_microseconds = std::max(scaled_interval_microseconds, 0);
+            intervals_us.push_back(std::max(scaled_interval_microseconds, 0));
+        }
+        return intervals_us;
+    }
+
+    ClosedLoopGate::ClosedLoopGate(int concurrency, int64_t think_time_us, const RequestCounters *counters)
+        : concurrency_(concurrency), think_time_us_(think_time_us), counters_(counters),
+          seen_completed_(counters->completed.load(std::memory_order_acquire))
+    {
+        auto now = Clock::now();
+        for (int64_t i = counters_->Inflight(); i < concurrency_; ++i)
+        {
+            ready_at_.push_back(now);
+        }
+    }
+
+    int64_t ClosedLoopGate::Poll(Clock::time_point now)
+    {
+        // How long to wait when every slot is in flight. Short enough that a
+        // completion is noticed well within a typical service time.
+        const int64_t kPollIntervalUs = 20;
+
+        int64_t completed = counters_->completed.load(std::memory_order_acquire);
+        for (; seen_completed_ < completed; ++seen_completed_)
+        {
+            ready_at_.push_back(now + std::chrono::microseconds(think_time_us_));
+        }
 
+        if (counters_->Inflight() >= concurrency_)
+        {
+            return kPollIntervalUs;
+        }
+        if (ready_at_.empty())
+        {
+            // Slot freed by a request sent before this behavior began.
+            ready_at_.push_back(now);
+        }
+        if (ready_at_.front() <= now)
+        {
+            ready_at_.pop_front();
+            return 0;
+        }
+        return std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::microseconds>(ready_at_.front() - now).count());
+    }
+
+    void executeClosedBehavior(int concurrency, int64_t think_time_us, int duration_s, const RequestCounters *counters,
+                               const std::function<void()> &send_request)
+    {
+        if (counters == nullptr)
+        {
+            throw std::runtime_error("CLOSED behavior requires request counters.");
+        }
+        ClosedLoopGate gate(concurrency, think_time_us, counters);
+        auto end = ClosedLoopGate::Clock::now() + std::chrono::seconds(duration_s);
+        for (auto now = ClosedLoopGate::Clock::now(); now < end; now = ClosedLoopGate::Clock::now())
+        {
+            int64_t wait_us = gate.Poll(now);
+            if (wait_us == 0)
+            {
+                send_request();
+            }
+            else
+            {
+                enforceRequestRate(wait_us);
+            }
+        }
+    }
+
+    void executeReplayBehavior(const std::string &trace_file, int client_id, double scale_ratio, const std::function<void()> &send_request)
+    {
+        for (int64_t interval_us : loadReplayIntervalsUs(trace_file, client_id, scale_ratio))
+        {
             send_request();
-            enforceRequestRate(scaled_interval_microseconds);
+            enforceRequestRate(interval_us);
+        }
+    }
+
+    BehaviorCursor::BehaviorCursor(const std::vector<Behavior> *behaviors, const RequestCounters *counters)
+        : behaviors_(behaviors), counters_(counters), replay_intervals_us_(behaviors->size())
+    {
+        // Parse traces up front so a driver thread never stalls its other
+        // clients on file IO when a REPLAY phase begins.
+        for (size_t i = 0; i < behaviors_->size(); ++i)
+        {
+            const Behavior &behavior = (*behaviors_)[i];
+            if (behavior.type == REPLAY)
+            {
+                assert(!behavior.trace_file.empty() && "Replay behavior must have a valid trace file.");
+                replay_intervals_us_[i] = loadReplayIntervalsUs(behavior.trace_file, behavior.client_id, behavior.scale_ratio);
+            }
+            if (behavior.type == CLOSED && counters_ == nullptr)
+            {
+                throw std::runtime_error("CLOSED behavior requires request counters.");
+            }
         }
     }
 
-    // Function to execute client behaviors in sequence
-    void executeClientBehaviors(const std::vector<Behavior> &behaviors, const std::function<void()> &send_request)
+    void BehaviorCursor::EnterBehavior(const Behavior &behavior)
+    {
+        remaining_ops_ = 0;
+        repeats_left_ = 0;
+        idle_pending_ = false;
+        replay_pos_ = 0;
+        closed_gate_.reset();
+        switch (behavior.type)
+        {
+        case STEADY:
+            remaining_ops_ = static_cast<int64_t>(behavior.request_rate_qps) * behavior.duration_s;
+            break;
+        case BURSTY:
+            repeats_left_ = behavior.repeats;
+            break;
+        case INACTIVE:
+            idle_pending_ = true;
+            break;
+        case REPLAY:
+            break;
+        case CLOSED:
+            closed_gate_.emplace(behavior.concurrency, behavior.think_time_us, counters_);
+            closed_end_ = ClosedLoopGate::Clock::now() + std::chrono::seconds(behavior.duration_s);
+            break;
+        default:
+            throw std::runtime_error("Unknown behavior type.");
+        }
+    }
+
+    bool BehaviorCursor::Next(BehaviorStep &step)
+    {
+        while (behavior_idx_ < behaviors_->size())
+        {
+            const Behavior &behavior = (*behaviors_)[behavior_idx_];
+            if (!entered_)
+            {
+                EnterBehavior(behavior);
+                entered_ = true;
+            }
+
+            switch (behavior.type)
+            {
+            case STEADY:
+                if (remaining_ops_ > 0)
+                {
+                    --remaining_ops_;
+                    step = {true, 1'000'000 / behavior.request_rate_qps};
+                    return true;
+                }
+                break;
+            case BURSTY:
+                if (remaining_ops_ == 0 && !idle_pending_ && repeats_left_ > 0)
+                {
+                    --repeats_left_;
+                    remaining_ops_ = behavior.request_rate_qps * behavior.burst_duration_ms / 1000;
+                    idle_pending_ = true;
+                }
+                if (remaining_ops_ > 0)
+                {
+                    --remaining_ops_;
+                    step = {true, 1'000'000 / behavior.request_rate_qps};
+                    return true;
+                }
+                if (idle_pending_)
+                {
+                    idle_pending_ = false;
+                    step = {false, static_cast<int64_t>(behavior.idle_duration_ms) * 1000};
+                    return true;
+                }
+                break;
+            case INACTIVE:
+                if (idle_pending_)
+                {
+                    idle_pending_ = false;
+                    step = {false, static_cast<int64_t>(behavior.duration_s) * 1'000'000};
+                    return true;
+                }
+                break;
+            case REPLAY:
+            {
+                const std::vector<int64_t> &intervals_us = replay_intervals_us_[behavior_idx_];
+                if (replay_pos_ < intervals_us.size())
+                {
+                    step = {true, intervals_us[replay_pos_++]};
+                    return true;
+                }
+                break;
+            }
+            case CLOSED:
+            {
+                auto now = ClosedLoopGate::Clock::now();
+                if (now < closed_end_)
+                {
+                    int64_t wait_us = closed_gate_->Poll(now);
+                    step = {wait_us == 0, wait_us};
+                    return true;
+                }
+                break;
+            }
+            default:
+                throw std::runtime_error("Unknown behavior type.");
+            }
+
+            ++behavior_idx_;
+            entered_ = false;
+        }
+        return false;
+    }
+
+    // Lays the behaviors end to end as offered-rate segments; CLOSED
+    // segments have rate -1 since their rate is set by the think time.
+    std::vector<RateSegment> buildRateTimeline(const std::vector<Behavior> &behaviors, int64_t replay_bucket_ms)
+    {
+        std::vector<RateSegment> timeline;
+        int64_t t_ms = 0;
+        for (const auto &behavior : behaviors)
+        {
+            switch (behavior.type)
+            {
+            case STEADY:
+                timeline.push_back({t_ms, t_ms + behavior.duration_s * 1000, double(behavior.request_rate_qps)});
+                t_ms += behavior.duration_s * 1000;
+                break;
+            case BURSTY:
+                for (int r = 0; r < behavior.repeats; ++r)
+                {
+                    timeline.push_back({t_ms, t_ms + behavior.burst_duration_ms, double(behavior.request_rate_qps)});
+                    t_ms += behavior.burst_duration_ms;
+                    timeline.push_back({t_ms, t_ms + behavior.idle_duration_ms, 0.0});
+                    t_ms += behavior.idle_duration_ms;
+                }
+                break;
+            case INACTIVE:
+                timeline.push_back({t_ms, t_ms + behavior.duration_s * 1000, 0.0});
+                t_ms += behavior.duration_s * 1000;
+                break;
+            case REPLAY:
+            {
+                int64_t bucket_start_us = 0;
+                int64_t elapsed_us = 0;
+                int64_t count = 0;
+                for (int64_t interval_us : loadReplayIntervalsUs(behavior.trace_file, behavior.client_id, behavior.scale_ratio))
+                {
+                    elapsed_us += interval_us;
+                    while (elapsed_us - bucket_start_us >= replay_bucket_ms * 1000)
+                    {
+                        timeline.push_back({t_ms, t_ms + replay_bucket_ms, count * 1000.0 / replay_bucket_ms});
+                        t_ms += replay_bucket_ms;
+                        bucket_start_us += replay_bucket_ms * 1000;
+                        count = 0;
+                    }
+                    ++count;
+                }
+                int64_t tail_ms = (elapsed_us - bucket_start_us) / 1000;
+                if (count > 0 && tail_ms > 0)
+                {
+                    timeline.push_back({t_ms, t_ms + tail_ms, count * 1000.0 / tail_ms});
+                    t_ms += tail_ms;
+                }
+                break;
+            }
+            case CLOSED:
+                timeline.push_back({t_ms, t_ms + behavior.duration_s * 1000, -1.0});
+                t_ms += behavior.duration_s * 1000;
+                break;
+            default:
+                throw std::runtime_error("Unknown behavior type.");
+            }
+        }
+        return timeline;
+    }
+
+    void executeClientBehaviors(const std::vector<Behavior> &behaviors, const std::function<void()> &send_request,
+                                const RequestCounters *counters)
     {
         for (const auto &behavior : behaviors)
         {
@@ -132,6 +399,9 @@ namespace ycsbc
                 assert(!behavior.trace_file.empty() && "Replay behavior must have a valid trace file.");
                 executeReplayBehavior(behavior.trace_file, behavior.client_id, behavior.scale_ratio, send_request);
                 break;
+            case CLOSED:
+                executeClosedBehavior(behavior.concurrency, behavior.think_time_us, behavior.duration_s, counters, send_request);
+                break;
             default:
                 throw std::runtime_error("Unknown behavior type.");
             }
@@ -148,9 +418,44 @@ namespace ycsbc
             return INACTIVE;
         if (type_str == "REPLAY")
             return REPLAY;
+        if (type_str == "CLOSED")
+            return CLOSED;
         throw std::invalid_argument("Unknown behavior type: " + type_str);
     }
 
+    // Options a client's `lsm:` block may set; see examples/sample.yaml.
+    static const std::set<std::string> kLsmOptions = {
+        "compaction_style",
+        "num_levels",
+        "level0_file_num_compaction_trigger",
+        "level0_slowdown_writes_trigger",
+        "level0_stop_writes_trigger",
+        "target_file_size_base",
+        "target_file_size_multiplier",
+        "max_bytes_for_level_base",
+        "max_bytes_for_level_multiplier",
+        "level_compaction_dynamic_level_bytes",
+        "universal_size_ratio",
+        "universal_max_size_amplification_percent",
+        "fifo_max_table_files_size",
+        "compression",
+        "compression_per_level",
+        "bottommost_compression",
+        "bloom_bits",
+        "block_size",
+        "optimize_filters_for_hits",
+        "enable_blob_files",
+        "min_blob_size",
+        "blob_file_size",
+        "blob_compression",
+        "enable_blob_garbage_collection",
+        "blob_garbage_collection_age_cutoff",
+        "prefix_extractor",
+        "memtable_prefix_bloom_size_ratio",
+        "whole_key_filtering",
+        "index_type",
+    };
+
     std::vector<ClientConfig> loadClientBehaviors(const std::string &yaml_file)
     {
         YAML::Node config = YAML::LoadFile(yaml_file); // Load the YAML configuration file.
@@ -261,17 +566,129 @@ namespace ycsbc
                     behavior.client_id = behavior_node["replay_client_id"].as<int>();
                     behavior.scale_ratio = behavior_node["scale_ratio"].as<double>();
                     break;
+                case CLOSED:
+                    behavior.concurrency = behavior_node["concurrency"].as<int>();
+                    behavior.think_time_us = behavior_node["think_time_us"] ? behavior_node["think_time_us"].as<int64_t>() : 0;
+                    behavior.duration_s = behavior_node["duration_s"].as<int>();
+                    if (behavior.concurrency <= 0)
+                    {
+                        throw std::runtime_error("CLOSED behavior concurrency must be greater than 0.");
+                    }
+                    if (behavior.think_time_us < 0)
+                    {
+                        throw std::runtime_error("CLOSED behavior think_time_us must not be negative.");
+                    }
+                    break;
                 default:
                     throw std::runtime_error("Unknown behavior type in YAML configuration.");
                 }
                 client.behaviors.emplace_back(behavior);
             }
+            // Parse optional worker queue bound
+            if (client_node["queue"])
+            {
+                const auto &queue_node = client_node["queue"];
+                client.queue.capacity = queue_node["capacity"] ? queue_node["capacity"].as<int64_t>() : 0;
+                std::string policy = queue_node["policy"] ? queue_node["policy"].as<std::string>() : "block";
+                if (policy == "block")
+                {
+                    client.queue.policy = QUEUE_BLOCK;
+                }
+                else if (policy == "drop")
+                {
+                    client.queue.policy = QUEUE_DROP;
+                }
+                else if (policy == "deadline")
+                {
+                    client.queue.policy = QUEUE_DEADLINE;
+                    if (!queue_node["slo_us"])
+                    {
+                        throw std::runtime_error("deadline queue policy requires slo_us.");
+                    }
+                    client.queue.slo_us = queue_node["slo_us"].as<int64_t>();
+                }
+                else
+                {
+                    throw std::runtime_error("Unknown queue policy: " + policy);
+                }
+                client.queue.coalesce_reads = queue_node["coalesce_reads"] ? queue_node["coalesce_reads"].as<int64_t>() : 0;
+                client.queue.coalesce_writes = queue_node["coalesce_writes"] ? queue_node["coalesce_writes"].as<int64_t>() : 0;
+                client.queue.coalesce_wait_us = queue_node["coalesce_wait_us"] ? queue_node["coalesce_wait_us"].as<int64_t>() : 0;
+                if (client.queue.coalesce_reads < 0 || client.queue.coalesce_writes < 0 || client.queue.coalesce_wait_us < 0)
+                {
+                    throw std::runtime_error("coalesce_reads, coalesce_writes and coalesce_wait_us must be non-negative.");
+                }
+                if (client.queue.coalesce_reads > 1)
+                {
+                    client.read_coalescer_ = std::make_unique<RequestCoalescer>(client.queue.coalesce_reads,
+                                                                                client.queue.coalesce_wait_us);
+                }
+                if (client.queue.coalesce_writes > 1)
+                {
+                    client.write_coalescer_ = std::make_unique<RequestCoalescer>(client.queue.coalesce_writes,
+                                                                                 client.queue.coalesce_wait_us);
+                }
+            }
+            // Parse optional DRF weight and reservations
+            if (client_node["weight"])
+            {
+                client.weight = client_node["weight"].as<double>();
+                if (client.weight <= 0)
+                {
+                    throw std::runtime_error("Client weight must be greater than 0.");
+                }
+            }
+            if (client_node["reservations"])
+            {
+                const auto &res_node = client_node["reservations"];
+                auto read = [&res_node](const char *key)
+                { return res_node[key] ? res_node[key].as<int64_t>() : 0; };
+                client.reservation.io_read_kbps = read("io_read_kbps");
+                client.reservation.io_write_kbps = read("io_write_kbps");
+                client.reservation.memtable_write_kbps = read("memtable_write_kbps");
+                client.reservation.cache_kb = read("cache_kb");
+                client.reservation.cpu_us = read("cpu_us");
+            }
+            // Parse optional per-CF LSM options. Lists (compression_per_level)
+            // are passed on comma-separated; the DB binding interprets values.
+            if (client_node["lsm"])
+            {
+                for (auto it = client_node["lsm"].begin(); it != client_node["lsm"].end(); ++it)
+                {
+                    std::string option = it->first.as<std::string>();
+                    if (kLsmOptions.find(option) == kLsmOptions.end())
+                    {
+                        throw std::runtime_error("Unknown lsm option for client_id " + std::to_string(client_id) + ": " + option);
+                    }
+                    std::string value;
+                    if (it->second.IsSequence())
+                    {
+                        for (const auto &item : it->second)
+                        {
+                            value += (value.empty() ? "" : ",") + item.as<std::string>();
+                        }
+                    }
+                    else
+                    {
+                        value = it->second.as<std::string>();
+                    }
+                    client.lsm[option] = value;
+                }
+            }
             // Parse optional fields
             int insert_start = client_node["insert_start"] ? client_node["insert_start"].as<int>() : 0;
             client.insert_start_ = insert_start;
             client.request_distribution = client_node["request_distribution"]
                                                    ? client_node["request_distribution"].as<std::string>()
                                                    : "uniform";
+            if (client_node["scan_prefix_length"])
+            {
+                client.scan_prefix_length = client_node["scan_prefix_length"].as<int>();
+                if (client.scan_prefix_length < 0)
+                {
+                    throw std::runtime_error("scan_prefix_length must be non-negative.");
+                }
+            }
             if (client_node["zipfian_const"])
             {
                 client.zipfian_const = client_node["zipfian_const"].as<double>();
@@ -373,6 +790,17 @@ namespace ycsbc
             case REPLAY:
                 total_operations += calculateReplayOperations(behavior.trace_file, behavior.client_id, behavior.scale_ratio);
                 break;
+            case CLOSED:
+            {
+                // Throughput depends on the DB; estimate assuming ~100us of
+                // service time per request. The product overflows int for
+                // long, highly concurrent phases, so clamp it.
+                int64_t closed_ops = static_cast<int64_t>(behavior.concurrency) * behavior.duration_s *
+                                     (1'000'000 / (behavior.think_time_us + 100));
+                total_operations = static_cast<int>(std::clamp<int64_t>(
+                    static_cast<int64_t>(total_operations) + closed_ops, 0, std::numeric_limits<int>::max()));
+                break;
+            }
             }
         }
 
@@ -401,6 +829,8 @@ namespace ycsbc
             {"INSERT_BATCH_FAILED", INSERT_BATCH_FAILED},
             {"READ_BATCH_FAILED", READ_BATCH_FAILED},
             {"READ_MODIFY_INSERT_BATCH_FAILED", READ_MODIFY_INSERT_BATCH_FAILED},
+            {"REJECTED", REJECTED},
+            {"SHED", SHED},
             {"MAXOPTYPE", MAXOPTYPE}};
 
         auto it = operationMap.find(operationName);
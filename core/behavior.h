@@ -8,6 +8,8 @@
 #include "skewed_latest_generator.h"
 #include "discrete_generator.h"
 #include "acknowledged_counter_generator.h"
+#include "request_coalescer.h"
+#include "tenant.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -19,6 +21,9 @@
 #include <yaml-cpp/yaml.h>
 #include <functional>
 #include <optional>
+#include <atomic>
+#include <deque>
+#include <map>
 
 namespace ycsbc
 {
@@ -45,6 +50,8 @@ namespace ycsbc
         INSERT_BATCH_FAILED,
         READ_BATCH_FAILED,
         READ_MODIFY_INSERT_BATCH_FAILED,
+        REJECTED, // Refused at enqueue: tenant queue full
+        SHED,     // Dropped at dequeue: queued longer than the tenant SLO
         MAXOPTYPE
     };
 
@@ -55,19 +62,86 @@ namespace ycsbc
         BURSTY,
         INACTIVE,
         REPLAY,
+        CLOSED,
     };
 
     struct Behavior
     {
         BehaviorType type;
         int request_rate_qps;         // For STEADY and BURSTY
-        int duration_s;             // For STEADY and INACTIVE
+        int duration_s;             // For STEADY, INACTIVE and CLOSED
         int burst_duration_ms;       // For BURSTY
         int idle_duration_ms;        // For BURSTY
         int repeats;              // For BURSTY
         std::string trace_file;   // For REPLAY
         int client_id = -1;       // Client ID in the trace file (default: -1)
         double scale_ratio = 1.0; // Scale ratio for intervals (default: 1.0)
+        int concurrency = 1;      // For CLOSED: max requests in flight
+        int64_t think_time_us = 0; // For CLOSED: delay between a completion and the next send
+    };
+
+    // Per-client dispatch/completion counts, shared between the thread that
+    // sends requests and the workers that complete them.
+    struct RequestCounters
+    {
+        std::atomic<int64_t> dispatched{0};
+        std::atomic<int64_t> completed{0};
+
+        int64_t Inflight() const
+        {
+            return dispatched.load(std::memory_order_relaxed) - completed.load(std::memory_order_acquire);
+        }
+    };
+
+    // Admission for a CLOSED behavior: at most `concurrency` requests in
+    // flight, and each freed slot becomes usable `think_time_us` after the
+    // completion that freed it.
+    class ClosedLoopGate
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        ClosedLoopGate(int concurrency, int64_t think_time_us, const RequestCounters *counters);
+
+        // Returns 0 if a request may be sent now (and claims the slot),
+        // otherwise how long to wait before asking again.
+        int64_t Poll(Clock::time_point now);
+
+    private:
+        int concurrency_;
+        int64_t think_time_us_;
+        const RequestCounters *counters_;
+        int64_t seen_completed_;
+        std::deque<Clock::time_point> ready_at_;
+    };
+
+    // What happens to a client's requests when its worker queue is full.
+    enum QueuePolicy
+    {
+        QUEUE_BLOCK,    // Generator waits for space
+        QUEUE_DROP,     // Request is rejected
+        QUEUE_DEADLINE, // Rejected when full; queued requests older than slo_us are shed
+    };
+
+    struct QueueConfig
+    {
+        int64_t capacity = 0; // Max pending requests, 0 = unbounded
+        QueuePolicy policy = QUEUE_BLOCK;
+        int64_t slo_us = 0;   // For QUEUE_DEADLINE
+        int64_t coalesce_reads = 0;    // Max queued point reads merged into one MultiGet, 0 = off
+        int64_t coalesce_writes = 0;   // Max queued UPDATE/RANDOM_INSERTs merged into one WriteBatch, 0 = off
+        int64_t coalesce_wait_us = 0;  // How long a batch waits for more requests
+    };
+
+    // Per-tenant guaranteed amounts for the DRF resource scheduler, in the
+    // scheduler's units. 0 = no reservation.
+    struct ResourceReservation
+    {
+        int64_t io_read_kbps = 0;
+        int64_t io_write_kbps = 0;
+        int64_t memtable_write_kbps = 0;
+        int64_t cache_kb = 0;
+        int64_t cpu_us = 0; // worker CPU microseconds per second
     };
 
     struct ClientConfig
@@ -83,18 +157,80 @@ namespace ycsbc
         int insert_start_ = 0;                                                          // Starting key for inserts (default 0)
         std::string request_distribution = "uniform";                                   // Request distribution (default: uniform)
         std::optional<double> zipfian_const;                                            // Optional Zipfian constant for zipfian distribution
+        std::unique_ptr<RequestCounters> request_counters_;                             // In-flight tracking for CLOSED behaviors
+        QueueConfig queue;                                                              // Worker queue bound and overload policy
+        double weight = 1.0;                                                            // DRF weight
+        ResourceReservation reservation;                                                // DRF reservations
+        TenantHandle tenant;                                                            // Resolved from cf once the DB is up
+        std::unique_ptr<RequestCoalescer> read_coalescer_;                              // Set when queue.coalesce_reads > 1
+        std::unique_ptr<RequestCoalescer> write_coalescer_;                             // Set when queue.coalesce_writes > 1
+        std::map<std::string, std::string> lsm;                                         // Per-CF LSM options from the `lsm:` block, by option name
+        int scan_prefix_length = 0;                                                     // SCANs stay within this many leading key bytes, 0 = unbounded
 
         ClientConfig(int client_id, const std::string &cf_value, int record_count_)
             : client_id(client_id), cf(cf_value), // Initialize in declaration order
               op_chooser_(std::make_unique<DiscreteGenerator<Operation>>()),
-              record_count_(record_count_)
+              record_count_(record_count_),
+              request_counters_(std::make_unique<RequestCounters>())
         {
         }
     };
 
+    // One step of a client's schedule: optionally send a request, then wait
+    // `wait_us` before taking the next step.
+    struct BehaviorStep
+    {
+        bool send;
+        int64_t wait_us;
+    };
+
+    // Resumable walk over a client's behaviors. executeClientBehaviors() blocks
+    // its thread for the whole schedule; a cursor instead yields one step at a
+    // time so a single driver thread can interleave many clients.
+    class BehaviorCursor
+    {
+    public:
+        // `counters` is required only if the schedule contains CLOSED behaviors.
+        explicit BehaviorCursor(const std::vector<Behavior> *behaviors, const RequestCounters *counters = nullptr);
+
+        // Returns false once every behavior has been exhausted.
+        bool Next(BehaviorStep &step);
+
+    private:
+        void EnterBehavior(const Behavior &behavior);
+
+        const std::vector<Behavior> *behaviors_;
+        const RequestCounters *counters_;
+        std::vector<std::vector<int64_t>> replay_intervals_us_; // Preloaded per REPLAY behavior
+        std::optional<ClosedLoopGate> closed_gate_;
+        ClosedLoopGate::Clock::time_point closed_end_;
+        size_t behavior_idx_ = 0;
+        bool entered_ = false;
+        int64_t remaining_ops_ = 0;
+        int repeats_left_ = 0;
+        bool idle_pending_ = false;
+        size_t replay_pos_ = 0;
+    };
+
+    // Planned request rate over [start_ms, end_ms) of a client's schedule,
+    // measured from when the schedule starts. qps < 0 means the rate is not
+    // known ahead of time (CLOSED).
+    struct RateSegment
+    {
+        int64_t start_ms;
+        int64_t end_ms;
+        double qps;
+    };
+
     Operation stringToOperation(const std::string &operationName);
 
-    void executeClientBehaviors(const std::vector<Behavior> &behaviors, const std::function<void()> &send_request);
+    // REPLAY traces are bucketed into `replay_bucket_ms` segments.
+    std::vector<RateSegment> buildRateTimeline(const std::vector<Behavior> &behaviors, int64_t replay_bucket_ms);
+
+    std::vector<int64_t> loadReplayIntervalsUs(const std::string &trace_file, int client_id, double scale_ratio);
+
+    void executeClientBehaviors(const std::vector<Behavior> &behaviors, const std::function<void()> &send_request,
+                                const RequestCounters *counters = nullptr);
 
     std::vector<ClientConfig> loadClientBehaviors(const std::string &yaml_file);
 
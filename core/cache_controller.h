@@ -0,0 +1,144 @@
+#ifndef YCSB_C_CACHE_CONTROLLER_H_
+#define YCSB_C_CACHE_CONTROLLER_H_
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "db.h"
+#include "utils/countdown_latch.h"
+#include "utils/cpu_topology.h"
+#include "utils/shards_mrc.h"
+
+#include <rocksdb/cache.h>
+
+namespace ycsbc {
+
+struct CacheControllerOptions {
+  int interval_ms = 5000;
+  int units = 64;                   // capacity is moved in total/units steps
+  double min_fraction = 0.25;       // guaranteed share of an equal split
+  std::vector<int64_t> min_cache_kb; // per client; overrides min_fraction when > 0
+};
+
+// Splits `total_bytes` across tenants to maximize predicted hits: every
+// tenant starts at its guarantee, then each unit goes to the tenant whose
+// predicted hit count rises most from it.
+std::vector<uint64_t> ComputeCacheAllocation(
+  uint64_t total_bytes, const std::vector<uint64_t> &min_bytes, const std::vector<ycsbc::utils::ShardsMrc *> &mrcs,
+  const std::vector<double> &accesses, int units) {
+
+  const size_t num_clients = min_bytes.size();
+  std::vector<uint64_t> allocation(min_bytes);
+  uint64_t assigned = 0;
+  for (uint64_t b : allocation) {
+    assigned += b;
+  }
+  if (assigned >= total_bytes) {
+    // Guarantees oversubscribe the cache; scale them down proportionally.
+    for (size_t i = 0; i < num_clients; ++i) {
+      allocation[i] = static_cast<uint64_t>(double(min_bytes[i]) / assigned * total_bytes);
+    }
+    return allocation;
+  }
+  const uint64_t unit = std::max<uint64_t>(1, total_bytes / std::max(1, units));
+  while (assigned + unit <= total_bytes) {
+    double best_gain = -1;
+    size_t best = 0;
+    for (size_t i = 0; i < num_clients; ++i) {
+      double gain = accesses[i] * (mrcs[i]->MissRatio(allocation[i]) - mrcs[i]->MissRatio(allocation[i] + unit));
+      if (gain > best_gain) {
+        best_gain = gain;
+        best = i;
+      }
+    }
+    allocation[best] += unit;
+    assigned += unit;
+  }
+  // The remainder (less than a unit) goes to the busiest tenant.
+  size_t busiest = std::max_element(accesses.begin(), accesses.end()) - accesses.begin();
+  allocation[busiest] += total_bytes - assigned;
+  return allocation;
+}
+
+void CacheControllerThread(
+  std::vector<ycsbc::DB *> dbs, std::shared_ptr<ycsbc::utils::TenantMrcs> mrcs, CacheControllerOptions options,
+  ycsbc::utils::CountDownLatch *latch, ycsbc::utils::CountDownLatch *init_latch,
+  const ycsbc::utils::CpuLayout *cpu_layout) {
+
+    cpu_layout->PinCurrentThread("cachectl", 0, -1, "cache controller thread");
+    // Per-tenant caches are created in Init.
+    init_latch->Await();
+
+    std::ofstream logfile;
+    logfile.open("logs/cache_controller.log", std::ios::out | std::ios::trunc);
+    logfile << "timestamp,client_id,capacity_kb,usage_kb,accesses,predicted_miss_ratio" << std::endl;
+
+    // Only tenants with their own block cache take part; the total is fixed
+    // at the sum of the configured sizes.
+    std::vector<size_t> tenants;
+    std::vector<std::shared_ptr<rocksdb::Cache>> caches;
+    uint64_t total_bytes = 0;
+    for (size_t i = 0; i < mrcs->size(); ++i) {
+      std::shared_ptr<rocksdb::Cache> cache;
+      for (size_t j = 0; j < dbs.size() && cache == nullptr; ++j) {
+        cache = dbs[j]->GetCacheByClientIdx(i);
+      }
+      if (cache) {
+        tenants.push_back(i);
+        caches.push_back(cache);
+        total_bytes += cache->GetCapacity();
+      }
+    }
+    if (tenants.size() < 2) {
+      std::cout << "[FAIRDB_LOG] Cache controller needs at least two per-tenant caches, exiting" << std::endl;
+      return;
+    }
+
+    const uint64_t equal_share = total_bytes / tenants.size();
+    std::vector<uint64_t> min_bytes(tenants.size());
+    for (size_t t = 0; t < tenants.size(); ++t) {
+      size_t i = tenants[t];
+      if (i < options.min_cache_kb.size() && options.min_cache_kb[i] > 0) {
+        min_bytes[t] = options.min_cache_kb[i] * 1024;
+      } else {
+        min_bytes[t] = static_cast<uint64_t>(equal_share * options.min_fraction);
+      }
+    }
+
+    std::vector<ycsbc::utils::ShardsMrc *> tenant_mrcs(tenants.size());
+    for (size_t t = 0; t < tenants.size(); ++t) {
+      tenant_mrcs[t] = &(*mrcs)[tenants[t]];
+    }
+    std::vector<double> accesses(tenants.size());
+
+    while (!latch->AwaitForMs(options.interval_ms)) {
+      double total_accesses = 0;
+      for (size_t t = 0; t < tenants.size(); ++t) {
+        accesses[t] = tenant_mrcs[t]->Accesses();
+        total_accesses += accesses[t];
+      }
+      if (total_accesses == 0) {
+        continue;
+      }
+      std::vector<uint64_t> allocation = ComputeCacheAllocation(
+        total_bytes, min_bytes, tenant_mrcs, accesses, options.units);
+
+      auto now_us = std::chrono::time_point_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now());
+      long now = now_us.time_since_epoch().count();
+      for (size_t t = 0; t < tenants.size(); ++t) {
+        caches[t]->SetCapacity(allocation[t]);
+        logfile << now << "," << tenants[t] << "," << (allocation[t] / 1024) << ","
+                << (caches[t]->GetUsage() / 1024) << "," << static_cast<int64_t>(accesses[t]) << ","
+                << tenant_mrcs[t]->MissRatio(allocation[t]) << std::endl;
+        tenant_mrcs[t]->Decay();
+      }
+    }
+}
+
+} // namespace ycsbc
+
+#endif // YCSB_C_CACHE_CONTROLLER_H_
@@ -15,10 +15,13 @@
 #include <chrono>
 #include <vector>
 #include <tuple>
+#include <queue>
+#include <functional>
 
 #include "db.h"
 #include "core_workload.h"
 #include "utils/countdown_latch.h"
+#include "utils/cpu_topology.h"
 #include "utils/rate_limit.h"
 #include "utils/utils.h"
 #include "threadpool.h"
@@ -27,29 +30,140 @@
 namespace ycsbc
 {
 
-  inline long long ClientThread(ycsbc::DB *db, ycsbc::CoreWorkload *wl, const int num_ops, bool is_loading,
-                                bool init_db, bool cleanup_db, utils::CountDownLatch *latch, utils::RateLimiter *rlim, ThreadPool *threadpool,
-                                ClientConfig *client_config, std::vector<ycsbc::Measurements *> &queuing_delay_measurements)
+  // Builds the callback that enqueues one transaction for `client_config` into
+  // the worker pool. Shared by the thread-per-client and driver-thread modes.
+  // With queue.coalesce_reads / coalesce_writes the operation is chosen here,
+  // so point reads and single-key writes can be handed to a RequestCoalescer.
+  inline std::function<void()> MakeTransactionSender(ycsbc::DB *db, ycsbc::CoreWorkload *wl, utils::RateLimiter *rlim,
+                                                     ThreadPool *threadpool, ClientConfig *client_config,
+                                                     std::vector<ycsbc::Measurements *> &queuing_delay_measurements)
   {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-
-    size_t cpu_for_client = client_config->client_id;
-    CPU_SET(cpu_for_client, &cpuset);
-    std::cout << "[FAIRDB_LOG] Pinning client " << client_config->client_id << " to core " << cpu_for_client << std::endl;
-    int rc = pthread_setaffinity_np(pthread_self(),
-                                    sizeof(cpu_set_t), &cpuset);
-    if (rc != 0)
+    return [wl, db, client_config, threadpool, rlim, &queuing_delay_measurements]()
     {
-      fprintf(stderr, "Couldn't set thread affinity.\n");
-      std::exit(1);
-    }
+      if (rlim)
+      {
+        rlim->Consume(1);
+      }
+      auto enqueue_start_time = std::chrono::high_resolution_clock::now();
+      // Reports the queueing delay; false if the request is shed.
+      auto admit = [client_config, &queuing_delay_measurements](std::chrono::high_resolution_clock::time_point enqueued,
+                                                                 std::chrono::high_resolution_clock::time_point dequeued)
+      {
+        auto queueing_delay = std::chrono::duration_cast<std::chrono::nanoseconds>(dequeued - enqueued).count();
+        queuing_delay_measurements[client_config->client_id]->Report(QUEUE, queueing_delay);
+        if (client_config->queue.policy == QUEUE_DEADLINE && queueing_delay > client_config->queue.slo_us * 1000)
+        {
+          queuing_delay_measurements[client_config->client_id]->Report(SHED, queueing_delay);
+          return false;
+        }
+        return true;
+      };
+
+      RequestCoalescer *read_coalescer = client_config->read_coalescer_.get();
+      RequestCoalescer *write_coalescer = client_config->write_coalescer_.get();
+      const bool choose_now = read_coalescer || write_coalescer;
+      Operation op = choose_now ? wl->NextOperation(client_config) : READ;
+      RequestCoalescer *coalescer = nullptr;
+      if (op == READ)
+      {
+        coalescer = read_coalescer;
+      }
+      else if (op == UPDATE || op == RANDOM_INSERT)
+      {
+        coalescer = write_coalescer;
+      }
+      std::shared_ptr<RequestCoalescer::PendingRequest> pending;
+      std::function<void*()> transaction_task;
+      if (coalescer)
+      {
+        pending = std::make_shared<RequestCoalescer::PendingRequest>();
+        pending->enqueued = enqueue_start_time;
+        pending->op = op;
+        transaction_task = [wl, db, client_config, coalescer, pending, admit]()
+        {
+          static thread_local std::vector<std::shared_ptr<RequestCoalescer::PendingRequest>> batch;
+          static thread_local std::vector<Operation> ops;
+          coalescer->Claim(pending, batch);
+          if (batch.empty())
+          {
+            return nullptr; // served by another job's batch
+          }
+          auto dequeue_time = std::chrono::high_resolution_clock::now();
+          ops.clear();
+          for (const auto &request : batch)
+          {
+            if (admit(request->enqueued, dequeue_time))
+            {
+              ops.push_back(static_cast<Operation>(request->op));
+            }
+          }
+          if (!ops.empty())
+          {
+            if (pending->op == READ)
+            {
+              wl->DoCoalescedReads(*db, client_config, ops.size());
+            }
+            else
+            {
+              wl->DoCoalescedWrites(*db, client_config, ops);
+            }
+          }
+          client_config->request_counters_->completed.fetch_add(batch.size(), std::memory_order_release);
+          batch.clear();
+          return nullptr;
+        };
+      }
+      else
+      {
+        transaction_task = [wl, db, client_config, choose_now, op, enqueue_start_time, admit]()
+        {
+          if (admit(enqueue_start_time, std::chrono::high_resolution_clock::now()))
+          {
+            if (choose_now)
+            {
+              wl->DoTransaction(*db, client_config, op);
+            }
+            else
+            {
+              wl->DoTransaction(*db, client_config);
+            }
+          }
+          client_config->request_counters_->completed.fetch_add(1, std::memory_order_release);
+          return nullptr; // to match void* return
+        };
+      }
+      client_config->request_counters_->dispatched.fetch_add(1, std::memory_order_relaxed);
+      if (!threadpool->async_dispatch(client_config->client_id, std::move(transaction_task)))
+      {
+        client_config->request_counters_->dispatched.fetch_sub(1, std::memory_order_relaxed);
+        queuing_delay_measurements[client_config->client_id]->Report(REJECTED, 0);
+      }
+      else if (pending)
+      {
+        coalescer->Add(std::move(pending));
+      }
+    };
+  }
+
+  inline long long ClientThread(ycsbc::DB *db, ycsbc::CoreWorkload *wl, const int num_ops, bool is_loading,
+                                bool init_db, bool cleanup_db, utils::CountDownLatch *latch, utils::CountDownLatch *init_latch,
+                                utils::RateLimiter *rlim, ThreadPool *threadpool,
+                                ClientConfig *client_config, std::vector<ycsbc::Measurements *> &queuing_delay_measurements,
+                                const utils::CpuLayout *cpu_layout)
+  {
+    cpu_layout->PinCurrentThread("clients", client_config->client_id, client_config->client_id,
+                                 "client " + std::to_string(client_config->client_id));
     try
     {
       if (init_db)
       {
         db->Init();
       }
+      db->ResolveTenant(client_config->cf, client_config->client_id, client_config->tenant);
+      if (init_latch)
+      {
+        init_latch->CountDown();
+      }
 
       auto client_start = std::chrono::system_clock::now();
       auto client_start_micros = std::chrono::duration_cast<std::chrono::microseconds>(client_start.time_since_epoch()).count();
@@ -66,25 +180,8 @@ namespace ycsbc
       }
       else
       {
-        auto transaction_executor = [wl, db, client_config, threadpool, rlim, &queuing_delay_measurements]()
-        {
-          if (rlim)
-          {
-            rlim->Consume(1);
-          }
-          auto enqueue_start_time = std::chrono::high_resolution_clock::now();
-          auto transaction_task = [wl, db, client_config, enqueue_start_time, &queuing_delay_measurements]()
-          {
-            auto dequeue_time = std::chrono::high_resolution_clock::now();
-            auto queueing_delay = std::chrono::duration_cast<std::chrono::nanoseconds>(dequeue_time - enqueue_start_time).count();
-            queuing_delay_measurements[client_config->client_id]->Report(QUEUE, queueing_delay);
-
-          wl->DoTransaction(*db, client_config);
-            return nullptr; // to match void* return
-          };
-          threadpool->async_dispatch(client_config->client_id, transaction_task);
-        };
-        executeClientBehaviors(client_config->behaviors, transaction_executor);
+        auto transaction_executor = MakeTransactionSender(db, wl, rlim, threadpool, client_config, queuing_delay_measurements);
+        executeClientBehaviors(client_config->behaviors, transaction_executor, client_config->request_counters_.get());
       }
 
       if (cleanup_db)
@@ -102,6 +199,135 @@ namespace ycsbc
     }
   }
 
+  // Runs the transaction phase for a subset of clients on a single thread.
+  // Each client's schedule advances through a BehaviorCursor and the driver
+  // sleeps until the earliest client is due, so many open-loop clients share a
+  // few threads instead of holding one pinned core each.
+  inline void ClientDriverThread(int driver_id, std::vector<ycsbc::DB *> dbs, ycsbc::CoreWorkload *wl,
+                                 std::vector<size_t> client_idxs, bool init_db, utils::CountDownLatch *latch,
+                                 utils::CountDownLatch *init_latch,
+                                 std::vector<utils::RateLimiter *> rate_limiters, ThreadPool *threadpool,
+                                 std::vector<ClientConfig> *clients,
+                                 std::vector<ycsbc::Measurements *> &queuing_delay_measurements,
+                                 const utils::CpuLayout *cpu_layout)
+  {
+    // Drivers take the "drivers" role if present, else share the client cpus.
+    cpu_layout->PinCurrentThread(cpu_layout->HasRole("drivers") ? "drivers" : "clients", driver_id, driver_id,
+                                 "client driver " + std::to_string(driver_id) + " (" +
+                                     std::to_string(client_idxs.size()) + " clients)");
+
+    // Waits shorter than this are spun rather than slept, since a sleep can
+    // overshoot by tens of microseconds.
+    const auto spin_threshold = std::chrono::microseconds(50);
+    // How long a send held back by a full blocking queue waits before retrying.
+    const auto defer_retry = std::chrono::microseconds(100);
+
+    try
+    {
+      struct DrivenClient
+      {
+        size_t idx;
+        BehaviorCursor cursor;
+        std::function<void()> send_request;
+        bool deferred = false;                 // a send is waiting for queue space or a rate token
+        bool has_token = false;                // the deferred send already reserved its token
+        std::chrono::steady_clock::time_point next_due; // schedule after the deferred send
+      };
+      std::vector<DrivenClient> driven;
+      driven.reserve(client_idxs.size());
+      for (size_t idx : client_idxs)
+      {
+        if (init_db)
+        {
+          dbs[idx]->Init();
+        }
+        ClientConfig *client_config = &(*clients)[idx];
+        dbs[idx]->ResolveTenant(client_config->cf, client_config->client_id, client_config->tenant);
+        driven.push_back({idx, BehaviorCursor(&client_config->behaviors, client_config->request_counters_.get()),
+                          MakeTransactionSender(dbs[idx], wl, nullptr, threadpool, client_config,
+                                                queuing_delay_measurements)});
+        if (init_latch)
+        {
+          init_latch->CountDown();
+        }
+      }
+
+      using Clock = std::chrono::steady_clock;
+      using DueClient = std::pair<Clock::time_point, size_t>;
+      std::priority_queue<DueClient, std::vector<DueClient>, std::greater<DueClient>> due;
+      auto start = Clock::now();
+      for (size_t i = 0; i < driven.size(); ++i)
+      {
+        due.push({start, i});
+      }
+
+      while (!due.empty())
+      {
+        auto [when, i] = due.top();
+        due.pop();
+
+        auto now = Clock::now();
+        if (when - now > spin_threshold)
+        {
+          std::this_thread::sleep_for(when - now - spin_threshold);
+        }
+        while (Clock::now() < when)
+        {
+        }
+
+        DrivenClient &client = driven[i];
+        if (!client.deferred)
+        {
+          BehaviorStep step;
+          if (!client.cursor.Next(step))
+          {
+            dbs[client.idx]->Cleanup();
+            latch->CountDown();
+            continue;
+          }
+          // Schedule from the intended send time rather than from now so a late
+          // wakeup does not stretch the client's schedule.
+          client.next_due = when + std::chrono::microseconds(step.wait_us);
+          if (!step.send)
+          {
+            due.push({client.next_due, i});
+            continue;
+          }
+        }
+        // Blocking on one client's full queue would stall every client on
+        // this driver, so hold its send back and serve the others meanwhile.
+        client.deferred = threadpool->queueWouldBlock((*clients)[client.idx].client_id);
+        if (client.deferred)
+        {
+          due.push({Clock::now() + defer_retry, i});
+          continue;
+        }
+        // Likewise a rate-limited client waits in the queue until its token
+        // is due instead of sleeping in the sender.
+        utils::RateLimiter *rlim = rate_limiters[client.idx];
+        if (rlim && !client.has_token)
+        {
+          int64_t token_wait_ns = rlim->Reserve(1);
+          client.has_token = true;
+          client.deferred = token_wait_ns > 0;
+          if (client.deferred)
+          {
+            due.push({Clock::now() + std::chrono::nanoseconds(token_wait_ns), i});
+            continue;
+          }
+        }
+        client.has_token = false;
+        client.send_request();
+        due.push({client.next_due, i});
+      }
+    }
+    catch (const utils::Exception &e)
+    {
+      std::cerr << "Caught exception: " << e.what() << std::endl;
+      exit(1);
+    }
+  }
+
 } // ycsbc
 
 #endif // YCSB_C_CLIENT_H_
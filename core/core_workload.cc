@@ -44,7 +44,9 @@ const char *ycsbc::kOperationString[ycsbc::MAXOPTYPE] = {
     "DELETE-FAILED",
     "INSERT_BATCH-FAILED",
     "READ_BATCH-FAILED",
-    "READ_MODIFY_INSERT_BATCH-FAILED"};
+    "READ_MODIFY_INSERT_BATCH-FAILED",
+    "REJECTED",
+    "SHED"};
 
 const string CoreWorkload::TABLENAME_PROPERTY = "table";
 const string CoreWorkload::TABLENAME_DEFAULT = "usertable";
@@ -209,6 +211,21 @@ namespace ycsbc
     }
   }
 
+  // Smallest string above every string that starts with `prefix`; empty if
+  // there is none.
+  static std::string PrefixSuccessor(std::string prefix)
+  {
+    while (!prefix.empty() && static_cast<unsigned char>(prefix.back()) == 0xff)
+    {
+      prefix.pop_back();
+    }
+    if (!prefix.empty())
+    {
+      prefix.back()++;
+    }
+    return prefix;
+  }
+
   std::string CoreWorkload::BuildKeyName(uint64_t key_num)
   {
     // if (!ordered_inserts_) {
@@ -272,9 +289,18 @@ namespace ycsbc
   }
 
   bool CoreWorkload::DoTransaction(DB &db, ClientConfig *config)
+  {
+    return DoTransaction(db, config, NextOperation(config));
+  }
+
+  Operation CoreWorkload::NextOperation(ClientConfig *config)
+  {
+    return config->op_chooser_->Next();
+  }
+
+  bool CoreWorkload::DoTransaction(DB &db, ClientConfig *config, Operation op_choice)
   {
     DB::Status status;
-    auto op_choice = config->op_chooser_->Next();
     switch (op_choice)
     {
     case READ:
@@ -317,8 +343,7 @@ namespace ycsbc
     // TODO(tgriggs|devbali): add offset here
     
     uint64_t key_num = NextTransactionKeyNum(config);
-    std::string table_name = config->cf;
-    int client_id = config->client_id;
+    const TenantHandle &tenant = config->tenant;
     uint64_t client_key_num = key_num;
     // uint64_t client_key_num = key_num + (client_id%2) * (6250000 / 4);
 
@@ -328,14 +353,63 @@ namespace ycsbc
     {
       std::vector<std::string> fields;
       fields.push_back(NextFieldName());
-      return db.Read(table_name, key, &fields, result, client_id);
+      return db.Read(tenant, key, &fields, result);
     }
     else
     {
-      return db.Read(table_name, key, NULL, result, client_id);
+      return db.Read(tenant, key, NULL, result);
     }
   }
 
+  size_t CoreWorkload::DoCoalescedReads(DB &db, ClientConfig *config, size_t count)
+  {
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      keys.push_back(BuildKeyName(NextTransactionKeyNum(config)));
+    }
+
+    std::vector<std::vector<DB::Field>> results(count);
+    std::vector<DB::Status> statuses;
+    if (!read_all_fields())
+    {
+      std::vector<std::vector<std::string>> fields(count);
+      for (size_t i = 0; i < count; i++) {
+        fields[i].push_back(NextFieldName());
+      }
+      db.MultiRead(config->tenant, keys, &fields, results, statuses);
+    }
+    else
+    {
+      db.MultiRead(config->tenant, keys, NULL, results, statuses);
+    }
+    return std::count(statuses.begin(), statuses.end(), DB::kOK);
+  }
+
+  size_t CoreWorkload::DoCoalescedWrites(DB &db, ClientConfig *config, const std::vector<Operation> &ops)
+  {
+    std::vector<std::string> keys;
+    std::vector<std::vector<DB::Field>> values(ops.size());
+    std::vector<bool> is_update(ops.size());
+    keys.reserve(ops.size());
+    for (size_t i = 0; i < ops.size(); i++) {
+      keys.push_back(BuildKeyName(NextTransactionKeyNum(config)));
+      is_update[i] = ops[i] == UPDATE;
+      if (is_update[i] && !write_all_fields())
+      {
+        BuildSingleValue(values[i]);
+      }
+      else
+      {
+        BuildValues(values[i]);
+      }
+    }
+
+    std::vector<DB::Status> statuses;
+    db.MultiWrite(config->tenant, keys, values, is_update, statuses);
+    return std::count(statuses.begin(), statuses.end(), DB::kOK);
+  }
+
   DB::Status CoreWorkload::TransactionReadBatch(DB &db, ClientConfig *config)
   {
     const int batch_size = 100;  // Number of keys to read in each batch
@@ -349,8 +423,7 @@ namespace ycsbc
       keys.push_back(BuildKeyName(client_key_num));
     }
 
-    std::string table_name = config->cf;
-    int client_id = config->client_id;
+    const TenantHandle &tenant = config->tenant;
     std::vector<std::vector<DB::Field>> results(batch_size);
 
     if (!read_all_fields())
@@ -360,11 +433,11 @@ namespace ycsbc
       for (int i = 0; i < batch_size; i++) {
         fields[i].push_back(NextFieldName());
       }
-      return db.ReadBatch(table_name, keys, &fields, results, client_id);
+      return db.ReadBatch(tenant, keys, &fields, results);
     }
     else
     {
-      return db.ReadBatch(table_name, keys, NULL, results, client_id);
+      return db.ReadBatch(tenant, keys, NULL, results);
     }
   }
 
@@ -400,24 +473,31 @@ namespace ycsbc
   DB::Status CoreWorkload::TransactionScan(DB &db, ClientConfig *config)
   {
     uint64_t key_num = NextTransactionKeyNum(config);
-    std::string table_name = config->cf;
-    int client_id = config->client_id;
+    const TenantHandle &tenant = config->tenant;
     int len = 1000;
     // uint64_t client_key_num = std::min(key_num, uint64_t(3125000 - len));
     // uint64_t client_key_num = key_num + (client_id%2) * (6250000 / 4);
 
     const std::string key = BuildKeyName(key_num);
+    // With scan_prefix_length the scan ends with the start key's prefix
+    // (e.g. "user12" for 6), so a DB with a matching prefix extractor can
+    // skip files and memtable ranges holding other prefixes.
+    std::string upper_bound;
+    if (config->scan_prefix_length > 0)
+    {
+      upper_bound = PrefixSuccessor(key.substr(0, config->scan_prefix_length));
+    }
     // int len = scan_len_chooser_->Next();
     std::vector<std::vector<DB::Field>> result;
     if (!read_all_fields())
     {
       std::vector<std::string> fields;
       fields.push_back(NextFieldName());
-      return db.Scan(table_name, key, len, &fields, result, client_id);
+      return db.ScanBounded(tenant, key, upper_bound, len, &fields, result);
     }
     else
     {
-      return db.Scan(table_name, key, len, NULL, result, client_id);
+      return db.ScanBounded(tenant, key, upper_bound, len, NULL, result);
     }
   }
 
@@ -425,8 +505,7 @@ namespace ycsbc
   {
     // TODO(tgriggs|devbali): add offset here
     uint64_t key_num = NextTransactionKeyNum(config);
-    std::string table_name = config->cf;
-    int client_id = config->client_id;
+    const TenantHandle &tenant = config->tenant;
     uint64_t client_key_num = key_num;
     // uint64_t client_key_num = key_num + (client_id%2) * (6250000 / 4);
 
@@ -440,28 +519,26 @@ namespace ycsbc
     {
       BuildSingleValue(values);
     }
-    return db.Update(table_name, key, values, client_id);
+    return db.Update(tenant, key, values);
   }
 
   DB::Status CoreWorkload::TransactionRandomInsert(DB &db, ClientConfig *config)
   {
     uint64_t key_num = NextTransactionKeyNum(config);
-    std::string table_name = config->cf;
-    int client_id = config->client_id;
+    const TenantHandle &tenant = config->tenant;
     uint64_t client_key_num = key_num;
     // uint64_t client_key_num = key_num + (client_id%2) * (6250000 / 4);
 
     const std::string key = BuildKeyName(client_key_num);
     std::vector<DB::Field> values;
     BuildValues(values);
-    return db.Insert(table_name, key, values, client_id);
+    return db.Insert(tenant, key, values);
   }
 
   DB::Status CoreWorkload::TransactionInsertBatch(DB &db, ClientConfig *config)
   {
     uint64_t key_num = NextTransactionKeyNum(config);
-    std::string table_name = config->cf;
-    int client_id = config->client_id;
+    const TenantHandle &tenant = config->tenant;
     // int batch_size = 86;  // 86 * 1KB == 86KB
     // int batch_size = 200;  // 200 * 1KB == 200KB
     int batch_size = 20000;  // 20000 * 1KB == 20MB per req
@@ -472,7 +549,7 @@ namespace ycsbc
     // const std::string key = BuildKeyName(client_key_num);
     std::vector<DB::Field> values;
     BuildValues(values);
-    return db.InsertBatch(table_name, client_key_num, values, batch_size, client_id);
+    return db.InsertBatch(tenant, client_key_num, values, batch_size);
   }
 
   DB::Status CoreWorkload::TransactionReadModifyInsertBatch(DB &db, ClientConfig *config)
@@ -488,8 +565,7 @@ namespace ycsbc
       keys.push_back(BuildKeyName(client_key_num));
     }
 
-    std::string table_name = config->cf;
-    int client_id = config->client_id;
+    const TenantHandle &tenant = config->tenant;
     std::vector<std::vector<DB::Field>> results(batch_size);
     std::vector<DB::Field> new_values;
     BuildValues(new_values);  // Generate new values to write
@@ -501,11 +577,11 @@ namespace ycsbc
       for (int i = 0; i < batch_size; i++) {
         fields[i].push_back(NextFieldName());
       }
-      return db.ReadModifyInsertBatch(table_name, keys, &fields, results, new_values, client_id);
+      return db.ReadModifyInsertBatch(tenant, keys, &fields, results, new_values);
     }
     else
     {
-      return db.ReadModifyInsertBatch(table_name, keys, NULL, results, new_values, client_id);
+      return db.ReadModifyInsertBatch(tenant, keys, NULL, results, new_values);
     }
   }
 
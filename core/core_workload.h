@@ -186,6 +186,22 @@ namespace ycsbc
 
     virtual bool DoInsert(DB &db, ClientConfig *config);
     virtual bool DoTransaction(DB &db, ClientConfig *config);
+    ///
+    /// Picks the next operation for config; DoTransaction(db, config, op)
+    /// runs it. Split so a client can choose before enqueueing.
+    ///
+    Operation NextOperation(ClientConfig *config);
+    virtual bool DoTransaction(DB &db, ClientConfig *config, Operation op);
+    ///
+    /// Runs `count` point reads for config as one DB::MultiRead. Returns the
+    /// number that succeeded.
+    ///
+    size_t DoCoalescedReads(DB &db, ClientConfig *config, size_t count);
+    ///
+    /// Runs one UPDATE or RANDOM_INSERT per entry of ops for config as one
+    /// DB::MultiWrite. Returns the number that succeeded.
+    ///
+    size_t DoCoalescedWrites(DB &db, ClientConfig *config, const std::vector<Operation> &ops);
 
   bool read_all_fields() const { return read_all_fields_; }
   bool write_all_fields() const { return write_all_fields_; }
@@ -10,6 +10,7 @@
 #define YCSB_C_DB_H_
 
 #include "utils/properties.h"
+#include "tenant.h"
 #include "utils/resources.h"
 
 #include <vector>
@@ -17,9 +18,14 @@
 #include <memory>
 #include <rocksdb/db.h>
 #include <rocksdb/options.h>
+#include <rocksdb/secondary_cache.h>
 namespace ycsbc
 {
 
+namespace utils {
+class CpuLayout;
+}
+
 ///
 /// Database interface layer.
 /// per-thread DB instance.
@@ -115,22 +121,119 @@ class DB {
                              const std::vector<std::vector<std::string>> *fields,
                              std::vector<std::vector<Field>> &result,
                              std::vector<Field> &new_values, int client_id = 0) = 0;
+
+  ///
+  /// Resolves a table (a client's YAML `cf`) to a handle once, so per-op
+  /// calls can skip the name lookup. Call after Init(). The default records
+  /// only the name and client id.
+  ///
+  virtual void ResolveTenant(const std::string &table, int client_id, TenantHandle &tenant) {
+    tenant.table = table;
+    tenant.client_id = client_id;
+  }
+  ///
+  /// Operations on a resolved tenant. The defaults forward to the
+  /// table-name versions.
+  ///
+  virtual Status Read(const TenantHandle &tenant, const std::string &key,
+                      const std::vector<std::string> *fields, std::vector<Field> &result) {
+    return Read(tenant.table, key, fields, result, tenant.client_id);
+  }
+  virtual Status ReadBatch(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                           const std::vector<std::vector<std::string>> *fields,
+                           std::vector<std::vector<Field>> &result) {
+    return ReadBatch(tenant.table, keys, fields, result, tenant.client_id);
+  }
+  virtual Status Scan(const TenantHandle &tenant, const std::string &key, int record_count,
+                      const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result) {
+    return Scan(tenant.table, key, record_count, fields, result, tenant.client_id);
+  }
+  ///
+  /// Scan that also stops before upper_bound (exclusive), so the binding can
+  /// skip files and memtable ranges past it. An empty bound is Scan;
+  /// bindings without bound support ignore it.
+  ///
+  virtual Status ScanBounded(const TenantHandle &tenant, const std::string &key, const std::string &upper_bound,
+                             int record_count, const std::vector<std::string> *fields,
+                             std::vector<std::vector<Field>> &result) {
+    return Scan(tenant, key, record_count, fields, result);
+  }
+  virtual Status Update(const TenantHandle &tenant, const std::string &key, std::vector<Field> &values) {
+    return Update(tenant.table, key, values, tenant.client_id);
+  }
+  virtual Status Insert(const TenantHandle &tenant, const std::string &key, std::vector<Field> &values) {
+    return Insert(tenant.table, key, values, tenant.client_id);
+  }
+  virtual Status InsertBatch(const TenantHandle &tenant, int start_key, std::vector<Field> &values, int num_keys) {
+    return InsertBatch(tenant.table, start_key, values, num_keys, tenant.client_id);
+  }
+  ///
+  /// Point reads of independent requests served together, with one status
+  /// per key (unlike ReadBatch). The default issues them one at a time.
+  ///
+  virtual void MultiRead(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                         const std::vector<std::vector<std::string>> *fields,
+                         std::vector<std::vector<Field>> &result, std::vector<Status> &statuses) {
+    result.resize(keys.size());
+    statuses.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      statuses[i] = Read(tenant, keys[i], fields ? &(*fields)[i] : nullptr, result[i]);
+    }
+  }
+  ///
+  /// Single-key writes of independent requests applied as one write, with one
+  /// status per key. is_update[i] selects Update (fields of an existing
+  /// record) over Insert. The default issues them one at a time.
+  ///
+  virtual void MultiWrite(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                          std::vector<std::vector<Field>> &values, const std::vector<bool> &is_update,
+                          std::vector<Status> &statuses) {
+    statuses.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      statuses[i] = is_update[i] ? Update(tenant, keys[i], values[i]) : Insert(tenant, keys[i], values[i]);
+    }
+  }
+  virtual Status ReadModifyInsertBatch(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                                       const std::vector<std::vector<std::string>> *fields,
+                                       std::vector<std::vector<Field>> &result, std::vector<Field> &new_values) {
+    return ReadModifyInsertBatch(tenant.table, keys, fields, result, new_values, tenant.client_id);
+  }
   
     virtual void UpdateRateLimit(int client_id, int64_t rate_limit_bytes) = 0;
     virtual void UpdateMemtableSize(int client_id, int memtable_size_bytes) = 0;
     virtual void UpdateResourceShares(std::vector<ycsbc::utils::MultiTenantResourceShares> res_opts) = 0;
+    // Applies write_buffer_size / max_write_buffer_number to the listed CFs only.
+    virtual void UpdateMemtableShares(const std::vector<ycsbc::utils::MemtableShare> &shares) = 0;
     virtual std::vector<ycsbc::utils::MultiTenantResourceUsage> GetResourceUsage() = 0;
+    // Fills a caller-owned vector in place; bindings override this to avoid
+    // allocating on the scheduler's hot path.
+    virtual void ReadResourceUsage(std::vector<ycsbc::utils::MultiTenantResourceUsage> &usage) {
+      usage = GetResourceUsage();
+    }
     virtual void PrintDbStats() = 0;
+    // Empty unless tenants are bound to NUMA nodes.
+    virtual std::vector<ycsbc::utils::TenantNumaStats> GetNumaStats() { return {}; }
+    // False unless some tenant writes the WAL.
+    virtual bool GetWalStats(ycsbc::utils::WalStats &stats) { return false; }
 
     virtual ~DB() {}
 
   void SetProps(utils::Properties *props) {
     props_ = props;
   }
+  // The benchmark's cpu.layout, for bindings that pin their own threads.
+  void SetCpuLayout(const utils::CpuLayout *cpu_layout) {
+    cpu_layout_ = cpu_layout;
+  }
 
   virtual std::shared_ptr<rocksdb::Cache> GetCacheByClientIdx (int client_idx) = 0;
+  // nullptr unless the tenant's block cache has a secondary tier.
+  virtual std::shared_ptr<rocksdb::SecondaryCache> GetSecondaryCacheByClientIdx (int client_idx) { return nullptr; }
+  // DB-wide row cache, nullptr if disabled.
+  virtual std::shared_ptr<rocksdb::Cache> GetRowCache() { return nullptr; }
  protected:
   utils::Properties *props_;
+  const utils::CpuLayout *cpu_layout_ = nullptr;
 };
 
 } // ycsbc
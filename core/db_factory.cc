@@ -38,14 +38,17 @@ DB *DBFactory::CreateDB(utils::Properties *props, Measurements *measurements) {
 DB *DBFactory::CreateDBWithPerClientStats(
     utils::Properties *props, Measurements *measurements, 
     std::vector<Measurements*> per_client_measurements,
-    std::shared_ptr<ycsbc::utils::MultiTenantCounter> per_client_bytes_written) {
+    std::shared_ptr<ycsbc::utils::MultiTenantCounter> per_client_bytes_written,
+    std::shared_ptr<ycsbc::utils::TenantMrcs> tenant_mrcs,
+    const utils::CpuLayout *cpu_layout) {
   std::string db_name = props->GetProperty("dbname", "basic");
   DB *db = nullptr;
   std::map<std::string, DBCreator> &registry = Registry();
   if (registry.find(db_name) != registry.end()) {
     DB *new_db = (*registry[db_name])();
     new_db->SetProps(props);
-    db = new DBWrapper(new_db, measurements, per_client_measurements, per_client_bytes_written);
+    new_db->SetCpuLayout(cpu_layout);
+    db = new DBWrapper(new_db, measurements, per_client_measurements, per_client_bytes_written, tenant_mrcs);
   }
   return db;
 }
@@ -13,6 +13,7 @@
 #include "measurements.h"
 #include "utils/properties.h"
 #include "utils/resources.h"
+#include "utils/shards_mrc.h"
 
 #include <string>
 #include <map>
@@ -26,7 +27,9 @@ class DBFactory {
   static DB *CreateDB(utils::Properties *props, Measurements *measurements);
   static DB *CreateDBWithPerClientStats(utils::Properties *props, Measurements *measurements, 
                                         std::vector<Measurements*> per_client_measurements,
-                                        std::shared_ptr<ycsbc::utils::MultiTenantCounter> per_client_bytes_written);
+                                        std::shared_ptr<ycsbc::utils::MultiTenantCounter> per_client_bytes_written,
+                                        std::shared_ptr<ycsbc::utils::TenantMrcs> tenant_mrcs = nullptr,
+                                        const utils::CpuLayout *cpu_layout = nullptr);
  private:
   static std::map<std::string, DBCreator> &Registry();
 };
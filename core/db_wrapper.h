@@ -15,6 +15,7 @@
 #include "db.h"
 #include "measurements.h"
 #include "utils/resources.h"
+#include "utils/shards_mrc.h"
 #include "utils/timer.h"
 #include "utils/utils.h"
 #include <rocksdb/db.h>
@@ -28,7 +29,8 @@ class DBWrapper : public DB {
   DBWrapper(DB *db, Measurements *measurements) : db_(db), measurements_(measurements) {}
   DBWrapper(DB *db, Measurements *measurements, 
             std::vector<Measurements*> per_client_measurements,
-            std::shared_ptr<ycsbc::utils::MultiTenantCounter> per_client_bytes_written) : db_(db), measurements_(measurements), per_client_measurements_(per_client_measurements), per_client_bytes_written_(per_client_bytes_written) {}
+            std::shared_ptr<ycsbc::utils::MultiTenantCounter> per_client_bytes_written,
+            std::shared_ptr<ycsbc::utils::TenantMrcs> tenant_mrcs = nullptr) : db_(db), measurements_(measurements), per_client_measurements_(per_client_measurements), per_client_bytes_written_(per_client_bytes_written), tenant_mrcs_(tenant_mrcs) {}
   ~DBWrapper() {
     delete db_;
   }
@@ -41,80 +43,117 @@ class DBWrapper : public DB {
   Status Read(const std::string &table, const std::string &key,
               const std::vector<std::string> *fields, std::vector<Field> &result,
               int client_id) {
-    ns_timer_.Start();
-    Status s = db_->Read(table, key, fields, result, client_id);
-
-    uint64_t elapsed = ns_timer_.End();
-    if (s == kOK) {
-      measurements_->Report(READ, elapsed);
-      per_client_measurements_[client_id]->Report(READ, elapsed);
-    } else {
-      measurements_->Report(READ_FAILED, elapsed);
-      per_client_measurements_[client_id]->Report(READ_FAILED, elapsed);
-    }
+    Status s = Measure(READ, READ_FAILED, client_id, [&] { return db_->Read(table, key, fields, result, client_id); });
+    TrackCacheAccess(s, client_id, key);
     return s;
   }
+  Status Read(const TenantHandle &tenant, const std::string &key,
+              const std::vector<std::string> *fields, std::vector<Field> &result) {
+    Status s = Measure(READ, READ_FAILED, tenant.client_id, [&] { return db_->Read(tenant, key, fields, result); });
+    TrackCacheAccess(s, tenant.client_id, key);
+    return s;
+  }
+
   Status ReadBatch(const std::string &table, const std::vector<std::string> &keys,
                    const std::vector<std::vector<std::string>> *fields,
                    std::vector<std::vector<Field>> &result, int client_id) {
+    return Measure(READ_BATCH, READ_BATCH_FAILED, client_id,
+                   [&] { return db_->ReadBatch(table, keys, fields, result, client_id); });
+  }
+  Status ReadBatch(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                   const std::vector<std::vector<std::string>> *fields,
+                   std::vector<std::vector<Field>> &result) {
+    return Measure(READ_BATCH, READ_BATCH_FAILED, tenant.client_id,
+                   [&] { return db_->ReadBatch(tenant, keys, fields, result); });
+  }
+  
+  // Every request in the batch is reported as a READ with the batch's latency.
+  void MultiRead(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                 const std::vector<std::vector<std::string>> *fields,
+                 std::vector<std::vector<Field>> &result, std::vector<Status> &statuses) {
     ns_timer_.Start();
-    Status s = db_->ReadBatch(table, keys, fields, result, client_id);
-
+    db_->MultiRead(tenant, keys, fields, result, statuses);
     uint64_t elapsed = ns_timer_.End();
-    if (s == kOK) {
-      measurements_->Report(READ_BATCH, elapsed);
-      per_client_measurements_[client_id]->Report(READ_BATCH, elapsed);
-    } else {
-      measurements_->Report(READ_BATCH_FAILED, elapsed);
-      per_client_measurements_[client_id]->Report(READ_BATCH_FAILED, elapsed);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      Operation type = statuses[i] == kOK ? READ : READ_FAILED;
+      measurements_->Report(type, elapsed);
+      per_client_measurements_[tenant.client_id]->Report(type, elapsed);
+      TrackCacheAccess(statuses[i], tenant.client_id, keys[i]);
     }
-    return s;
   }
-  
+
   Status Scan(const std::string &table, const std::string &key, int record_count,
               const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result,
               int client_id) {
-    ns_timer_.Start();
-    Status s = db_->Scan(table, key, record_count, fields, result);
-    uint64_t elapsed = ns_timer_.End();
-    if (s == kOK) {
-      measurements_->Report(SCAN, elapsed);
-      per_client_measurements_[client_id]->Report(SCAN, elapsed);
-    } else {
-      measurements_->Report(SCAN_FAILED, elapsed);
-      per_client_measurements_[client_id]->Report(SCAN_FAILED, elapsed);
-    }
-    return s;
+    return Measure(SCAN, SCAN_FAILED, client_id,
+                   [&] { return db_->Scan(table, key, record_count, fields, result); });
+  }
+  Status Scan(const TenantHandle &tenant, const std::string &key, int record_count,
+              const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result) {
+    return Measure(SCAN, SCAN_FAILED, tenant.client_id,
+                   [&] { return db_->Scan(tenant, key, record_count, fields, result); });
   }
+  Status ScanBounded(const TenantHandle &tenant, const std::string &key, const std::string &upper_bound,
+                     int record_count, const std::vector<std::string> *fields,
+                     std::vector<std::vector<Field>> &result) {
+    return Measure(SCAN, SCAN_FAILED, tenant.client_id,
+                   [&] { return db_->ScanBounded(tenant, key, upper_bound, record_count, fields, result); });
+  }
+
   Status Update(const std::string &table, const std::string &key, std::vector<Field> &values,
                 int client_id) {
-    ns_timer_.Start();
-    Status s = db_->Update(table, key, values);
-    uint64_t elapsed = ns_timer_.End();
+    Status s = Measure(UPDATE, UPDATE_FAILED, client_id, [&] { return db_->Update(table, key, values); });
     if (s == kOK) {
-      measurements_->Report(UPDATE, elapsed);
-      per_client_measurements_[client_id]->Report(UPDATE, elapsed);
       per_client_bytes_written_->update(client_id, values.size() * values[0].value.size());
-    } else {
-      measurements_->Report(UPDATE_FAILED, elapsed);
-      per_client_measurements_[client_id]->Report(UPDATE_FAILED, elapsed);
     }
     return s;
   }
+  Status Update(const TenantHandle &tenant, const std::string &key, std::vector<Field> &values) {
+    Status s = Measure(UPDATE, UPDATE_FAILED, tenant.client_id, [&] { return db_->Update(tenant, key, values); });
+    if (s == kOK) {
+      per_client_bytes_written_->update(tenant.client_id, values.size() * values[0].value.size());
+    }
+    return s;
+  }
+
   Status Insert(const std::string &table, const std::string &key, std::vector<Field> &values, int client_id) {
-    ns_timer_.Start();
-    Status s = db_->Insert(table, key, values);
-    uint64_t elapsed = ns_timer_.End();
+    Status s = Measure(INSERT, INSERT_FAILED, client_id, [&] { return db_->Insert(table, key, values); });
     if (s == kOK) {
-      measurements_->Report(INSERT, elapsed);
-      per_client_measurements_[client_id]->Report(INSERT, elapsed);
       per_client_bytes_written_->update(client_id, values.size() * values[0].value.size());
-    } else {
-      measurements_->Report(INSERT_FAILED, elapsed);
-      per_client_measurements_[client_id]->Report(INSERT_FAILED, elapsed);
     }
     return s;
   }
+  Status Insert(const TenantHandle &tenant, const std::string &key, std::vector<Field> &values) {
+    Status s = Measure(INSERT, INSERT_FAILED, tenant.client_id, [&] { return db_->Insert(tenant, key, values); });
+    if (s == kOK) {
+      per_client_bytes_written_->update(tenant.client_id, values.size() * values[0].value.size());
+    }
+    return s;
+  }
+
+  // Every request in the batch is reported as an UPDATE or INSERT with the
+  // batch's latency.
+  void MultiWrite(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                  std::vector<std::vector<Field>> &values, const std::vector<bool> &is_update,
+                  std::vector<Status> &statuses) {
+    ns_timer_.Start();
+    db_->MultiWrite(tenant, keys, values, is_update, statuses);
+    uint64_t elapsed = ns_timer_.End();
+    for (size_t i = 0; i < keys.size(); ++i) {
+      Operation type;
+      if (is_update[i]) {
+        type = statuses[i] == kOK ? UPDATE : UPDATE_FAILED;
+      } else {
+        type = statuses[i] == kOK ? INSERT : INSERT_FAILED;
+      }
+      measurements_->Report(type, elapsed);
+      per_client_measurements_[tenant.client_id]->Report(type, elapsed);
+      if (statuses[i] == kOK) {
+        per_client_bytes_written_->update(tenant.client_id, values[i].size() * values[i][0].value.size());
+      }
+    }
+  }
+
   Status Delete(const std::string &table, const std::string &key) {
     ns_timer_.Start();
     Status s = db_->Delete(table, key);
@@ -128,16 +167,18 @@ class DBWrapper : public DB {
   }
 
   Status InsertBatch(const std::string &table, int start_key, std::vector<Field> &values, int num_keys, int client_id = 0) {
-    ns_timer_.Start();
-    Status s = db_->InsertBatch(table, start_key, values, num_keys);
-    uint64_t elapsed = ns_timer_.End();
+    Status s = Measure(INSERT_BATCH, INSERT_BATCH_FAILED, client_id,
+                       [&] { return db_->InsertBatch(table, start_key, values, num_keys); });
     if (s == kOK) {
-      measurements_->Report(INSERT_BATCH, elapsed);
-      per_client_measurements_[client_id]->Report(INSERT_BATCH, elapsed);
       per_client_bytes_written_->update(client_id, num_keys * values.size() * values[0].value.size());
-    } else {
-      measurements_->Report(INSERT_BATCH_FAILED, elapsed);
-      per_client_measurements_[client_id]->Report(INSERT_BATCH_FAILED, elapsed);
+    }
+    return s;
+  }
+  Status InsertBatch(const TenantHandle &tenant, int start_key, std::vector<Field> &values, int num_keys) {
+    Status s = Measure(INSERT_BATCH, INSERT_BATCH_FAILED, tenant.client_id,
+                       [&] { return db_->InsertBatch(tenant, start_key, values, num_keys); });
+    if (s == kOK) {
+      per_client_bytes_written_->update(tenant.client_id, num_keys * values.size() * values[0].value.size());
     }
     return s;
   }
@@ -147,20 +188,30 @@ class DBWrapper : public DB {
                              const std::vector<std::vector<std::string>> *fields,
                              std::vector<std::vector<Field>> &result,
                              std::vector<Field> &new_values, int client_id = 0) {
-    ns_timer_.Start();
-    Status s = db_->ReadModifyInsertBatch(table, keys, fields, result, new_values);
-    uint64_t elapsed = ns_timer_.End();
+    Status s = Measure(READ_MODIFY_INSERT_BATCH, READ_MODIFY_INSERT_BATCH_FAILED, client_id,
+                       [&] { return db_->ReadModifyInsertBatch(table, keys, fields, result, new_values); });
     if (s == kOK) {
-      measurements_->Report(READ_MODIFY_INSERT_BATCH, elapsed);
-      per_client_measurements_[client_id]->Report(READ_MODIFY_INSERT_BATCH, elapsed);
       per_client_bytes_written_->update(client_id, keys.size() * new_values.size() * new_values[0].value.size());
-    } else {
-      measurements_->Report(READ_MODIFY_INSERT_BATCH_FAILED, elapsed);
-      per_client_measurements_[client_id]->Report(READ_MODIFY_INSERT_BATCH_FAILED, elapsed);
+    }
+    return s;
+  }
+  Status ReadModifyInsertBatch(const TenantHandle &tenant,
+                             const std::vector<std::string> &keys,
+                             const std::vector<std::vector<std::string>> *fields,
+                             std::vector<std::vector<Field>> &result,
+                             std::vector<Field> &new_values) {
+    Status s = Measure(READ_MODIFY_INSERT_BATCH, READ_MODIFY_INSERT_BATCH_FAILED, tenant.client_id,
+                       [&] { return db_->ReadModifyInsertBatch(tenant, keys, fields, result, new_values); });
+    if (s == kOK) {
+      per_client_bytes_written_->update(tenant.client_id, keys.size() * new_values.size() * new_values[0].value.size());
     }
     return s;
   }
 
+  void ResolveTenant(const std::string &table, int client_id, TenantHandle &tenant) {
+    db_->ResolveTenant(table, client_id, tenant);
+  }
+
   void UpdateRateLimit(int client_id, int64_t rate_limit_bytes) {
     db_->UpdateRateLimit(client_id, rate_limit_bytes);
   }
@@ -173,6 +224,10 @@ class DBWrapper : public DB {
     db_->UpdateResourceShares(res_opts);
   }
 
+  void UpdateMemtableShares(const std::vector<ycsbc::utils::MemtableShare> &shares) {
+    db_->UpdateMemtableShares(shares);
+  }
+
   std::vector<ycsbc::utils::MultiTenantResourceUsage> GetResourceUsage() {
     auto res = db_->GetResourceUsage();
     for (size_t i = 0; i < res.size(); ++i) {
@@ -181,19 +236,66 @@ class DBWrapper : public DB {
     return res;
   }
 
+  void ReadResourceUsage(std::vector<ycsbc::utils::MultiTenantResourceUsage> &usage) {
+    db_->ReadResourceUsage(usage);
+    for (size_t i = 0; i < usage.size(); ++i) {
+      usage[i].mem_bytes_written_kb = per_client_bytes_written_->get_value(i) / 1024;
+    }
+  }
+
   void PrintDbStats() {
     db_->PrintDbStats();
   }
 
+  std::vector<ycsbc::utils::TenantNumaStats> GetNumaStats() {
+    return db_->GetNumaStats();
+  }
+  bool GetWalStats(ycsbc::utils::WalStats &stats) {
+    return db_->GetWalStats(stats);
+  }
+
   std::shared_ptr<rocksdb::Cache> GetCacheByClientIdx (int client_idx) {
     return db_->GetCacheByClientIdx(client_idx);
   }
+
+  std::shared_ptr<rocksdb::SecondaryCache> GetSecondaryCacheByClientIdx (int client_idx) {
+    return db_->GetSecondaryCacheByClientIdx(client_idx);
+  }
+
+  std::shared_ptr<rocksdb::Cache> GetRowCache() {
+    return db_->GetRowCache();
+  }
   
  private:
+  // Times op and reports it globally and for client_id.
+  template <typename Op>
+  Status Measure(Operation ok_type, Operation failed_type, int client_id, Op &&op) {
+    ns_timer_.Start();
+    Status s = op();
+    uint64_t elapsed = ns_timer_.End();
+    if (s == kOK) {
+      measurements_->Report(ok_type, elapsed);
+      per_client_measurements_[client_id]->Report(ok_type, elapsed);
+    } else {
+      measurements_->Report(failed_type, elapsed);
+      per_client_measurements_[client_id]->Report(failed_type, elapsed);
+    }
+    return s;
+  }
+
+  // Charges the whole stored row: a projected read still caches all of it.
+  void TrackCacheAccess(Status s, int client_id, const std::string &key) {
+    if (s != kOK || !tenant_mrcs_) {
+      return;
+    }
+    (*tenant_mrcs_)[client_id].Access(key, key.size() + tenant_mrcs_->row_bytes());
+  }
+
   DB *db_;
   Measurements *measurements_;
   std::vector<Measurements*> per_client_measurements_;
   std::shared_ptr<ycsbc::utils::MultiTenantCounter> per_client_bytes_written_;
+  std::shared_ptr<ycsbc::utils::TenantMrcs> tenant_mrcs_;  // null unless the cache controller is on
   utils::Timer<uint64_t, std::nano> ns_timer_;
 };
 
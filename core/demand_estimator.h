@@ -0,0 +1,256 @@
+#ifndef YCSB_C_DEMAND_ESTIMATOR_H_
+#define YCSB_C_DEMAND_ESTIMATOR_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "behavior.h"
+#include "resource_allocation.h"
+
+namespace ycsbc {
+
+enum class DemandEstimatorType {
+  kMaxWindow,    // Max over the last lookback_intervals (the original policy)
+  kEWMA,
+  kHoltWinters,
+  kSchedule,     // Known client schedule x learned per-request cost, EWMA fallback
+};
+
+struct DemandEstimatorOptions {
+  DemandEstimatorType type = DemandEstimatorType::kMaxWindow;
+  size_t lookback_intervals = 1;  // kMaxWindow
+  double alpha = 0.3;             // level smoothing (EWMA, Holt-Winters, schedule cost)
+  double beta = 0.1;              // Holt-Winters trend smoothing
+  double gamma = 0.1;             // Holt-Winters seasonal smoothing
+  size_t season_intervals = 0;    // Holt-Winters season length, 0 = no seasonality
+  double interval_ms = 10;        // scheduler interval
+  int64_t lookahead_ms = 0;       // kSchedule: forecast the peak rate this far ahead
+};
+
+// Schedule timelines have millisecond resolution; a sub-millisecond
+// scheduler interval still looks one millisecond back.
+inline int64_t TimelineStepMs(const DemandEstimatorOptions &options) {
+  return std::max<int64_t>(1, std::llround(options.interval_ms));
+}
+
+// Predicts each tenant's demand for the next scheduler interval from the
+// usage rates seen so far. `elapsed_ms` is time since the client schedules
+// started.
+class DemandEstimator {
+ public:
+  virtual ~DemandEstimator() = default;
+  virtual void Observe(int64_t elapsed_ms, const std::vector<ResourceVector> &usage) = 0;
+  virtual void Forecast(int64_t elapsed_ms, std::vector<ResourceVector> &demand) = 0;
+};
+
+class MaxWindowEstimator : public DemandEstimator {
+ public:
+  explicit MaxWindowEstimator(size_t lookback_intervals) : lookback_intervals_(std::max<size_t>(1, lookback_intervals)) {}
+
+  void Observe(int64_t, const std::vector<ResourceVector> &usage) override {
+    window_.push_back(usage);
+    if (window_.size() > lookback_intervals_) {
+      window_.pop_front();
+    }
+  }
+
+  void Forecast(int64_t, std::vector<ResourceVector> &demand) override {
+    for (size_t i = 0; i < demand.size(); ++i) {
+      demand[i] = ResourceVector{};
+      for (const auto &usage : window_) {
+        for (int r = 0; r < kNumSchedResources; ++r) {
+          demand[i][r] = std::max(demand[i][r], usage[i][r]);
+        }
+      }
+    }
+  }
+
+ private:
+  size_t lookback_intervals_;
+  std::deque<std::vector<ResourceVector>> window_;
+};
+
+class EwmaEstimator : public DemandEstimator {
+ public:
+  EwmaEstimator(size_t num_clients, double alpha) : alpha_(alpha), level_(num_clients) {}
+
+  void Observe(int64_t, const std::vector<ResourceVector> &usage) override {
+    for (size_t i = 0; i < level_.size(); ++i) {
+      for (int r = 0; r < kNumSchedResources; ++r) {
+        level_[i][r] = initialized_ ? alpha_ * usage[i][r] + (1 - alpha_) * level_[i][r] : usage[i][r];
+      }
+    }
+    initialized_ = true;
+  }
+
+  void Forecast(int64_t, std::vector<ResourceVector> &demand) override {
+    for (size_t i = 0; i < demand.size(); ++i) {
+      for (int r = 0; r < kNumSchedResources; ++r) {
+        demand[i][r] = static_cast<int64_t>(level_[i][r]);
+      }
+    }
+  }
+
+ private:
+  double alpha_;
+  bool initialized_ = false;
+  std::vector<std::array<double, kNumSchedResources>> level_;
+};
+
+// Additive Holt-Winters (triple exponential smoothing). With
+// season_intervals == 0 this is Holt's linear trend method.
+class HoltWintersEstimator : public DemandEstimator {
+ public:
+  HoltWintersEstimator(size_t num_clients, double alpha, double beta, double gamma, size_t season_intervals)
+    : alpha_(alpha), beta_(beta), gamma_(gamma), season_(season_intervals),
+      level_(num_clients), trend_(num_clients),
+      seasonal_(num_clients, std::vector<std::array<double, kNumSchedResources>>(std::max<size_t>(1, season_intervals))) {}
+
+  void Observe(int64_t, const std::vector<ResourceVector> &usage) override {
+    size_t s = season_ > 0 ? step_ % season_ : 0;
+    for (size_t i = 0; i < level_.size(); ++i) {
+      for (int r = 0; r < kNumSchedResources; ++r) {
+        double y = usage[i][r];
+        if (step_ == 0) {
+          level_[i][r] = y;
+          trend_[i][r] = 0;
+          continue;
+        }
+        double seasonal = season_ > 0 ? seasonal_[i][s][r] : 0;
+        double prev_level = level_[i][r];
+        level_[i][r] = alpha_ * (y - seasonal) + (1 - alpha_) * (prev_level + trend_[i][r]);
+        trend_[i][r] = beta_ * (level_[i][r] - prev_level) + (1 - beta_) * trend_[i][r];
+        if (season_ > 0) {
+          seasonal_[i][s][r] = gamma_ * (y - level_[i][r]) + (1 - gamma_) * seasonal;
+        }
+      }
+    }
+    ++step_;
+  }
+
+  void Forecast(int64_t, std::vector<ResourceVector> &demand) override {
+    size_t s = season_ > 0 ? step_ % season_ : 0;
+    for (size_t i = 0; i < demand.size(); ++i) {
+      for (int r = 0; r < kNumSchedResources; ++r) {
+        double seasonal = season_ > 0 ? seasonal_[i][s][r] : 0;
+        demand[i][r] = static_cast<int64_t>(std::max(0.0, level_[i][r] + trend_[i][r] + seasonal));
+      }
+    }
+  }
+
+ private:
+  double alpha_;
+  double beta_;
+  double gamma_;
+  size_t season_;
+  size_t step_ = 0;
+  std::vector<std::array<double, kNumSchedResources>> level_;
+  std::vector<std::array<double, kNumSchedResources>> trend_;
+  std::vector<std::vector<std::array<double, kNumSchedResources>>> seasonal_;
+};
+
+// Uses each tenant's declared schedule (STEADY/BURSTY/INACTIVE/REPLAY) to
+// see rate changes before they happen: demand = learned cost per request x
+// the peak planned rate over the lookahead. Falls back to `fallback` where
+// the rate is not known ahead of time (CLOSED, past the end of the
+// schedule) or no cost has been learned yet. Cache occupancy is a level,
+// not a rate, so it always comes from the fallback.
+class ScheduleAwareEstimator : public DemandEstimator {
+ public:
+  ScheduleAwareEstimator(const std::vector<std::vector<RateSegment>> &timelines, const DemandEstimatorOptions &options,
+                         std::unique_ptr<DemandEstimator> fallback)
+    : timelines_(timelines), alpha_(options.alpha), interval_ms_(TimelineStepMs(options)),
+      lookahead_ms_(std::max<int64_t>(options.lookahead_ms, interval_ms_)), fallback_(std::move(fallback)),
+      cost_(timelines.size()), has_cost_(timelines.size()) {}
+
+  void Observe(int64_t elapsed_ms, const std::vector<ResourceVector> &usage) override {
+    fallback_->Observe(elapsed_ms, usage);
+    for (size_t i = 0; i < timelines_.size() && i < usage.size(); ++i) {
+      double qps = PeakRate(i, elapsed_ms - interval_ms_, elapsed_ms);
+      if (qps <= 0) {
+        continue;
+      }
+      for (int r = 0; r < kNumSchedResources; ++r) {
+        double per_request = usage[i][r] / qps;
+        cost_[i][r] = has_cost_[i] ? alpha_ * per_request + (1 - alpha_) * cost_[i][r] : per_request;
+      }
+      has_cost_[i] = true;
+    }
+  }
+
+  void Forecast(int64_t elapsed_ms, std::vector<ResourceVector> &demand) override {
+    fallback_->Forecast(elapsed_ms, demand);
+    for (size_t i = 0; i < timelines_.size() && i < demand.size(); ++i) {
+      double qps = PeakRate(i, elapsed_ms, elapsed_ms + lookahead_ms_);
+      if (qps < 0 || (qps > 0 && !has_cost_[i])) {
+        continue;
+      }
+      for (int r = 0; r < kNumSchedResources; ++r) {
+        if (r != kSchedCache) {
+          demand[i][r] = static_cast<int64_t>(cost_[i][r] * qps);
+        }
+      }
+    }
+  }
+
+ private:
+  // Highest planned rate overlapping [from_ms, to_ms); -1 if any part of the
+  // window is unknown.
+  double PeakRate(size_t client, int64_t from_ms, int64_t to_ms) const {
+    const std::vector<RateSegment> &timeline = timelines_[client];
+    if (timeline.empty() || to_ms > timeline.back().end_ms) {
+      return -1;
+    }
+    // Segments are contiguous and sorted; start at the one covering from_ms.
+    auto it = std::upper_bound(timeline.begin(), timeline.end(), from_ms,
+                               [](int64_t t, const RateSegment &segment) { return t < segment.end_ms; });
+    double peak = 0;
+    for (; it != timeline.end() && it->start_ms < to_ms; ++it) {
+      if (it->qps < 0) {
+        return -1;
+      }
+      peak = std::max(peak, it->qps);
+    }
+    return peak;
+  }
+
+  std::vector<std::vector<RateSegment>> timelines_;
+  double alpha_;
+  int64_t interval_ms_;
+  int64_t lookahead_ms_;
+  std::unique_ptr<DemandEstimator> fallback_;
+  std::vector<std::array<double, kNumSchedResources>> cost_;
+  std::vector<bool> has_cost_;
+};
+
+// `schedules` is indexed by client id and only used by kSchedule.
+inline std::unique_ptr<DemandEstimator> NewDemandEstimator(
+  const DemandEstimatorOptions &options, size_t num_clients, const std::vector<std::vector<Behavior>> &schedules) {
+  switch (options.type) {
+    case DemandEstimatorType::kEWMA:
+      return std::make_unique<EwmaEstimator>(num_clients, options.alpha);
+    case DemandEstimatorType::kHoltWinters:
+      return std::make_unique<HoltWintersEstimator>(num_clients, options.alpha, options.beta, options.gamma,
+                                                    options.season_intervals);
+    case DemandEstimatorType::kSchedule: {
+      std::vector<std::vector<RateSegment>> timelines(num_clients);
+      for (size_t i = 0; i < num_clients && i < schedules.size(); ++i) {
+        timelines[i] = buildRateTimeline(schedules[i], TimelineStepMs(options));
+      }
+      return std::make_unique<ScheduleAwareEstimator>(
+        timelines, options, std::make_unique<EwmaEstimator>(num_clients, options.alpha));
+    }
+    case DemandEstimatorType::kMaxWindow:
+    default:
+      return std::make_unique<MaxWindowEstimator>(options.lookback_intervals);
+  }
+}
+
+} // namespace ycsbc
+
+#endif // YCSB_C_DEMAND_ESTIMATOR_H_
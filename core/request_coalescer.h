@@ -0,0 +1,74 @@
+#ifndef YCSB_C_REQUEST_COALESCER_H_
+#define YCSB_C_REQUEST_COALESCER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "concurrentqueue/concurrentqueue.h"
+
+namespace ycsbc {
+
+// Merges a tenant's queued requests into one DB call: point reads into a
+// MultiGet, single-key writes into a WriteBatch. Every request keeps its own
+// worker-pool job, so queue bounds and CPU accounting are unchanged; the
+// first of those jobs to run claims its own request plus up to max_batch - 1
+// others still pending, waiting up to max_wait_us for stragglers, and the
+// jobs whose requests were claimed find nothing to do.
+class RequestCoalescer {
+ public:
+  using Clock = std::chrono::high_resolution_clock;
+
+  struct PendingRequest {
+    Clock::time_point enqueued;
+    int op = 0;  // caller-defined, e.g. the workload Operation
+    std::atomic<bool> claimed{false};
+  };
+
+  RequestCoalescer(size_t max_batch, int64_t max_wait_us)
+    : max_batch_(std::max<size_t>(1, max_batch)), max_wait_us_(max_wait_us) {}
+
+  // Call once the request's job is in the pool, so a request whose job was
+  // rejected is never served.
+  void Add(std::shared_ptr<PendingRequest> request) {
+    pending_.enqueue(std::move(request));
+  }
+
+  // Fills `batch` with the requests this job serves, starting with its own.
+  // Empty if another job already claimed `own`.
+  void Claim(const std::shared_ptr<PendingRequest> &own, std::vector<std::shared_ptr<PendingRequest>> &batch) {
+    batch.clear();
+    if (own->claimed.exchange(true, std::memory_order_acq_rel)) {
+      return;
+    }
+    batch.push_back(own);
+    TakePending(batch);
+    if (batch.size() < max_batch_ && max_wait_us_ > 0) {
+      auto deadline = Clock::now() + std::chrono::microseconds(max_wait_us_);
+      while (batch.size() < max_batch_ && Clock::now() < deadline) {
+        TakePending(batch);
+      }
+    }
+  }
+
+ private:
+  void TakePending(std::vector<std::shared_ptr<PendingRequest>> &batch) {
+    std::shared_ptr<PendingRequest> request;
+    while (batch.size() < max_batch_ && pending_.try_dequeue(request)) {
+      if (!request->claimed.exchange(true, std::memory_order_acq_rel)) {
+        batch.push_back(std::move(request));
+      }
+    }
+  }
+
+  const size_t max_batch_;
+  const int64_t max_wait_us_;
+  moodycamel::ConcurrentQueue<std::shared_ptr<PendingRequest>> pending_;
+};
+
+} // namespace ycsbc
+
+#endif // YCSB_C_REQUEST_COALESCER_H_
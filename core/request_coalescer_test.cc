@@ -0,0 +1,163 @@
+#include "request_coalescer.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "utils/test_util.h"
+
+namespace {
+
+using ycsbc::RequestCoalescer;
+using Request = std::shared_ptr<RequestCoalescer::PendingRequest>;
+
+Request NewRequest(int op) {
+  Request request = std::make_shared<RequestCoalescer::PendingRequest>();
+  request->enqueued = RequestCoalescer::Clock::now();
+  request->op = op;
+  return request;
+}
+
+void TestBatchesPendingRequests() {
+  RequestCoalescer coalescer(3, 0);
+  std::vector<Request> requests;
+  for (int i = 0; i < 5; ++i) {
+    requests.push_back(NewRequest(i));
+    coalescer.Add(requests.back());
+  }
+
+  std::vector<Request> batch;
+  coalescer.Claim(requests[0], batch);
+  TEST_CHECK(batch.size() == 3);
+  TEST_CHECK(batch[0] == requests[0] && batch[1] == requests[1] && batch[2] == requests[2]);
+
+  // Jobs whose requests were taken find nothing to do.
+  coalescer.Claim(requests[1], batch);
+  TEST_CHECK(batch.empty());
+  coalescer.Claim(requests[2], batch);
+  TEST_CHECK(batch.empty());
+
+  coalescer.Claim(requests[3], batch);
+  TEST_CHECK(batch.size() == 2);
+  TEST_CHECK(batch[0] == requests[3] && batch[1] == requests[4]);
+  coalescer.Claim(requests[4], batch);
+  TEST_CHECK(batch.empty());
+}
+
+void TestClaimBeforeAdd() {
+  // A job can run before its request is added; the late Add must not hand
+  // the request to a second job.
+  RequestCoalescer coalescer(4, 0);
+  Request early = NewRequest(0);
+  std::vector<Request> batch;
+  coalescer.Claim(early, batch);
+  TEST_CHECK(batch.size() == 1 && batch[0] == early);
+
+  coalescer.Add(early);
+  Request next = NewRequest(1);
+  coalescer.Add(next);
+  coalescer.Claim(next, batch);
+  TEST_CHECK(batch.size() == 1 && batch[0] == next);
+}
+
+void TestWaitsForStragglers() {
+  RequestCoalescer coalescer(2, 1000 * 1000);
+  Request first = NewRequest(0);
+  Request straggler = NewRequest(1);
+  coalescer.Add(first);
+  std::thread adder([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    coalescer.Add(straggler);
+  });
+  std::vector<Request> batch;
+  coalescer.Claim(first, batch);
+  adder.join();
+  TEST_CHECK(batch.size() == 2 && batch[1] == straggler);
+}
+
+void TestConcurrentClaimAndAdd() {
+  // Producers queue a job per request and then Add it, like ClientThread;
+  // workers run the jobs concurrently. Every request must be served by
+  // exactly one batch.
+  const int kProducers = 2;
+  const int kWorkers = 4;
+  const int kPerProducer = 20000;
+  const size_t kMaxBatch = 8;
+  RequestCoalescer coalescer(kMaxBatch, 5);
+
+  std::mutex jobs_mutex;
+  std::deque<Request> jobs;
+  std::atomic<int> producers_done{0};
+  std::unique_ptr<std::atomic<int>[]> served(new std::atomic<int>[kProducers * kPerProducer]);
+  for (int i = 0; i < kProducers * kPerProducer; ++i) {
+    served[i] = 0;
+  }
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kProducers; ++p) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < kPerProducer; ++i) {
+        Request request = NewRequest(p * kPerProducer + i);
+        {
+          std::lock_guard<std::mutex> lock(jobs_mutex);
+          jobs.push_back(request);
+        }
+        coalescer.Add(request);
+      }
+      producers_done++;
+    });
+  }
+  for (int w = 0; w < kWorkers; ++w) {
+    threads.emplace_back([&] {
+      std::vector<Request> batch;
+      while (true) {
+        Request own;
+        {
+          std::lock_guard<std::mutex> lock(jobs_mutex);
+          if (!jobs.empty()) {
+            own = jobs.front();
+            jobs.pop_front();
+          }
+        }
+        if (!own) {
+          if (producers_done.load() == kProducers) {
+            std::lock_guard<std::mutex> lock(jobs_mutex);
+            if (jobs.empty()) {
+              return;
+            }
+          }
+          std::this_thread::yield();
+          continue;
+        }
+        coalescer.Claim(own, batch);
+        TEST_CHECK(batch.size() <= kMaxBatch);
+        TEST_CHECK(batch.empty() || batch[0] == own);
+        for (const Request &request : batch) {
+          served[request->op]++;
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  for (int i = 0; i < kProducers * kPerProducer; ++i) {
+    TEST_CHECK(served[i].load() == 1);
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestBatchesPendingRequests();
+  TestClaimBeforeAdd();
+  TestWaitsForStragglers();
+  TestConcurrentClaimAndAdd();
+  std::cout << "request_coalescer_test: OK" << std::endl;
+  return 0;
+}
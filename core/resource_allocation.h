@@ -0,0 +1,271 @@
+#ifndef YCSB_C_RESOURCE_ALLOCATION_H_
+#define YCSB_C_RESOURCE_ALLOCATION_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "utils/resources.h"
+
+namespace ycsbc {
+
+// Resources the scheduler divides, in scheduler units.
+enum SchedResource {
+  kSchedIoRead = 0,   // KB/s
+  kSchedIoWrite,      // KB/s
+  kSchedMemtable,     // KB/s written to memtables
+  kSchedCache,        // KB of block cache
+  kSchedCpu,          // worker CPU us/s
+  kNumSchedResources
+};
+
+using ResourceVector = std::array<int64_t, kNumSchedResources>;
+
+inline ResourceVector ToResourceVector(const ycsbc::utils::MultiTenantResourceUsage &usage) {
+  return {usage.io_bytes_read_kb, usage.io_bytes_written_kb, usage.mem_bytes_written_kb,
+          usage.cache_usage_kb, usage.cpu_time_us};
+}
+
+// Smallest PRF allocation for a tenant below its fair share, so a quiet
+// tenant can still ramp up: 10 MB/s for IO and memtable writes, 10 ms/s of
+// worker CPU.
+const double kMinPRFAllocationKb = 10.0 * 1024;
+const double kMinPRFAllocationCpuUs = 10.0 * 1000;
+
+// `allocation` is an output parameter sized like `interval_usage`.
+inline void ComputePRFAllocation(
+  const int64_t resource_capacity, const std::vector<int64_t> &interval_usage, double ramp_up_multiplier,
+  double min_allocation, std::vector<int64_t> &allocation) {
+
+  size_t num_clients = interval_usage.size();
+  size_t num_clients_assigned = 0;
+  
+  int64_t capacity_remaining = resource_capacity;
+
+  // Idea: Just always give XX% more than usage.
+  // Allocate resources from least used to most used. 
+  // Keep going until:
+    // 1) Remaining usage exceeds remaining capacity --> evenly divide capacity
+    // 2) All resources are assigned. 
+
+  // Sort clients by usage.
+  std::vector<std::pair<int64_t, int>> usage_by_client;
+  usage_by_client.reserve(num_clients);
+  for (size_t i = 0; i < num_clients; ++i) {
+    usage_by_client.push_back(std::make_pair(interval_usage[i], i));
+  }
+  std::sort(usage_by_client.begin(), usage_by_client.end());
+
+  // Assign from lowest to highest.
+  int64_t fair_share;
+  for (size_t i = 0; i < num_clients; ++i) {
+    int64_t client_usage = usage_by_client[i].first;
+    int client_id = usage_by_client[i].second;
+    fair_share = capacity_remaining / (num_clients - num_clients_assigned);
+
+    if (client_usage < fair_share) {
+      allocation[client_id] = std::max(ramp_up_multiplier * client_usage, min_allocation);
+      capacity_remaining -= client_usage;
+      ++num_clients_assigned;
+    } else {
+      // Evenly divide remaining capacity.
+      for (size_t j = i; j < num_clients; ++j) {
+        allocation[usage_by_client[j].second] = fair_share;
+      }
+      // All done!
+      break;
+    }
+  }
+
+  // for (size_t i = 0; i < num_clients; ++i) {
+  //   if (allocation[i] > int64_t(513)) {
+  //     std::cout << "[TGRIGGS_LOG] Allocation for client " << i << " is " << allocation[i] << std::endl;
+  //   }
+  // }
+}
+
+// Weighted DRF by progressive filling. Each tenant first gets its
+// reservation; the rest of each resource is then filled along every tenant's
+// demand vector so that weighted dominant shares rise together, freezing a
+// tenant when its demand is met or a resource it needs runs out. Capacity no
+// one demanded is split by weight so idle tenants can ramp up. Demands are
+// `ramp_up_multiplier` times recent usage. `allocation` and
+// `dominant_shares` are outputs.
+inline void ComputeDRFAllocation(
+  const ResourceVector &capacity, const std::vector<ResourceVector> &usage,
+  const std::vector<double> &weights, const std::vector<ResourceVector> &reservations,
+  double ramp_up_multiplier, std::vector<ResourceVector> &allocation, std::vector<double> &dominant_shares) {
+
+  const size_t num_clients = usage.size();
+  std::vector<std::array<double, kNumSchedResources>> alloc(num_clients);
+  std::vector<std::array<double, kNumSchedResources>> residual(num_clients);
+  std::vector<std::array<double, kNumSchedResources>> rate(num_clients);
+  std::array<double, kNumSchedResources> remaining;
+  for (int r = 0; r < kNumSchedResources; ++r) {
+    remaining[r] = capacity[r];
+  }
+
+  // Reservations first, scaled down if they oversubscribe a resource.
+  for (int r = 0; r < kNumSchedResources; ++r) {
+    double reserved = 0;
+    for (size_t i = 0; i < num_clients; ++i) {
+      reserved += reservations[i][r];
+    }
+    double scale = (reserved > capacity[r] && reserved > 0) ? capacity[r] / reserved : 1.0;
+    for (size_t i = 0; i < num_clients; ++i) {
+      alloc[i][r] = reservations[i][r] * scale;
+      remaining[r] -= alloc[i][r];
+      residual[i][r] = std::max(0.0, ramp_up_multiplier * usage[i][r] - alloc[i][r]);
+    }
+  }
+
+  std::vector<bool> active(num_clients);
+  for (size_t i = 0; i < num_clients; ++i) {
+    active[i] = false;
+    for (int r = 0; r < kNumSchedResources; ++r) {
+      if (residual[i][r] > 0 && capacity[r] > 0) {
+        active[i] = true;
+      }
+    }
+  }
+
+  // Each round advances every active tenant's dominant share by `step *
+  // weight` until a tenant is satisfied or a resource is exhausted.
+  for (size_t round = 0; round <= num_clients + kNumSchedResources; ++round) {
+    std::array<double, kNumSchedResources> consumption{};
+    double step = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < num_clients; ++i) {
+      if (!active[i]) {
+        continue;
+      }
+      double dominant = 0;
+      for (int r = 0; r < kNumSchedResources; ++r) {
+        if (capacity[r] > 0) {
+          dominant = std::max(dominant, residual[i][r] / capacity[r]);
+        }
+      }
+      for (int r = 0; r < kNumSchedResources; ++r) {
+        rate[i][r] = (capacity[r] > 0 && dominant > 0) ? weights[i] * residual[i][r] / dominant : 0;
+        consumption[r] += rate[i][r];
+      }
+      step = std::min(step, dominant / weights[i]);
+    }
+    if (step == std::numeric_limits<double>::max()) {
+      break;
+    }
+    for (int r = 0; r < kNumSchedResources; ++r) {
+      if (consumption[r] > 0) {
+        step = std::min(step, std::max(0.0, remaining[r]) / consumption[r]);
+      }
+    }
+
+    for (size_t i = 0; i < num_clients; ++i) {
+      if (!active[i]) {
+        continue;
+      }
+      for (int r = 0; r < kNumSchedResources; ++r) {
+        double grant = std::min(step * rate[i][r], residual[i][r]);
+        alloc[i][r] += grant;
+        residual[i][r] -= grant;
+        remaining[r] -= grant;
+      }
+    }
+    for (size_t i = 0; i < num_clients; ++i) {
+      if (!active[i]) {
+        continue;
+      }
+      bool satisfied = true;
+      bool starved = false;
+      for (int r = 0; r < kNumSchedResources; ++r) {
+        if (residual[i][r] > 1e-6 * capacity[r]) {
+          satisfied = false;
+        }
+        if (rate[i][r] > 0 && remaining[r] <= 1e-6 * capacity[r]) {
+          starved = true;
+        }
+      }
+      if (satisfied || starved) {
+        active[i] = false;
+      }
+    }
+  }
+
+  // Work conservation: hand out what no tenant demanded, by weight.
+  double total_weight = 0;
+  for (size_t i = 0; i < num_clients; ++i) {
+    total_weight += weights[i];
+  }
+  for (int r = 0; r < kNumSchedResources; ++r) {
+    if (remaining[r] <= 0 || total_weight <= 0) {
+      continue;
+    }
+    for (size_t i = 0; i < num_clients; ++i) {
+      alloc[i][r] += remaining[r] * weights[i] / total_weight;
+    }
+  }
+
+  allocation.resize(num_clients);
+  dominant_shares.assign(num_clients, 0);
+  for (size_t i = 0; i < num_clients; ++i) {
+    for (int r = 0; r < kNumSchedResources; ++r) {
+      allocation[i][r] = static_cast<int64_t>(alloc[i][r]);
+      if (capacity[r] > 0) {
+        dominant_shares[i] = std::max(dominant_shares[i], alloc[i][r] / capacity[r]);
+      }
+    }
+  }
+}
+
+// A tenant's memtable holds about this many seconds of its allocated write
+// rate, so at that rate it flushes roughly once per period.
+const double kMemtableFillSeconds = 1.0;
+
+// Turns memtable write-rate allocations (KB/s) into per-CF RocksDB options
+// within `budget_kb` of memtable memory. Each write_buffer_size covers
+// kMemtableFillSeconds of the tenant's allocation, clamped to
+// [min_size_kb, max_size_kb]. Every tenant gets min_count memtables (sizes
+// shrink toward min_size_kb if those do not fit) and the memory left over
+// buys more memtables in proportion to the allocations, so the sum of
+// size x count stays within the budget. `write_buffer_sizes_kb` and
+// `max_write_buffer_numbers` are outputs sized like the allocations.
+inline void MemtableAllocationToRocksDbParams(
+    const std::vector<int64_t>& write_allocation_kbps, int64_t budget_kb,
+    int max_size_kb, int min_size_kb, int min_count,
+    std::vector<int>& write_buffer_sizes_kb, std::vector<int>& max_write_buffer_numbers) {
+  const size_t num_clients = write_allocation_kbps.size();
+  const int min_kb = std::max(1, min_size_kb);
+  const int max_kb = std::max(min_kb, max_size_kb);
+
+  double total_allocation = 0;
+  int64_t reserved_kb = 0;
+  for (size_t i = 0; i < num_clients; ++i) {
+    double allocation = std::max<int64_t>(0, write_allocation_kbps[i]);
+    total_allocation += allocation;
+    write_buffer_sizes_kb[i] = int(std::min<double>(max_kb, std::max<double>(min_kb, allocation * kMemtableFillSeconds)));
+    reserved_kb += int64_t(write_buffer_sizes_kb[i]) * min_count;
+  }
+
+  // Shrink the part of each size above the minimum until min_count of each fit.
+  const int64_t floor_kb = int64_t(num_clients) * min_kb * min_count;
+  if (reserved_kb > budget_kb && reserved_kb > floor_kb) {
+    double scale = std::max<double>(0, budget_kb - floor_kb) / double(reserved_kb - floor_kb);
+    reserved_kb = 0;
+    for (size_t i = 0; i < num_clients; ++i) {
+      write_buffer_sizes_kb[i] = min_kb + int((write_buffer_sizes_kb[i] - min_kb) * scale);
+      reserved_kb += int64_t(write_buffer_sizes_kb[i]) * min_count;
+    }
+  }
+
+  const int64_t remaining_kb = std::max<int64_t>(0, budget_kb - reserved_kb);
+  for (size_t i = 0; i < num_clients; ++i) {
+    double share = total_allocation > 0 ? std::max<int64_t>(0, write_allocation_kbps[i]) / total_allocation
+                                        : 1.0 / num_clients;
+    max_write_buffer_numbers[i] = min_count + int(share * remaining_kb / write_buffer_sizes_kb[i]);
+  }
+}
+
+} // namespace ycsbc
+#endif
@@ -0,0 +1,178 @@
+#include "resource_allocation.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "utils/test_util.h"
+
+namespace {
+
+using ycsbc::ComputeDRFAllocation;
+using ycsbc::ComputePRFAllocation;
+using ycsbc::ResourceVector;
+
+// Allocations are truncated to integers; allow that much slack.
+bool Near(int64_t actual, int64_t expected) {
+  return std::llabs(actual - expected) <= 1;
+}
+
+ResourceVector Vec(int64_t io_read, int64_t cache) {
+  ResourceVector v{};
+  v[ycsbc::kSchedIoRead] = io_read;
+  v[ycsbc::kSchedCache] = cache;
+  return v;
+}
+
+void CheckWithinCapacity(const std::vector<ResourceVector> &allocation, const ResourceVector &capacity) {
+  for (int r = 0; r < ycsbc::kNumSchedResources; ++r) {
+    int64_t total = 0;
+    for (const ResourceVector &a : allocation) {
+      total += a[r];
+    }
+    TEST_CHECK(total <= capacity[r]);
+  }
+}
+
+void TestDRFEqualizesDominantShares() {
+  // The DRF paper's example: 9 CPUs / 18 GB, A needs <1, 4> per task and B
+  // <3, 1>. A is memory-dominant and B CPU-dominant; both end up at a 2/3
+  // dominant share with A at <3, 12> and B at <6, 2>. The 4 GB left over
+  // is then split evenly.
+  ResourceVector capacity = Vec(9, 18);
+  std::vector<ResourceVector> usage = {Vec(10, 40), Vec(30, 10)};
+  std::vector<ResourceVector> reservations(2, ResourceVector{});
+  std::vector<double> shares;
+  std::vector<ResourceVector> alloc;
+  ComputeDRFAllocation(capacity, usage, {1, 1}, reservations, 1.0, alloc, shares);
+
+  TEST_CHECK(Near(alloc[0][ycsbc::kSchedIoRead], 3));
+  TEST_CHECK(Near(alloc[1][ycsbc::kSchedIoRead], 6));
+  TEST_CHECK(Near(alloc[0][ycsbc::kSchedCache], 12 + 2));
+  TEST_CHECK(Near(alloc[1][ycsbc::kSchedCache], 2 + 2));
+  TEST_CHECK(shares.size() == 2);
+  TEST_CHECK(shares[1] > 0.66 && shares[1] < 0.67);
+  CheckWithinCapacity(alloc, capacity);
+}
+
+void TestDRFWeights() {
+  ResourceVector capacity = Vec(100, 0);
+  std::vector<ResourceVector> usage = {Vec(200, 0), Vec(200, 0)};
+  std::vector<ResourceVector> reservations(2, ResourceVector{});
+  std::vector<double> shares;
+  std::vector<ResourceVector> alloc;
+  ComputeDRFAllocation(capacity, usage, {1, 3}, reservations, 1.0, alloc, shares);
+
+  TEST_CHECK(Near(alloc[0][ycsbc::kSchedIoRead], 25));
+  TEST_CHECK(Near(alloc[1][ycsbc::kSchedIoRead], 75));
+  CheckWithinCapacity(alloc, capacity);
+}
+
+void TestDRFReservations() {
+  ResourceVector capacity = Vec(100, 0);
+  std::vector<ResourceVector> usage = {Vec(200, 0), Vec(200, 0)};
+  std::vector<double> shares;
+
+  // The reserved 60 comes off the top; the remaining 40 is filled evenly.
+  std::vector<ResourceVector> alloc;
+  ComputeDRFAllocation(capacity, usage, {1, 1}, {Vec(60, 0), Vec(0, 0)}, 1.0, alloc, shares);
+  TEST_CHECK(Near(alloc[0][ycsbc::kSchedIoRead], 80));
+  TEST_CHECK(Near(alloc[1][ycsbc::kSchedIoRead], 20));
+  CheckWithinCapacity(alloc, capacity);
+
+  // Oversubscribed reservations are scaled down to fit.
+  ComputeDRFAllocation(capacity, usage, {1, 1}, {Vec(80, 0), Vec(120, 0)}, 1.0, alloc, shares);
+  TEST_CHECK(Near(alloc[0][ycsbc::kSchedIoRead], 40));
+  TEST_CHECK(Near(alloc[1][ycsbc::kSchedIoRead], 60));
+  CheckWithinCapacity(alloc, capacity);
+}
+
+void TestDRFSplitsIdleCapacityByWeight() {
+  ResourceVector capacity = Vec(100, 400);
+  std::vector<ResourceVector> usage(2, ResourceVector{});
+  std::vector<ResourceVector> reservations(2, ResourceVector{});
+  std::vector<double> shares;
+  std::vector<ResourceVector> alloc;
+  ComputeDRFAllocation(capacity, usage, {1, 3}, reservations, 1.0, alloc, shares);
+
+  TEST_CHECK(Near(alloc[0][ycsbc::kSchedIoRead], 25));
+  TEST_CHECK(Near(alloc[1][ycsbc::kSchedIoRead], 75));
+  TEST_CHECK(Near(alloc[0][ycsbc::kSchedCache], 100));
+  TEST_CHECK(Near(alloc[1][ycsbc::kSchedCache], 300));
+}
+
+void TestDRFMeetsSmallDemands() {
+  // Demands are `ramp_up_multiplier` times usage: 2 * 10 fits, so tenant 0
+  // gets all of it plus half the leftover; tenant 1 is capped.
+  ResourceVector capacity = Vec(100, 0);
+  std::vector<ResourceVector> usage = {Vec(10, 0), Vec(500, 0)};
+  std::vector<ResourceVector> reservations(2, ResourceVector{});
+  std::vector<double> shares;
+  std::vector<ResourceVector> alloc;
+  ComputeDRFAllocation(capacity, usage, {1, 1}, reservations, 2.0, alloc, shares);
+
+  TEST_CHECK(Near(alloc[0][ycsbc::kSchedIoRead], 20));
+  TEST_CHECK(Near(alloc[1][ycsbc::kSchedIoRead], 80));
+  CheckWithinCapacity(alloc, capacity);
+}
+
+void TestPRF() {
+  // 10 is under the 33 fair share and keeps its usage; 50 and 80 split the
+  // remaining 90.
+  std::vector<int64_t> alloc(3);
+  ComputePRFAllocation(100, {10, 50, 80}, 1.0, 0, alloc);
+  TEST_CHECK(alloc == std::vector<int64_t>({10, 45, 45}));
+
+  // An idle tenant below its fair share still gets the floor.
+  alloc.resize(2);
+  ComputePRFAllocation(100, {0, 200}, 1.0, 5, alloc);
+  TEST_CHECK(alloc[0] == 5);
+  TEST_CHECK(alloc[1] == 100);
+}
+
+void TestMemtableSizesFollowAllocation() {
+  // 1 s of each allocation, clamped to [1024, 8192] KB; count 2 each
+  // reserves 2 * (1024 + 4000 + 8192) KB and the rest of the 40000 KB
+  // budget buys memtables in proportion to the allocations.
+  std::vector<int> sizes(3), counts(3);
+  ycsbc::MemtableAllocationToRocksDbParams({100, 4000, 20000}, 40000, 8192, 1024, 2, sizes, counts);
+  TEST_CHECK(sizes == std::vector<int>({1024, 4000, 8192}));
+  TEST_CHECK(counts[0] == 2 && counts[1] >= counts[0]);
+  int64_t used_kb = 0;
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    used_kb += int64_t(sizes[i]) * counts[i];
+  }
+  TEST_CHECK(used_kb <= 40000);
+}
+
+void TestMemtablesShrinkToFitBudget() {
+  // 2 * (8192 + 8192) KB does not fit 20000 KB, so sizes shrink toward the
+  // minimum and every tenant keeps its min count.
+  std::vector<int> sizes(2), counts(2);
+  ycsbc::MemtableAllocationToRocksDbParams({50000, 50000}, 20000, 8192, 1024, 2, sizes, counts);
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    TEST_CHECK(sizes[i] >= 1024 && sizes[i] < 8192);
+    TEST_CHECK(counts[i] == 2);
+  }
+  TEST_CHECK(int64_t(sizes[0]) * counts[0] + int64_t(sizes[1]) * counts[1] <= 20000);
+
+  // Idle tenants get minimum-size memtables and split spare memory evenly.
+  ycsbc::MemtableAllocationToRocksDbParams({0, 0}, 8192, 8192, 1024, 1, sizes, counts);
+  TEST_CHECK(sizes == std::vector<int>({1024, 1024}));
+  TEST_CHECK(counts == std::vector<int>({4, 4}));
+}
+
+}  // namespace
+
+int main() {
+  TestDRFEqualizesDominantShares();
+  TestDRFWeights();
+  TestDRFReservations();
+  TestDRFSplitsIdleCapacityByWeight();
+  TestDRFMeetsSmallDemands();
+  TestPRF();
+  TestMemtableSizesFollowAllocation();
+  TestMemtablesShrinkToFitBudget();
+  std::cout << "resource_allocation_test: OK" << std::endl;
+  return 0;
+}
@@ -8,9 +8,18 @@
 #include <vector>
 #include <sstream>
 #include <fstream>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
 
+#include "behavior.h"
+#include "demand_estimator.h"
 #include "measurements.h"
+#include "resource_allocation.h"
+#include "threadpool.h"
 #include "utils/countdown_latch.h"
+#include "utils/cpu_topology.h"
 #include "utils/resources.h"
 #include "utils/utils.h"
 
@@ -19,32 +28,71 @@ namespace ycsbc {
 using ycsbc::utils::MultiTenantResourceShares;
 using ycsbc::utils::MultiTenantResourceUsage;
 
+enum class AllocationPolicy {
+  kPRF,  // Independent per-resource progressive filling
+  kDRF,  // Weighted dominant resource fairness across all resources
+};
+
 struct ResourceSchedulerOptions {
-  int rsched_interval_ms;
+  AllocationPolicy policy = AllocationPolicy::kPRF;
+  double rsched_interval_ms; // > 0, may be fractional
   int stats_dump_interval_s;
   size_t lookback_intervals;
   double ramp_up_multiplier; 
   int64_t io_read_capacity_kbps;
   int64_t io_write_capacity_kbps;
-  int64_t memtable_capacity_kb; // TODO(tgriggs): decrease this size
+  int64_t memtable_write_capacity_kbps; // KB/s all tenants may write to memtables
+  int64_t memtable_capacity_kb;         // memtable memory shared by all tenants
   int max_memtable_size_kb;
   int min_memtable_size_kb;
   int min_memtable_count;
+  bool memtable_enabled = false;           // apply memtable shares via SetOptions
+  int memtable_update_interval_ms = 1000;  // min time between SetOptions rounds
+  double memtable_change_threshold = 0.1;  // relative change that triggers an update
+  int64_t cpu_capacity_us; // worker CPU microseconds per second (tpool_threads * 1e6)
+  std::vector<double> weights;                 // DRF, per client (default 1)
+  std::vector<ResourceReservation> reservations; // DRF, per client
+  DemandEstimatorOptions estimator;
+  std::vector<std::vector<Behavior>> schedules;  // per client, for DemandEstimatorType::kSchedule
+  std::chrono::steady_clock::time_point schedule_start; // when client schedules began
 };
 
 struct ResourceShareReport {
-  ResourceShareReport(long timestamp, uint16_t client_id, MultiTenantResourceShares shares) 
-    : timestamp(timestamp), client_id(client_id), shares(shares) {}
+  ResourceShareReport(long timestamp, uint16_t client_id, MultiTenantResourceShares shares, int64_t compute_us) 
+    : timestamp(timestamp), client_id(client_id), shares(shares), compute_us(compute_us) {}
 
   long timestamp;
   uint16_t client_id;
   MultiTenantResourceShares shares;
+  int64_t compute_us; // time spent computing this iteration's allocation
 
   std::string ToCSV() const {
     std::ostringstream oss;
     oss << (timestamp) << ","
         << (client_id) << ","
-        << shares.ToCSV();
+        << shares.ToCSV() << ","
+        << (compute_us);
+    return oss.str();
+  }
+};
+
+// Last interval's forecast next to what the tenant actually used.
+struct ForecastErrorReport {
+  ForecastErrorReport(long timestamp, uint16_t client_id, const ResourceVector &forecast, const ResourceVector &actual)
+    : timestamp(timestamp), client_id(client_id), forecast(forecast), actual(actual) {}
+
+  long timestamp;
+  uint16_t client_id;
+  ResourceVector forecast;
+  ResourceVector actual;
+
+  std::string ToCSV() const {
+    std::ostringstream oss;
+    oss << (timestamp) << ","
+        << (client_id);
+    for (int r = 0; r < kNumSchedResources; ++r) {
+      oss << "," << forecast[r] << "," << actual[r];
+    }
     return oss.str();
   }
 };
@@ -66,113 +114,6 @@ struct ResourceUsageReport {
   }
 };
 
-// TODO(tgriggs): Need to ensure:
-//  1) idle clients don't take much (or any?) memtable space, 
-//  2) clients are able to quickly gain memtable capacity (e.g., bursty clients)
-// `write_buffer_sizes` and `max_write_buffer_numbers` are output parameters.
-void MemtableAllocationToRocksDbParams(
-    std::vector<int64_t> memtable_allocation, int64_t capacity_kb, 
-    int max_memtable_size_kb, int min_memtable_size_kb, int min_memtable_count,
-    std::vector<int>& write_buffer_sizes_kb, std::vector<int>& max_write_buffer_numbers) {
-
-  // TODO(tgriggs): Lot of tuning necessary here.
-
-  // for (size_t i = 0; i < memtable_allocation.size(); ++i) {
-  //   if (memtable_allocation[i] > max_memtable_size) {
-  //     // Get the integer ceiling of "Allocation / MaxMemtableSize" to get number of memtables
-  //     max_write_buffer_numbers[i] = std::max(min_memtable_count, int((memtable_allocation[i] + max_memtable_size - 1) / max_memtable_size));
-  //     // Divide the total allocation by number of memtables to get memtable size
-  //     write_buffer_sizes[i] = memtable_allocation[i] / max_write_buffer_numbers[i];
-  //   } else {
-  //     write_buffer_sizes[i] = std::max(min_memtable_size, int(memtable_allocation[i]));
-  //     max_write_buffer_numbers[i] = min_memtable_count;
-  //   }
-  //   // else if (memtable_allocation[i] <= min_memtable_size) {
-  //   //   write_buffer_sizes[i] = min_memtable_size;
-  //   //   max_write_buffer_numbers[i] = min_memtable_count;
-  //   // } else {
-  //   //   write_buffer_sizes[i] = memtable_allocation[i];
-  //   //   max_write_buffer_numbers[i] = min_memtable_count;
-  //   // }
-  // } 
-
-
-  // TODO(tgriggs): idea is to always assign all memtable space based on 1) min, 2) ratios 
-  for (size_t i = 0; i < memtable_allocation.size(); ++i) {
-    write_buffer_sizes_kb[i] = min_memtable_size_kb;
-    max_write_buffer_numbers[i] = min_memtable_count;
-  } 
-
-  // Change memtable_allocation into proportions
-  std::vector<double> proportions(memtable_allocation.size());
-  double total_allocation = 0;
-  for (size_t i = 0; i < memtable_allocation.size(); ++i) {
-    total_allocation += memtable_allocation[i];
-  }
-  for (size_t i = 0; i < memtable_allocation.size(); ++i) {
-    proportions[i] = memtable_allocation[i] / total_allocation;
-  }
-  int remaining_memtables = (capacity_kb - (memtable_allocation.size() * min_memtable_count * min_memtable_size_kb)) / min_memtable_size_kb;
-  for (size_t i = 0; i < memtable_allocation.size(); ++i) {
-    max_write_buffer_numbers[i] += int(proportions[i] * remaining_memtables);
-  }
-}
-
-std::vector<int64_t> ComputePRFAllocation(
-  const int64_t resource_capacity, std::vector<int64_t> interval_usage, double ramp_up_multiplier) {
-
-  size_t num_clients = interval_usage.size();
-  size_t num_clients_assigned = 0;
-  std::vector<bool> assigned(num_clients);
-  
-  int64_t capacity_remaining = resource_capacity;
-
-  std::vector<int64_t> allocation(num_clients);
-
-  // Idea: Just always give XX% more than usage.
-  // Allocate resources from least used to most used. 
-  // Keep going until:
-    // 1) Remaining usage exceeds remaining capacity --> evenly divide capacity
-    // 2) All resources are assigned. 
-
-  // Sort clients by usage.
-  std::vector<std::pair<int64_t, int>> usage_by_client;
-  for (size_t i = 0; i < num_clients; ++i) {
-    usage_by_client.push_back(std::make_pair(interval_usage[i], i));
-  }
-  std::sort(usage_by_client.begin(), usage_by_client.end());
-
-  // Assign from lowest to highest.
-  int64_t fair_share;
-  for (size_t i = 0; i < num_clients; ++i) {
-    int64_t client_usage = usage_by_client[i].first;
-    int client_id = usage_by_client[i].second;
-    fair_share = capacity_remaining / (num_clients - num_clients_assigned);
-
-    if (client_usage < fair_share) {
-      // TODO(tgriggs): Replace this second value with resource-specific parameters
-      allocation[client_id] = std::max(ramp_up_multiplier * client_usage, 10.0 * 1024);
-      capacity_remaining -= client_usage;
-      ++num_clients_assigned;
-    } else {
-      // Evenly divide remaining capacity.
-      for (size_t j = i; j < num_clients; ++j) {
-        allocation[usage_by_client[j].second] = fair_share;
-      }
-      // All done!
-      break;
-    }
-  }
-
-  // for (size_t i = 0; i < num_clients; ++i) {
-  //   if (allocation[i] > int64_t(513)) {
-  //     std::cout << "[TGRIGGS_LOG] Allocation for client " << i << " is " << allocation[i] << std::endl;
-  //   }
-  // }
-
-  return allocation;
-}
-
 void DumpResourceReports(
   std::vector<ResourceUsageReport>& usage_report_buffer,
   std::ofstream& usage_logfile,
@@ -187,29 +128,41 @@ void DumpResourceReports(
 }
 
 void WriteResourceShareHeader(std::ofstream& logfile) {
-  logfile << "timestamp,client_id,write_rate_limit_kbs,read_rate_limit_kbs,write_buffer_size_kb,max_write_buffer_number" << std::endl;
+  logfile << "timestamp,client_id,write_rate_limit_kbs,read_rate_limit_kbs,write_buffer_size_kb,max_write_buffer_number,cpu_share_us,memtable_alloc_kbs,cache_alloc_kb,dominant_share,compute_us" << std::endl;
+}
+
+void WriteForecastErrorHeader(std::ofstream& logfile) {
+  logfile << "timestamp,client_id,io_read_forecast,io_read_actual,io_write_forecast,io_write_actual,"
+          << "mem_write_forecast,mem_write_actual,cache_forecast_kb,cache_actual_kb,cpu_forecast,cpu_actual" << std::endl;
 }
 
 void WriteResourceUsageHeader(std::ofstream& logfile) {
-  logfile << "timestamp,client_id,io_write_kbs,io_read_kbs,mem_write_kbs" << std::endl;
+  logfile << "timestamp,client_id,io_write_kbs,io_read_kbs,mem_write_kbs,cpu_us_per_s,cache_usage_kb,blob_read_kbs,blob_write_kbs" << std::endl;
+}
+
+// True if any CF's memtable budget moved by more than `threshold` since it
+// was last applied. `changed` lists the CFs to update.
+bool MemtableSharesChanged(
+    const std::vector<int>& write_buffer_sizes_kb, const std::vector<int>& max_write_buffer_numbers,
+    const std::vector<int>& applied_sizes_kb, const std::vector<int>& applied_numbers,
+    double threshold, std::vector<ycsbc::utils::MemtableShare>& changed) {
+  changed.clear();
+  for (size_t i = 0; i < write_buffer_sizes_kb.size(); ++i) {
+    int64_t budget = int64_t(write_buffer_sizes_kb[i]) * max_write_buffer_numbers[i];
+    int64_t applied = int64_t(applied_sizes_kb[i]) * applied_numbers[i];
+    if (applied == 0 || std::abs(budget - applied) > threshold * applied) {
+      changed.push_back({int(i), int64_t(write_buffer_sizes_kb[i]) * 1024, max_write_buffer_numbers[i]});
+    }
+  }
+  return !changed.empty();
 }
 
 void CentralResourceSchedulerThread(
   std::vector<ycsbc::DB *> dbs, ycsbc::Measurements *measurements, 
   std::vector<ycsbc::Measurements*> per_client_measurements, ResourceSchedulerOptions options,
-  ycsbc::utils::CountDownLatch *latch) {
-
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(17, &cpuset);
-    std::cout << "[FAIRDB_LOG] Pinning rsched thread to core " << 17 << std::endl;
-    int rc = pthread_setaffinity_np(pthread_self(),
-                                    sizeof(cpu_set_t), &cpuset);
-    if (rc != 0)
-    {
-      fprintf(stderr, "Couldn't set thread affinity.\n");
-      std::exit(1);
-    }
+  ycsbc::utils::CountDownLatch *latch, const ycsbc::utils::CpuLayout *cpu_layout, ThreadPool *threadpool) {
+
+    cpu_layout->PinCurrentThread("rsched", 0, 17, "rsched thread");
 
     std::string resource_share_filename = "logs/resource_shares.log";
     std::ofstream resource_share_logfile;
@@ -229,6 +182,10 @@ void CentralResourceSchedulerThread(
     }
     WriteResourceUsageHeader(resource_usage_logfile);
 
+    std::ofstream forecast_error_logfile;
+    forecast_error_logfile.open("logs/forecast_error.log", std::ios::out | std::ios::trunc);
+    WriteForecastErrorHeader(forecast_error_logfile);
+
     // TODO(tgriggs): Wait for DB init before querying for stats. This is a hack.
     std::this_thread::sleep_for(std::chrono::seconds(5));
 
@@ -237,6 +194,8 @@ void CentralResourceSchedulerThread(
     share_report_buffer.reserve(buffer_dump_threshold);
     std::vector<ResourceUsageReport> usage_report_buffer;
     usage_report_buffer.reserve(buffer_dump_threshold);
+    std::vector<ForecastErrorReport> forecast_report_buffer;
+    forecast_report_buffer.reserve(buffer_dump_threshold);
     
     // TODO(tgriggs): fix this, which pulls from dbs, but if num threads is
     // less, then it breaks
@@ -246,81 +205,155 @@ void CentralResourceSchedulerThread(
     std::vector<MultiTenantResourceUsage> prev_usage(num_clients);
     bool first_time = true;
 
-    // std::vector<MultiTenantResourceUsage> interval_usage(num_clients);
-    std::deque<std::vector<MultiTenantResourceUsage>> interval_usages;
+    // Per-tenant block caches, for cache usage and DRF cache capacity.
+    std::vector<std::shared_ptr<rocksdb::Cache>> tenant_caches(num_clients);
+    int64_t cache_capacity_kb = 0;
+    for (size_t i = 0; i < num_clients; ++i) {
+      for (size_t j = 0; j < dbs.size() && tenant_caches[i] == nullptr; ++j) {
+        tenant_caches[i] = dbs[j]->GetCacheByClientIdx(i);
+      }
+      if (tenant_caches[i]) {
+        cache_capacity_kb += tenant_caches[i]->GetCapacity() / 1024;
+      }
+    }
+
+    ResourceVector drf_capacity;
+    drf_capacity[kSchedIoRead] = options.io_read_capacity_kbps;
+    drf_capacity[kSchedIoWrite] = options.io_write_capacity_kbps;
+    drf_capacity[kSchedMemtable] = options.memtable_write_capacity_kbps;
+    drf_capacity[kSchedCache] = cache_capacity_kb;
+    drf_capacity[kSchedCpu] = options.cpu_capacity_us;
+    std::vector<double> drf_weights(num_clients, 1.0);
+    std::vector<ResourceVector> drf_reservations(num_clients, ResourceVector{});
+    for (size_t i = 0; i < num_clients; ++i) {
+      if (i < options.weights.size()) {
+        drf_weights[i] = options.weights[i];
+      }
+      if (i < options.reservations.size()) {
+        const ResourceReservation &res = options.reservations[i];
+        drf_reservations[i] = {res.io_read_kbps, res.io_write_kbps, res.memtable_write_kbps, res.cache_kb, res.cpu_us};
+      }
+    }
+
+    // Last memtable options pushed to RocksDB; zero until the first update.
+    std::vector<int> applied_write_buffer_sizes_kb(num_clients, 0);
+    std::vector<int> applied_max_write_buffer_numbers(num_clients, 0);
+    std::vector<ycsbc::utils::MemtableShare> memtable_updates;
+    memtable_updates.reserve(num_clients);
+    auto last_memtable_update = std::chrono::steady_clock::now() - std::chrono::milliseconds(options.memtable_update_interval_ms);
+
+    std::unique_ptr<DemandEstimator> estimator = NewDemandEstimator(options.estimator, num_clients, options.schedules);
+    std::vector<ResourceVector> observed(num_clients);
+    std::vector<ResourceVector> demand(num_clients);
+    bool have_forecast = false;
 
     // Add counters and accumulators for timing statistics
     int64_t iteration_count = 0;
-    int64_t get_usage_total = 0;
+    int64_t read_usage_total = 0;
     int64_t update_shares_total = 0;
     int64_t iteration_total = 0;
 
-    while (!latch->AwaitForMs(options.rsched_interval_ms)) {
+    // Reused every interval so the scheduling loop does not allocate.
+    std::vector<MultiTenantResourceUsage> total_usage(num_clients);
+    std::vector<MultiTenantResourceUsage> interval_usage(num_clients);
+    std::vector<int64_t> io_read_usage(num_clients);
+    std::vector<int64_t> io_write_usage(num_clients);
+    std::vector<int64_t> cpu_usage(num_clients);
+    std::vector<int64_t> memtable_usage(num_clients);
+    std::vector<int64_t> io_read_allocation(num_clients);
+    std::vector<int64_t> io_write_allocation(num_clients);
+    std::vector<int64_t> cpu_allocation(num_clients);
+    std::vector<int64_t> memtable_allocation(num_clients);
+    std::vector<ResourceVector> drf_allocation(num_clients);
+    std::vector<double> dominant_shares(num_clients);
+    std::vector<int> write_buffer_sizes(num_clients);
+    std::vector<int> max_write_buffer_numbers(num_clients);
+
+    const long rsched_interval_us = std::lround(options.rsched_interval_ms * 1000);
+    while (!latch->AwaitForUs(rsched_interval_us)) {
       auto iteration_start_time = std::chrono::high_resolution_clock::now();
       
-      // TODO(tgriggs): Optimize this path next -- are any locks taken?
       // Get total resource usage from all DBs
       auto start_time = std::chrono::high_resolution_clock::now();
-      std::vector<MultiTenantResourceUsage> total_usage = dbs[0]->GetResourceUsage();
+      dbs[0]->ReadResourceUsage(total_usage);
+      for (size_t i = 0; i < num_clients; ++i) {
+        total_usage[i].cpu_time_us = threadpool->getCpuTimeNs(i) / 1000;
+        total_usage[i].cache_usage_kb = tenant_caches[i] ? tenant_caches[i]->GetUsage() / 1024 : 0;
+      }
       auto end_time = std::chrono::high_resolution_clock::now();
       auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-      get_usage_total += duration.count();
-      std::vector<MultiTenantResourceUsage> interval_usage(num_clients);
+      read_usage_total += duration.count();
       for (size_t i = 0; i < num_clients; ++i) {
         interval_usage[i] = ycsbc::utils::ComputeResourceUsageRateInInterval(prev_usage[i], total_usage[i], options.rsched_interval_ms);
         // TODO(tgriggs): correct this!!! switch to kb/s??
       }
 
-      // Push the current interval usage to the back of the deque
-      interval_usages.push_back(interval_usage);
-      if (interval_usages.size() > options.lookback_intervals) {
-        interval_usages.pop_front();
-      }
-
       prev_usage = total_usage;
       if (first_time) {
         first_time = false;
         continue;
       }
-      // std::cout << "[TGRIGGS_LOG] Usage in this interval: " << std::endl;
-      // for (const auto& usage : interval_usage) {
-      //   std::cout << usage.ToString();
-      // }
-
-      // TODO(tgriggs): just update the resource usage struct to vectors so i don't have
-      //                have to do this restructuring 
-      std::vector<MultiTenantResourceUsage> max_interval_usage(num_clients);
+
+      auto now_us = std::chrono::time_point_cast<std::chrono::microseconds>( std::chrono::high_resolution_clock::now());
+      long now = now_us.time_since_epoch().count();
+      int64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - options.schedule_start).count();
       for (size_t i = 0; i < num_clients; ++i) {
-        for (const auto& usage : interval_usages) {
-            max_interval_usage[i].io_bytes_read_kb = std::max(max_interval_usage[i].io_bytes_read_kb, usage[i].io_bytes_read_kb);
-            max_interval_usage[i].io_bytes_written_kb = std::max(max_interval_usage[i].io_bytes_written_kb, usage[i].io_bytes_written_kb);
-            // max_interval_usage[i].mem_bytes_written_kb = std::max(max_interval_usage[i].mem_bytes_written_kb, usage[i].mem_bytes_written_kb);
+        observed[i] = ToResourceVector(interval_usage[i]);
+        if (have_forecast) {
+          forecast_report_buffer.push_back(ForecastErrorReport(now, i, demand[i], observed[i]));
         }
       }
-      std::vector<int64_t> io_read_usage;
-      std::vector<int64_t> io_write_usage;
-      // std::vector<int64_t> memtable_usage;
-      for (const auto& usage : max_interval_usage) {
-        io_read_usage.push_back(usage.io_bytes_read_kb);
-        io_write_usage.push_back(usage.io_bytes_written_kb);
-        // memtable_usage.push_back(usage.mem_bytes_written_kb);
+      estimator->Observe(elapsed_ms, observed);
+      estimator->Forecast(elapsed_ms, demand);
+      have_forecast = true;
+
+      for (size_t i = 0; i < num_clients; ++i) {
+        io_read_usage[i] = demand[i][kSchedIoRead];
+        io_write_usage[i] = demand[i][kSchedIoWrite];
+        cpu_usage[i] = demand[i][kSchedCpu];
+        memtable_usage[i] = demand[i][kSchedMemtable];
+      }
+      auto compute_start_time = std::chrono::high_resolution_clock::now();
+      if (options.policy == AllocationPolicy::kDRF) {
+        ComputeDRFAllocation(drf_capacity, demand, drf_weights, drf_reservations, options.ramp_up_multiplier,
+                             drf_allocation, dominant_shares);
+        for (size_t i = 0; i < num_clients; ++i) {
+          io_read_allocation[i] = drf_allocation[i][kSchedIoRead];
+          io_write_allocation[i] = drf_allocation[i][kSchedIoWrite];
+          cpu_allocation[i] = drf_allocation[i][kSchedCpu];
+          memtable_allocation[i] = drf_allocation[i][kSchedMemtable];
+          res_opts[i].memtable_alloc_kbs = drf_allocation[i][kSchedMemtable];
+          res_opts[i].cache_alloc_kb = drf_allocation[i][kSchedCache];
+          res_opts[i].dominant_share = dominant_shares[i];
+        }
+      } else {
+        ComputePRFAllocation(options.io_read_capacity_kbps, io_read_usage, options.ramp_up_multiplier,
+                             kMinPRFAllocationKb, io_read_allocation);
+        ComputePRFAllocation(options.io_write_capacity_kbps, io_write_usage, options.ramp_up_multiplier,
+                             kMinPRFAllocationKb, io_write_allocation);
+        ComputePRFAllocation(options.cpu_capacity_us, cpu_usage, options.ramp_up_multiplier,
+                             kMinPRFAllocationCpuUs, cpu_allocation);
+        ComputePRFAllocation(options.memtable_write_capacity_kbps, memtable_usage, options.ramp_up_multiplier,
+                             kMinPRFAllocationKb, memtable_allocation);
+        for (size_t i = 0; i < num_clients; ++i) {
+          res_opts[i].memtable_alloc_kbs = memtable_allocation[i];
+        }
       }
-      std::vector<int64_t> io_read_allocation = ComputePRFAllocation(options.io_read_capacity_kbps, io_read_usage, options.ramp_up_multiplier);
-      std::vector<int64_t> io_write_allocation = ComputePRFAllocation(options.io_write_capacity_kbps, io_write_usage, options.ramp_up_multiplier);
-      // std::vector<int64_t> memtable_allocation = ComputePRFAllocation(options.memtable_capacity_kb, memtable_usage, options.ramp_up_multiplier);
-      // std::vector<int> write_buffer_sizes(num_clients);
-      // std::vector<int> max_write_buffer_numbers(num_clients);
-      // MemtableAllocationToRocksDbParams(
-      //   memtable_allocation, options.memtable_capacity_kb, 
-      //   options.max_memtable_size_kb, options.min_memtable_size_kb,
-      //   options.min_memtable_count,
-      //   write_buffer_sizes, max_write_buffer_numbers);
+      int64_t compute_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - compute_start_time).count();
+      MemtableAllocationToRocksDbParams(
+        memtable_allocation, options.memtable_capacity_kb,
+        options.max_memtable_size_kb, options.min_memtable_size_kb,
+        options.min_memtable_count,
+        write_buffer_sizes, max_write_buffer_numbers);
 
       for (size_t i = 0; i < num_clients; ++i) {
-        // res_opts[i].max_write_buffer_number = max_write_buffer_numbers[i];
-        // res_opts[i].write_buffer_size_kb = write_buffer_sizes[i];
+        res_opts[i].max_write_buffer_number = max_write_buffer_numbers[i];
+        res_opts[i].write_buffer_size_kb = write_buffer_sizes[i];
         res_opts[i].read_rate_limit_kbs = io_read_allocation[i];
         res_opts[i].write_rate_limit_kbs = io_write_allocation[i];
+        res_opts[i].cpu_share_us = cpu_allocation[i];
         // if (i == 0) {
         //   res_opts[i].write_rate_limit_kbs = std::max(res_opts[i].write_rate_limit_kbs, uint32_t(100));
         //   // res_opts[i].read_rate_limit = 500 / 4;
@@ -330,21 +363,41 @@ void CentralResourceSchedulerThread(
       // TODO(tgriggs): Access a single "Resource" object instead of going through a single DB
       auto update_start_time = std::chrono::high_resolution_clock::now();
       dbs[0]->UpdateResourceShares(res_opts);
+      if (threadpool->dequeuePolicy() == DequeuePolicy::kCpuShare) {
+        threadpool->setCpuShares(cpu_allocation);
+      }
+      // SetOptions installs a new superversion per CF, so memtable shares are
+      // pushed at most once per memtable_update_interval_ms and only for CFs
+      // whose budget moved past the threshold.
+      if (options.memtable_enabled &&
+          std::chrono::steady_clock::now() - last_memtable_update >= std::chrono::milliseconds(options.memtable_update_interval_ms) &&
+          MemtableSharesChanged(write_buffer_sizes, max_write_buffer_numbers,
+                                applied_write_buffer_sizes_kb, applied_max_write_buffer_numbers,
+                                options.memtable_change_threshold, memtable_updates)) {
+        dbs[0]->UpdateMemtableShares(memtable_updates);
+        for (const auto& share : memtable_updates) {
+          applied_write_buffer_sizes_kb[share.client_id] = write_buffer_sizes[share.client_id];
+          applied_max_write_buffer_numbers[share.client_id] = max_write_buffer_numbers[share.client_id];
+        }
+        last_memtable_update = std::chrono::steady_clock::now();
+      }
       auto update_end_time = std::chrono::high_resolution_clock::now();
       auto update_duration = std::chrono::duration_cast<std::chrono::microseconds>(update_end_time - update_start_time);
       update_shares_total += update_duration.count();
 
       // TODO(tgriggs): Add new shares to a log buffer, then dump at threshold
-      auto now_us = std::chrono::time_point_cast<std::chrono::microseconds>( std::chrono::high_resolution_clock::now());
-      long now = now_us.time_since_epoch().count();
       for (size_t i = 0; i < res_opts.size(); ++i) {
         usage_report_buffer.push_back(ResourceUsageReport(now, i, interval_usage[i]));
-        share_report_buffer.push_back(ResourceShareReport(now, i, res_opts[i]));
+        share_report_buffer.push_back(ResourceShareReport(now, i, res_opts[i], compute_us));
       }
       if (share_report_buffer.size() > buffer_dump_threshold || usage_report_buffer.size() > buffer_dump_threshold) {
         DumpResourceReports(usage_report_buffer, resource_usage_logfile, share_report_buffer, resource_share_logfile);
         usage_report_buffer.clear();
         share_report_buffer.clear();
+        for (const auto& report : forecast_report_buffer) {
+          forecast_error_logfile << report.ToCSV() << std::endl;
+        }
+        forecast_report_buffer.clear();
       }
 
       auto iteration_end_time = std::chrono::high_resolution_clock::now();
@@ -354,13 +407,13 @@ void CentralResourceSchedulerThread(
       iteration_count++;
       if (iteration_count % 1000 == 0) {
         std::cout << "Average timings over last 1000 intervals:" << std::endl;
-        std::cout << "  GetResourceUsage(): " << (get_usage_total / 1000) << " microseconds" << std::endl;
+        std::cout << "  ReadResourceUsage(): " << (read_usage_total / 1000) << " microseconds" << std::endl;
         std::cout << "  UpdateResourceShares(): " << (update_shares_total / 1000) << " microseconds" << std::endl;
         std::cout << "  Total iteration: " << (iteration_total / 1000) << " microseconds" << std::endl;
         std::cout << "----------------------------------------" << std::endl;
         
         // Reset accumulators
-        get_usage_total = 0;
+        read_usage_total = 0;
         update_shares_total = 0;
         iteration_total = 0;
       }
@@ -0,0 +1,24 @@
+#ifndef YCSB_C_TENANT_H_
+#define YCSB_C_TENANT_H_
+
+#include <string>
+
+namespace rocksdb {
+class ColumnFamilyHandle;
+}
+
+namespace ycsbc {
+
+// What a DB binding needs to serve one tenant, resolved once from the
+// client's YAML `cf` (DB::ResolveTenant) so operations can skip parsing the
+// table name. Bindings without a registry only fill table and client_id.
+struct TenantHandle {
+  std::string table;                        // YAML `cf`
+  int client_id = -1;
+  rocksdb::ColumnFamilyHandle *cf = nullptr;
+  int cf_index = -1;                        // slot in the binding's per-CF option tables
+};
+
+} // namespace ycsbc
+
+#endif // YCSB_C_TENANT_H_
@@ -6,58 +6,88 @@
 #include <utility>
 #include <thread>
 #include <cassert>
+#include <algorithm>
+#include <ctime>
 
-void ThreadPool::start(int num_threads, int num_clients){
-    std::cout << "[FAIRDB_LOG] Starting thread pool with " << num_threads << " worker threads, " << num_clients << " clients\n";
+namespace {
+int64_t threadCpuTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+}
+
+void ThreadPool::start(int num_threads, int num_clients, const ycsbc::utils::CpuLayout *cpu_layout,
+                       DequeuePolicy policy){
+    std::cout << "[FAIRDB_LOG] Starting thread pool with " << num_threads << " worker threads, " << num_clients << " clients"
+              << (policy == DequeuePolicy::kCpuShare ? " (cpu_share)" : "") << "\n";
     int num_cpus = std::thread::hardware_concurrency();
 
     assert(num_clients > 0);
     running = true;
     this->num_clients = num_clients;
+    this->policy = policy;
 
     // Initialize per-client queues
     worklists.resize(num_clients);
+    queue_depths.reset(new std::atomic<int64_t>[num_clients]);
+    queue_space.reset(new QueueSpace[num_clients]);
+    cpu_time_ns.reset(new std::atomic<int64_t>[num_clients]);
+    virtual_time.reset(new std::atomic<double>[num_clients]);
+    cpu_weights.reset(new std::atomic<double>[num_clients]);
+    for (int i = 0; i < num_clients; i++) {
+        queue_depths[i] = 0;
+        cpu_time_ns[i] = 0;
+        virtual_time[i] = 0.0;
+        cpu_weights[i] = 1.0;
+    }
+    queue_capacities.assign(num_clients, 0);
+    block_when_full.assign(num_clients, true);
 
     // Start worker threads
     for (int i = 0; i < num_threads; i++) {
         std::thread *t;
-        t = new std::thread([this, i] {
-            // cpu_set_t cpuset;
-            // CPU_ZERO(&cpuset);
-            // CPU_SET(24 + i, &cpuset);
-            // std::cout << "[FAIRDB_LOG] Pinning worker thread " << i << " to core " << (24 + i) << std::endl;
-            // int rc = pthread_setaffinity_np(pthread_self(),
-            //                                 sizeof(cpu_set_t), &cpuset);
-            // if (rc != 0) {
-            //     fprintf(stderr, "Couldn't set thread affinity.\n");
-            //     std::exit(1);
-            // }
-
+        t = new std::thread([this, i, cpu_layout] {
+            // Workers stay unpinned unless the layout names a "workers" role.
+            if (cpu_layout) {
+                cpu_layout->PinCurrentThread("workers", i, -1, "worker thread " + std::to_string(i));
+            }
 
             size_t client_index = i % this->num_clients; // Use this->num_clients
             while (this->running) {
                 std::function<void*()> job;
-                bool job_found = false;
-
-                // Try to find a job from the queues in round-robin order
-                for (int attempt = 0; attempt < this->num_clients; ++attempt) {
-                    size_t idx = (client_index + attempt) % this->num_clients;
-                    if (this->worklists[idx].try_dequeue(job)) {
-                        job_found = true;
-                        client_index = (idx + 1) % this->num_clients; // Move to next client
-                        break;
-                    }
-                }
+                size_t job_client = 0;
+                double start_tag = 0;
+                bool job_found = this->policy == DequeuePolicy::kCpuShare
+                                     ? tryDequeueCpuShare(client_index, job, job_client, start_tag)
+                                     : tryDequeueRoundRobin(client_index, job, job_client);
 
                 if (job_found) {
+                    this->pending_jobs.fetch_sub(1, std::memory_order_relaxed);
+                    int64_t depth = this->queue_depths[job_client].fetch_sub(1, std::memory_order_relaxed);
+                    if (depth >= this->queue_capacities[job_client] && this->queue_capacities[job_client] > 0 &&
+                        this->block_when_full[job_client]) {
+                        // Lock so the wakeup cannot land between the producer's
+                        // depth check and its wait.
+                        { std::lock_guard<std::mutex> lock(this->queue_space[job_client].mutex); }
+                        this->queue_space[job_client].cv.notify_one();
+                    }
+                    int64_t cpu_start = threadCpuTimeNs();
                     job();
+                    int64_t cpu_used = threadCpuTimeNs() - cpu_start;
+                    this->cpu_time_ns[job_client].fetch_add(cpu_used, std::memory_order_relaxed);
+                    if (this->policy == DequeuePolicy::kCpuShare) {
+                        double weight = this->cpu_weights[job_client].load(std::memory_order_relaxed);
+                        this->virtual_time[job_client].store(start_tag + cpu_used / weight, std::memory_order_relaxed);
+                    }
                 } else {
-                    // No job found, wait on condition variable
+                    // No job found; sleep until one is queued. The count is
+                    // raised under cv_mutex, so a job queued after the failed
+                    // dequeue cannot slip past the wait.
                     std::unique_lock<std::mutex> lock(this->cv_mutex);
-                    if (!this->running) {
-                        break;
-                    }
-                    this->cv.wait(lock);
+                    this->cv.wait(lock, [this] {
+                        return !this->running || this->pending_jobs.load(std::memory_order_relaxed) > 0;
+                    });
                     if (!this->running) {
                         break;
                     }
@@ -81,6 +111,67 @@ void ThreadPool::start(int num_threads, int num_clients){
     }
 }
 
+bool ThreadPool::tryDequeueRoundRobin(size_t &client_index, std::function<void*()> &job, size_t &job_client) {
+    // Try to find a job from the queues in round-robin order
+    for (int attempt = 0; attempt < num_clients; ++attempt) {
+        size_t idx = (client_index + attempt) % num_clients;
+        if (worklists[idx].try_dequeue(job)) {
+            job_client = idx;
+            client_index = (idx + 1) % num_clients; // Move to next client
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::tryDequeueCpuShare(size_t &client_index, std::function<void*()> &job, size_t &job_client,
+                                    double &start_tag) {
+    const double pool_vt = pool_virtual_time.load(std::memory_order_relaxed);
+    // Pick the backlogged client with the smallest start tag.
+    int best = -1;
+    double best_tag = 0;
+    for (int idx = 0; idx < num_clients; ++idx) {
+        if (queue_depths[idx].load(std::memory_order_relaxed) <= 0) {
+            continue;
+        }
+        double tag = std::max(virtual_time[idx].load(std::memory_order_relaxed), pool_vt);
+        if (best < 0 || tag < best_tag) {
+            best = idx;
+            best_tag = tag;
+        }
+    }
+    if (best >= 0 && worklists[best].try_dequeue(job)) {
+        job_client = best;
+        start_tag = best_tag;
+        // Workers race here with tags read at different times; only ever
+        // move the pool's virtual time forward.
+        double pool_vt_now = pool_virtual_time.load(std::memory_order_relaxed);
+        while (pool_vt_now < best_tag &&
+               !pool_virtual_time.compare_exchange_weak(pool_vt_now, best_tag, std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+    // Another worker drained it first; take whatever is available.
+    if (tryDequeueRoundRobin(client_index, job, job_client)) {
+        start_tag = std::max(virtual_time[job_client].load(std::memory_order_relaxed), pool_vt);
+        return true;
+    }
+    return false;
+}
+
+int64_t ThreadPool::getCpuTimeNs(int client_id) const {
+    if (client_id < 0 || client_id >= num_clients) {
+        return 0;
+    }
+    return cpu_time_ns[client_id].load(std::memory_order_relaxed);
+}
+
+void ThreadPool::setCpuShares(const std::vector<int64_t> &shares) {
+    for (size_t i = 0; i < shares.size() && i < static_cast<size_t>(num_clients); ++i) {
+        cpu_weights[i].store(std::max<double>(1.0, shares[i]), std::memory_order_relaxed);
+    }
+}
+
 ThreadPool::~ThreadPool() {
     stop();
 }
@@ -89,7 +180,13 @@ void ThreadPool::stop() {
     running = false;
 
     // Notify all worker threads to wake up and exit
+    { std::lock_guard<std::mutex> lock(cv_mutex); }
     cv.notify_all();
+    // Release producers blocked on a full queue
+    for (int i = 0; i < num_clients && queue_space; i++) {
+        { std::lock_guard<std::mutex> lock(queue_space[i].mutex); }
+        queue_space[i].cv.notify_all();
+    }
 
     for (auto t : threads){
         t->join();
@@ -111,22 +208,60 @@ std::future<void*> ThreadPool::dispatch(int client_id, std::function<void*()> f)
     };
 
     // Enqueue the job to the appropriate client's queue
+    queue_depths[client_id].fetch_add(1, std::memory_order_relaxed);
     worklists[client_id].enqueue(std::move(wrappedJob));
 
     // Notify one worker thread that a new job is available
-    cv.notify_one();
+    notifyJobQueued();
 
     return result;
 }
 
-void ThreadPool::async_dispatch(int client_id, std::function<void*()> f) {
+bool ThreadPool::async_dispatch(int client_id, std::function<void*()> f) {
     // std::cout << "TGRIGGS: enqueue " << client_id << "'s request\n";
     assert(client_id >= 0 && client_id < num_clients);
+    const int64_t capacity = queue_capacities[client_id];
+    if (capacity > 0 && queue_depths[client_id].load(std::memory_order_relaxed) >= capacity) {
+        if (!block_when_full[client_id]) {
+            return false;
+        }
+        QueueSpace &space = queue_space[client_id];
+        std::unique_lock<std::mutex> lock(space.mutex);
+        space.cv.wait(lock, [this, client_id, capacity] {
+            return queue_depths[client_id].load(std::memory_order_relaxed) < capacity || !running;
+        });
+        if (!running) {
+            return false;
+        }
+    }
+    queue_depths[client_id].fetch_add(1, std::memory_order_relaxed);
     worklists[client_id].enqueue(std::move(f));
     // Notify one worker thread that a new job is available
+    notifyJobQueued();
+    return true;
+}
+
+void ThreadPool::notifyJobQueued() {
+    {
+        std::lock_guard<std::mutex> lock(cv_mutex);
+        pending_jobs.fetch_add(1, std::memory_order_relaxed);
+    }
     cv.notify_one();
 }
 
+void ThreadPool::setQueueCapacity(int client_id, int64_t capacity, bool block) {
+    assert(client_id >= 0 && client_id < num_clients);
+    queue_capacities[client_id] = capacity;
+    block_when_full[client_id] = block;
+}
+
+bool ThreadPool::queueWouldBlock(int client_id) const {
+    assert(client_id >= 0 && client_id < num_clients);
+    const int64_t capacity = queue_capacities[client_id];
+    return capacity > 0 && block_when_full[client_id] &&
+           queue_depths[client_id].load(std::memory_order_relaxed) >= capacity;
+}
+
 moodycamel::BlockingConcurrentQueue<std::function<void*()>>& ThreadPool::getClientQueue(int client_id) {
     assert(client_id >= 0 && client_id < num_clients);
     return worklists[client_id];
@@ -8,8 +8,16 @@
 #include <condition_variable>
 #include <mutex>
 #include <atomic>
+#include <memory>
 #include "concurrentqueue/concurrentqueue.h"
 #include "concurrentqueue/blockingconcurrentqueue.h"
+#include "utils/cpu_topology.h"
+
+// How workers pick the next client queue to serve.
+enum class DequeuePolicy {
+    kRoundRobin,  // Rotate over non-empty client queues
+    kCpuShare,    // Serve the client furthest behind its CPU share
+};
 
 class ThreadPool {
 public:
@@ -19,25 +27,68 @@ public:
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool& operator=(const ThreadPool&) = delete;
 
-    void start(int num_threads = 1, int num_clients = 1);
+    void start(int num_threads = 1, int num_clients = 1, const ycsbc::utils::CpuLayout *cpu_layout = nullptr,
+               DequeuePolicy policy = DequeuePolicy::kRoundRobin);
     void stop();
     std::future<void*> dispatch(int client_id, std::function<void*()> f);
-    void async_dispatch(int client_id, std::function<void*()> f);
+    // Returns false if the client's queue is full and it does not block.
+    bool async_dispatch(int client_id, std::function<void*()> f);
+
+    // Bounds a client's queue to `capacity` pending jobs (0 = unbounded). When
+    // full, async_dispatch() either waits for a worker to drain it or rejects.
+    // Must be called after start().
+    void setQueueCapacity(int client_id, int64_t capacity, bool block_when_full);
+    // True if async_dispatch() would currently wait for space in the client's queue.
+    bool queueWouldBlock(int client_id) const;
+
+    // Total worker thread CPU time spent running this client's jobs.
+    int64_t getCpuTimeNs(int client_id) const;
+
+    // Relative CPU weights for DequeuePolicy::kCpuShare, one per client.
+    void setCpuShares(const std::vector<int64_t> &shares);
+    DequeuePolicy dequeuePolicy() const { return policy; }
 
     // Get access to the producer side of a specific client queue
     moodycamel::BlockingConcurrentQueue<std::function<void*()>>& getClientQueue(int client_id);
 
 private:
+    bool tryDequeueRoundRobin(size_t &client_index, std::function<void*()> &job, size_t &job_client);
+    bool tryDequeueCpuShare(size_t &client_index, std::function<void*()> &job, size_t &job_client, double &start_tag);
+    void notifyJobQueued();
+
     std::atomic<bool> running;
+    DequeuePolicy policy = DequeuePolicy::kRoundRobin;
     std::vector<std::thread*> threads;
     int num_clients;
 
     // Vector of per-client queues
     std::vector<moodycamel::BlockingConcurrentQueue<std::function<void*()>>> worklists;
 
-    // Synchronization primitives
+    // Per-client pending job counts and limits
+    std::unique_ptr<std::atomic<int64_t>[]> queue_depths;
+    std::vector<int64_t> queue_capacities;
+    std::vector<bool> block_when_full;
+    // Signalled when a worker takes a job from a full blocking queue.
+    struct QueueSpace {
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    std::unique_ptr<QueueSpace[]> queue_space;
+
+    // Per-client CPU accounting and start-time fair queuing state. A client's
+    // virtual time advances by cpu_ns / weight; the pool virtual time is the
+    // start tag of the most recently picked job, so a client returning from
+    // idle cannot claim CPU for the time it was away.
+    std::unique_ptr<std::atomic<int64_t>[]> cpu_time_ns;
+    std::unique_ptr<std::atomic<double>[]> virtual_time;
+    std::unique_ptr<std::atomic<double>[]> cpu_weights;
+    std::atomic<double> pool_virtual_time{0.0};
+
+    // Synchronization primitives. pending_jobs counts queued jobs across all
+    // clients; it is only raised under cv_mutex so idle workers can wait on it.
     std::mutex cv_mutex;
     std::condition_variable cv;
+    std::atomic<int64_t> pending_jobs{0};
 };
 
 #endif  // _LIB_THREADPOOL_H_
@@ -1,25 +1,252 @@
-// #include <iostream>
-// #include "threadpool.h"
+#include "threadpool.h"
 
-// // For sleeping test
-// #include <chrono>
-// #include <thread> 
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
 
-// void* TestPrint() {
-//   fprintf(stderr, "Success!\n");
-//   return nullptr;
-// }
+#include "utils/test_util.h"
 
-// int main(void) {
-//   ThreadPool tp;
+namespace {
+int64_t threadCpuTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
 
-//   tp.start(1);
+void spinCpu(int64_t ns) {
+    int64_t start = threadCpuTimeNs();
+    while (threadCpuTimeNs() - start < ns) {
+    }
+}
 
-//   std::function<void*()> f = &TestPrint;
+// Polls `done` for up to 10s; a hung pool fails the test instead of stalling it.
+void waitUntil(const std::function<bool()> &done) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done()) {
+        TEST_CHECK(std::chrono::steady_clock::now() < deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
 
-//   tp.dispatch(f);
-//   tp.dispatch(f);
-//   tp.dispatch(f);
+// Occupies a pool's only worker until Release(), so tests control queue depth.
+class Gate {
+public:
+    Gate() : released_(release_.get_future().share()) {}
 
-//   std::this_thread::sleep_for(std::chrono::seconds(1));
-// }
\ No newline at end of file
+    void Hold(ThreadPool &tp, int client_id) {
+        std::shared_future<void> released = released_;
+        std::atomic<bool> *entered = &entered_;
+        TEST_CHECK(tp.async_dispatch(client_id, [released, entered]() -> void* {
+            entered->store(true);
+            released.wait();
+            return nullptr;
+        }));
+        waitUntil([this] { return entered_.load(); });
+    }
+
+    void Release() { release_.set_value(); }
+
+private:
+    std::promise<void> release_;
+    std::shared_future<void> released_;
+    std::atomic<bool> entered_{false};
+};
+
+void testDispatch() {
+    ThreadPool tp;
+    tp.start(2, 2);
+    std::vector<std::future<void*>> results;
+    std::vector<int> values(100);
+    for (int i = 0; i < 100; i++) {
+        int *value = &values[i];
+        results.push_back(tp.dispatch(i % 2, [value]() -> void* { return value; }));
+    }
+    for (int i = 0; i < 100; i++) {
+        TEST_CHECK(results[i].get() == &values[i]);
+    }
+    tp.stop();
+}
+
+void testBoundedQueueRejects() {
+    ThreadPool tp;
+    tp.start(1, 1);
+    tp.setQueueCapacity(0, 2, false);
+    std::atomic<int> ran{0};
+    auto job = [&ran]() -> void* {
+        ran++;
+        return nullptr;
+    };
+
+    Gate gate;
+    gate.Hold(tp, 0);
+    TEST_CHECK(tp.async_dispatch(0, job));
+    TEST_CHECK(tp.async_dispatch(0, job));
+    TEST_CHECK(!tp.async_dispatch(0, job));
+    TEST_CHECK(!tp.queueWouldBlock(0));
+
+    gate.Release();
+    waitUntil([&ran] { return ran.load() == 2; });
+    TEST_CHECK(tp.async_dispatch(0, job));
+    waitUntil([&ran] { return ran.load() == 3; });
+    tp.stop();
+}
+
+void testBoundedQueueBlocks() {
+    ThreadPool tp;
+    tp.start(1, 1);
+    tp.setQueueCapacity(0, 2, true);
+    std::atomic<int> ran{0};
+    auto job = [&ran]() -> void* {
+        ran++;
+        return nullptr;
+    };
+
+    Gate gate;
+    gate.Hold(tp, 0);
+    TEST_CHECK(tp.async_dispatch(0, job));
+    TEST_CHECK(tp.async_dispatch(0, job));
+    TEST_CHECK(tp.queueWouldBlock(0));
+
+    std::atomic<bool> returned{false};
+    bool accepted = false;
+    std::thread producer([&] {
+        accepted = tp.async_dispatch(0, job);
+        returned = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    TEST_CHECK(!returned.load());
+
+    // Draining one job makes room for the blocked producer.
+    gate.Release();
+    producer.join();
+    TEST_CHECK(accepted);
+    waitUntil([&ran] { return ran.load() == 3; });
+    TEST_CHECK(!tp.queueWouldBlock(0));
+    tp.stop();
+}
+
+void testStopReleasesBlockedProducer() {
+    ThreadPool tp;
+    tp.start(1, 1);
+    tp.setQueueCapacity(0, 1, true);
+    auto job = []() -> void* { return nullptr; };
+
+    Gate gate;
+    gate.Hold(tp, 0);
+    TEST_CHECK(tp.async_dispatch(0, job));
+
+    std::atomic<bool> returned{false};
+    bool accepted = true;
+    std::thread producer([&] {
+        accepted = tp.async_dispatch(0, job);
+        returned = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    TEST_CHECK(!returned.load());
+
+    // stop() joins the worker, which is still parked in the gate job.
+    std::thread stopper([&tp] { tp.stop(); });
+    waitUntil([&returned] { return returned.load(); });
+    TEST_CHECK(!accepted);
+    gate.Release();
+    stopper.join();
+    producer.join();
+}
+
+void testNoLostWakeup() {
+    // One job in flight at a time, like a CLOSED client: the worker is idle
+    // whenever a job is queued, so a missed wakeup would park it for good.
+    ThreadPool tp;
+    tp.start(1, 1);
+    std::atomic<int> ran{0};
+    for (int i = 1; i <= 20000; i++) {
+        TEST_CHECK(tp.async_dispatch(0, [&ran]() -> void* {
+            ran++;
+            return nullptr;
+        }));
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (ran.load() < i) {
+            TEST_CHECK(std::chrono::steady_clock::now() < deadline);
+            std::this_thread::yield();
+        }
+    }
+    tp.stop();
+}
+
+// Queues `per_client` jobs of `job_ns` CPU each for clients 0 and 1 behind a
+// gate, then returns the order the single worker ran them in.
+std::vector<int> runBacklog(DequeuePolicy policy, const std::vector<int64_t> &shares, int per_client,
+                            int64_t job_ns) {
+    ThreadPool tp;
+    tp.start(1, 3, nullptr, policy);
+    tp.setCpuShares(shares);
+    std::mutex order_mutex;
+    std::vector<int> order;
+
+    // Park the worker on a third client so it does not skew clients 0 and 1.
+    Gate gate;
+    gate.Hold(tp, 2);
+    for (int i = 0; i < per_client; i++) {
+        for (int client = 0; client < 2; client++) {
+            TEST_CHECK(tp.async_dispatch(client, [client, job_ns, &order_mutex, &order]() -> void* {
+                spinCpu(job_ns);
+                std::lock_guard<std::mutex> lock(order_mutex);
+                order.push_back(client);
+                return nullptr;
+            }));
+        }
+    }
+    gate.Release();
+    waitUntil([&] {
+        std::lock_guard<std::mutex> lock(order_mutex);
+        return order.size() == static_cast<size_t>(2 * per_client);
+    });
+    tp.stop();
+    TEST_CHECK(tp.getCpuTimeNs(0) >= per_client * job_ns);
+    return order;
+}
+
+void testRoundRobinAlternates() {
+    std::vector<int> order = runBacklog(DequeuePolicy::kRoundRobin, {}, 10, 0);
+    for (size_t i = 1; i < order.size(); i++) {
+        TEST_CHECK(order[i] != order[i - 1]);
+    }
+}
+
+void testCpuShareOrdering() {
+    // With shares 1:3 and equal-cost jobs, client 1 runs three jobs for each
+    // of client 0's while both are backlogged.
+    std::vector<int> order = runBacklog(DequeuePolicy::kCpuShare, {1, 3, 1}, 40, 2 * 1000 * 1000);
+    int client1 = 0;
+    for (int i = 0; i < 40; i++) {
+        client1 += order[i];
+    }
+    TEST_CHECK(client1 >= 25 && client1 <= 35);
+
+    // Equal shares interleave.
+    order = runBacklog(DequeuePolicy::kCpuShare, {1, 1, 1}, 20, 2 * 1000 * 1000);
+    client1 = 0;
+    for (int i = 0; i < 20; i++) {
+        client1 += order[i];
+    }
+    TEST_CHECK(client1 >= 7 && client1 <= 13);
+}
+}
+
+int main() {
+    testDispatch();
+    testBoundedQueueRejects();
+    testBoundedQueueBlocks();
+    testStopReleasesBlockedProducer();
+    testNoLostWakeup();
+    testRoundRobinAlternates();
+    testCpuShareOrdering();
+    std::cout << "threadpool_test: OK" << std::endl;
+    return 0;
+}
@@ -16,8 +16,11 @@
 #include <future>
 #include <chrono>
 #include <iomanip>
+#include <algorithm>
+#include <map>
 #include <yaml-cpp/yaml.h>
 
+#include "cache_controller.h"
 #include "client.h"
 #include "core_workload.h"
 #include "db_factory.h"
@@ -26,11 +29,13 @@
 #include "resource_scheduler.h"
 #include "threadpool.h"
 #include "utils/countdown_latch.h"
+#include "utils/cpu_topology.h"
 #include "utils/rate_limit.h"
 #include "utils/resources.h"
 #include "utils/timer.h"
 #include "utils/utils.h"
 #include "rocksdb/rocksdb_db.h"
+#include "rocksdb/tenant_cache.h"
 #include <rocksdb/cache.h>
 #include <rocksdb/advanced_cache.h>
 #include "db_wrapper.h"
@@ -50,19 +55,10 @@ void ParseCommandLine(int argc, const char *argv[], ycsbc::utils::Properties &pr
 
 void StatusThread(ycsbc::Measurements *measurements, std::vector<ycsbc::Measurements *> per_client_measurements,
                   std::vector<ycsbc::Measurements *> queuing_delay_measurements,
-                  ycsbc::utils::CountDownLatch *latch, double interval_ms, std::vector<ycsbc::DB *> dbs)
+                  ycsbc::utils::CountDownLatch *latch, ycsbc::utils::CountDownLatch *init_latch, double interval_ms,
+                  std::vector<ycsbc::DB *> dbs, const ycsbc::utils::CpuLayout *cpu_layout)
 {
-  cpu_set_t cpuset;
-  CPU_ZERO(&cpuset);
-  CPU_SET(16, &cpuset);
-  std::cout << "[FAIRDB_LOG] Pinning status thread to core " << 16 << std::endl;
-  int rc = pthread_setaffinity_np(pthread_self(),
-                                  sizeof(cpu_set_t), &cpuset);
-  if (rc != 0)
-  {
-    fprintf(stderr, "Couldn't set thread affinity.\n");
-    std::exit(1);
-  }
+  cpu_layout->PinCurrentThread("status", 0, 16, "status thread");
 
   std::string client_stats_filename = "logs/client_stats.log";
   std::ofstream client_stats_logfile;
@@ -72,7 +68,31 @@ void StatusThread(ycsbc::Measurements *measurements, std::vector<ycsbc::Measurem
     // TODO(tgriggs):  Handle file open failure, propagate exception
     // throw std::ios_base::failure("Failed to open the file.");
   }
-  client_stats_logfile << "timestamp,client_id,op_type,count,max,min,avg,10p,25p,50p,75p,90p,99p,99.9p,global_cache_usage,global_cache_capacity,global_cache_hits,global_cache_misses,user_cache_usage,user_cache_reserved,user_cache_hits,user_cache_misses" << std::endl;
+  client_stats_logfile << "timestamp,client_id,op_type,count,max,min,avg,10p,25p,50p,75p,90p,99p,99.9p,global_cache_usage,global_cache_capacity,global_cache_hits,global_cache_misses,user_cache_usage,user_cache_reserved,user_cache_hits,user_cache_misses,secondary_cache_hits,secondary_cache_misses,row_cache_hits,row_cache_misses" << std::endl;
+
+  // The NUMA and WAL logs depend on options applied in Init, so wait until
+  // every client has opened its DB before deciding which logs to write.
+  init_latch->Await();
+
+  // Per-node view of tenants bound with rocksdb.numa_nodes
+  const bool numa_bound = !dbs.empty() && !dbs[0]->GetNumaStats().empty();
+  std::ofstream numa_stats_logfile;
+  if (numa_bound)
+  {
+    numa_stats_logfile.open("logs/numa_stats.log", std::ios::out | std::ios::trunc);
+    numa_stats_logfile << "timestamp,node,local_ops,remote_ops,cache_hits,cache_misses" << std::endl;
+  }
+  // Interval WAL traffic when any tenant has rocksdb.wal enabled
+  ycsbc::utils::WalStats wal_stats;
+  const bool wal_enabled = !dbs.empty() && dbs[0]->GetWalStats(wal_stats);
+  std::ofstream wal_stats_logfile;
+  if (wal_enabled)
+  {
+    wal_stats_logfile.open("logs/wal_stats.log", std::ios::out | std::ios::trunc);
+    wal_stats_logfile << "timestamp,wal_bytes,wal_syncs,avg_sync_us" << std::endl;
+  }
+  std::vector<uint64_t> interval_cache_hits(per_client_measurements.size());
+  std::vector<uint64_t> interval_cache_misses(per_client_measurements.size());
 
   time_point<system_clock> start = system_clock::now();
   bool done = false;
@@ -117,10 +137,37 @@ void StatusThread(ycsbc::Measurements *measurements, std::vector<ycsbc::Measurem
 
       uint64_t cache_hits = 0;
       uint64_t cache_misses = 0;
-      if (block_cache) {
+      if (block_cache && strcmp(block_cache->Name(), ycsbc::TenantQuotaCache::kClassName()) == 0) {
+        auto *tenant_cache = static_cast<ycsbc::TenantQuotaCache *>(block_cache.get());
+        cache_hits = tenant_cache->GetAndResetTenantHits();
+        cache_misses = tenant_cache->GetAndResetTenantMisses();
+      } else if (block_cache) {
         cache_hits = block_cache->GetAndResetHits();
         cache_misses = block_cache->GetAndResetMisses();
       }
+      uint64_t secondary_cache_hits = 0;
+      uint64_t secondary_cache_misses = 0;
+      std::shared_ptr<rocksdb::SecondaryCache> secondary_cache = nullptr;
+      for (size_t k = 0; k < dbs.size() && secondary_cache == nullptr; ++k) {
+        secondary_cache = dbs[k]->GetSecondaryCacheByClientIdx(i);
+      }
+      if (secondary_cache && strcmp(secondary_cache->Name(), ycsbc::TenantSecondaryCache::kClassName()) == 0) {
+        auto *tenant_secondary = static_cast<ycsbc::TenantSecondaryCache *>(secondary_cache.get());
+        secondary_cache_hits = tenant_secondary->GetAndResetHits();
+        secondary_cache_misses = tenant_secondary->GetAndResetMisses();
+      }
+      uint64_t row_cache_hits = 0;
+      uint64_t row_cache_misses = 0;
+      std::shared_ptr<rocksdb::Cache> row_cache = dbs.empty() ? nullptr : dbs[0]->GetRowCache();
+      if (row_cache && strcmp(row_cache->Name(), ycsbc::TenantRowCache::kClassName()) == 0) {
+        auto *tenant_row_cache = static_cast<ycsbc::TenantRowCache *>(row_cache.get());
+        if (i < tenant_row_cache->NumTenants()) {
+          row_cache_hits = tenant_row_cache->Tenant(i)->GetAndResetTenantHits();
+          row_cache_misses = tenant_row_cache->Tenant(i)->GetAndResetTenantMisses();
+        }
+      }
+      interval_cache_hits[i] = cache_hits;
+      interval_cache_misses[i] = cache_misses;
 
       int cache_usage = 0;
       int cache_capacity = 0;
@@ -148,6 +195,8 @@ void StatusThread(ycsbc::Measurements *measurements, std::vector<ycsbc::Measurem
         client_stats_logfile << duration_since_epoch_ms << ',' << i << ',' << csv << ',' << std::to_string(cache_usage) 
           << ',' << std::to_string(cache_capacity) << ',' << std::to_string(cache_hits) << ',' << std::to_string(cache_misses)
           << ',' << std::to_string(user_cache_usage) << ',' << std::to_string(user_cache_reserved) << ',' << std::to_string(user_cache_hits) << ',' << std::to_string(user_cache_misses)
+          << ',' << std::to_string(secondary_cache_hits) << ',' << std::to_string(secondary_cache_misses)
+          << ',' << std::to_string(row_cache_hits) << ',' << std::to_string(row_cache_misses)
           << std::endl;
 
         if (should_print) {
@@ -171,10 +220,33 @@ void StatusThread(ycsbc::Measurements *measurements, std::vector<ycsbc::Measurem
       std::vector<std::string> op_csv_stats = queuing_delay_measurements[i]->GetCSVStatusMsg(/*noop=*/false);
       for (const auto &csv : op_csv_stats)
       {
-        client_stats_logfile << duration_since_epoch_ms << ',' << i << ',' << csv << "0,0,0,0,0,0,0,0,0" << std::endl;
+        client_stats_logfile << duration_since_epoch_ms << ',' << i << ',' << csv << "0,0,0,0,0,0,0,0,0,0,0,0,0" << std::endl;
       }
       queuing_delay_measurements[i]->Reset();
     }
+    if (numa_bound)
+    {
+      std::map<int, std::vector<uint64_t>> per_node; // local, remote, hits, misses
+      std::vector<ycsbc::utils::TenantNumaStats> numa_stats = dbs[0]->GetNumaStats();
+      for (size_t i = 0; i < numa_stats.size() && i < interval_cache_hits.size(); ++i)
+      {
+        std::vector<uint64_t> &node = per_node.emplace(numa_stats[i].node, std::vector<uint64_t>(4, 0)).first->second;
+        node[0] += numa_stats[i].local_ops;
+        node[1] += numa_stats[i].remote_ops;
+        node[2] += interval_cache_hits[i];
+        node[3] += interval_cache_misses[i];
+      }
+      for (const auto &[node, counts] : per_node)
+      {
+        numa_stats_logfile << duration_since_epoch_ms << ',' << node << ',' << counts[0] << ',' << counts[1]
+                           << ',' << counts[2] << ',' << counts[3] << std::endl;
+      }
+    }
+    if (wal_enabled && dbs[0]->GetWalStats(wal_stats))
+    {
+      wal_stats_logfile << duration_since_epoch_ms << ',' << wal_stats.bytes_written << ',' << wal_stats.syncs
+                        << ',' << wal_stats.avg_sync_us << std::endl;
+    }
     // Print DB-wide and CF-wide stats -- only need to use a single client
     // std::cout << "DB stats:\n";
     // dbs[0]->PrintDbStats();
@@ -298,8 +370,19 @@ int main(const int argc, const char *argv[])
   }
   std::vector<ycsbc::ClientConfig> clients = ycsbc::loadClientBehaviors(ClientConfigFile);
   const int num_threads = clients.size();
+  // A client's `lsm:` block reaches the RocksDB binding as rocksdb.lsm.<cf>.<option>.
+  for (const auto &client : clients)
+  {
+    for (const auto &option : client.lsm)
+    {
+      props.SetProperty("rocksdb.lsm." + client.cf + "." + option.first, option.second);
+    }
+  }
   std::cout << "[FAIRDB_LOG] Number of clients: " << num_threads << std::endl;
 
+  // role -> cpu map, e.g. "clients:0-15;workers:16-31@numa0;status:auto"
+  const ycsbc::utils::CpuLayout cpu_layout(props.GetProperty("cpu.layout", ""), ycsbc::utils::CpuTopology());
+
   ycsbc::Measurements *measurements = ycsbc::CreateMeasurements(&props);
   if (measurements == nullptr)
   {
@@ -320,11 +403,26 @@ int main(const int argc, const char *argv[])
 
   std::vector<ycsbc::Measurements *> queuing_delay_measurements = ycsbc::CreatePerClientMeasurements(&props, num_threads);
 
+  const bool enable_cache_controller = ycsbc::utils::StrToBool(props.GetProperty("cache_controller", "false"));
+  std::shared_ptr<ycsbc::utils::TenantMrcs> tenant_mrcs;
+  if (enable_cache_controller)
+  {
+    // Rows are charged at fieldcount x fieldlength, the loaded row size
+    // (an upper bound under a non-constant field_len_dist).
+    const size_t row_bytes =
+        std::stoul(props.GetProperty(ycsbc::CoreWorkload::FIELD_COUNT_PROPERTY, ycsbc::CoreWorkload::FIELD_COUNT_DEFAULT)) *
+        std::stoul(props.GetProperty(ycsbc::CoreWorkload::FIELD_LENGTH_PROPERTY, ycsbc::CoreWorkload::FIELD_LENGTH_DEFAULT));
+    tenant_mrcs = std::make_shared<ycsbc::utils::TenantMrcs>(
+        num_threads, std::stod(props.GetProperty("cache_ctl_sample_rate", "0.01")),
+        std::stoul(props.GetProperty("cache_ctl_max_keys", "65536")), row_bytes);
+  }
+
   std::vector<ycsbc::DB *> dbs;
   for (int i = 0; i < num_threads; i++)
   {
     // ycsbc::DB *db = ycsbc::DBFactory::CreateDB(&props, measurements);
-    ycsbc::DB *db = ycsbc::DBFactory::CreateDBWithPerClientStats(&props, measurements, per_client_measurements, per_client_bytes_written);
+    ycsbc::DB *db = ycsbc::DBFactory::CreateDBWithPerClientStats(&props, measurements, per_client_measurements,
+                                                                   per_client_bytes_written, tenant_mrcs, &cpu_layout);
     if (db == nullptr)
     {
       std::cerr << "Unknown database name " << props["dbname"] << std::endl;
@@ -391,8 +489,24 @@ int main(const int argc, const char *argv[])
   // FairScheduler scheduler;
   const int tpool_threads = std::stoi(props.GetProperty("tpool_threads", "1"));
   const int num_cfs = std::stoi(props.GetProperty("rocksdb.num_cfs", "1"));
+  // rr: round-robin over client queues; cpu_share: weighted by worker CPU time
+  const std::string tpool_policy = props.GetProperty("tpool_policy", "rr");
+  if (tpool_policy != "rr" && tpool_policy != "cpu_share")
+  {
+    std::cerr << "Unknown tpool_policy " << tpool_policy << std::endl;
+    exit(1);
+  }
   ThreadPool threadpool;
-  threadpool.start(/*num_threads=*/tpool_threads, /*num_clients=*/num_cfs);
+  threadpool.start(/*num_threads=*/tpool_threads, /*num_clients=*/num_cfs, &cpu_layout,
+                   tpool_policy == "cpu_share" ? DequeuePolicy::kCpuShare : DequeuePolicy::kRoundRobin);
+  for (const auto &client : clients)
+  {
+    if (client.queue.capacity > 0)
+    {
+      threadpool.setQueueCapacity(client.client_id, client.queue.capacity,
+                                  /*block_when_full=*/client.queue.policy == ycsbc::QUEUE_BLOCK);
+    }
+  }
 
   // transaction phase
   if (do_transaction)
@@ -403,6 +517,8 @@ int main(const int argc, const char *argv[])
     std::string rate_file = props.GetProperty("limit.file", "");
 
     ycsbc::utils::CountDownLatch latch(num_threads);
+    // Counted down once per client after its DB is initialized.
+    ycsbc::utils::CountDownLatch init_latch(num_threads);
     ycsbc::utils::Timer<double> timer;
 
     timer.Start();
@@ -410,9 +526,14 @@ int main(const int argc, const char *argv[])
     if (show_status)
     {
       status_future = std::async(std::launch::async, StatusThread,
-                                 measurements, per_client_measurements, queuing_delay_measurements, &latch, status_interval_ms, dbs);
+                                 measurements, per_client_measurements, queuing_delay_measurements, &latch, &init_latch,
+                                 status_interval_ms, dbs, &cpu_layout);
     }
+    // 0 keeps one pinned thread per client; otherwise clients are spread
+    // round-robin over this many driver threads.
+    const int client_driver_threads = std::stoi(props.GetProperty("client_driver_threads", "0"));
     std::vector<std::future<long long>> client_threads;
+    std::vector<std::future<void>> driver_threads;
     std::vector<ycsbc::utils::RateLimiter *> rate_limiters;
     for (int i = 0; i < num_threads; ++i)
     {
@@ -423,18 +544,42 @@ int main(const int argc, const char *argv[])
         rlim = new ycsbc::utils::RateLimiter(per_thread_ops, per_thread_ops);
       }
       rate_limiters.push_back(rlim);
-      client_threads.emplace_back(
-          std::async(std::launch::async,
-                     [dbs, &wl, do_load, &latch, &clients, &queuing_delay_measurements, rlim, &threadpool, i]()
-                     {
-                       return ycsbc::ClientThread(
-                           dbs[i], &wl,
-                           0, false, !do_load, true, &latch, rlim,
-                           &threadpool, &clients[i], queuing_delay_measurements);
-                     }));
-      // client_threads.emplace_back(std::async(std::launch::async, ycsbc::ClientThread, dbs[i], &wl,
-      //                                        0, false, !do_load, true, &latch, rlim,
-      //                                        &threadpool, &clients[i], queuing_delay_measurements));
+    }
+    const auto schedule_start = std::chrono::steady_clock::now();
+    if (client_driver_threads > 0)
+    {
+      const int num_drivers = std::min(client_driver_threads, num_threads);
+      std::vector<std::vector<size_t>> driver_clients(num_drivers);
+      for (int i = 0; i < num_threads; ++i)
+      {
+        driver_clients[i % num_drivers].push_back(i);
+      }
+      for (int d = 0; d < num_drivers; ++d)
+      {
+        driver_threads.emplace_back(
+            std::async(std::launch::async,
+                       [dbs, &wl, do_load, &latch, &init_latch, &clients, &queuing_delay_measurements, &rate_limiters, &threadpool, &driver_clients, &cpu_layout, d]()
+                       {
+                         ycsbc::ClientDriverThread(d, dbs, &wl, driver_clients[d], !do_load, &latch, &init_latch, rate_limiters,
+                                                   &threadpool, &clients, queuing_delay_measurements, &cpu_layout);
+                       }));
+      }
+    }
+    else
+    {
+      for (int i = 0; i < num_threads; ++i)
+      {
+        ycsbc::utils::RateLimiter *rlim = rate_limiters[i];
+        client_threads.emplace_back(
+            std::async(std::launch::async,
+                       [dbs, &wl, do_load, &latch, &init_latch, &clients, &queuing_delay_measurements, rlim, &threadpool, &cpu_layout, i]()
+                       {
+                         return ycsbc::ClientThread(
+                             dbs[i], &wl,
+                             0, false, !do_load, true, &latch, &init_latch, rlim,
+                             &threadpool, &clients[i], queuing_delay_measurements, &cpu_layout);
+                       }));
+      }
     }
 
     std::future<void> rlim_future;
@@ -448,20 +593,97 @@ int main(const int argc, const char *argv[])
     {
       ycsbc::ResourceSchedulerOptions rsched_options;
       rsched_options.rsched_interval_ms = std::stod(props.GetProperty("rsched_interval_ms"));
+      if (!(rsched_options.rsched_interval_ms > 0))
+      {
+        throw ycsbc::utils::Exception("rsched_interval_ms must be positive");
+      }
       rsched_options.stats_dump_interval_s = 5;
       rsched_options.lookback_intervals = std::stoi(props.GetProperty("lookback_intervals"));
       rsched_options.ramp_up_multiplier = std::stod(props.GetProperty("rsched_rampup_multiplier"));
       rsched_options.io_read_capacity_kbps = std::stoi(props.GetProperty("io_read_capacity_kbps"));
       rsched_options.io_write_capacity_kbps = std::stoi(props.GetProperty("io_write_capacity_kbps"));
+      // Memtables drain at the flush rate, so the write-rate capacity
+      // defaults to the IO write capacity.
+      rsched_options.memtable_write_capacity_kbps =
+          std::stoll(props.GetProperty("memtable_write_capacity_kbps", props.GetProperty("io_write_capacity_kbps")));
       rsched_options.memtable_capacity_kb = std::stoi(props.GetProperty("memtable_capacity_kb"));
       rsched_options.max_memtable_size_kb = std::stoi(props.GetProperty("max_memtable_size_kb"));
       rsched_options.min_memtable_size_kb = std::stoi(props.GetProperty("min_memtable_size_kb"));
       rsched_options.min_memtable_count = std::stoi(props.GetProperty("min_memtable_count"));
+      rsched_options.cpu_capacity_us = int64_t(tpool_threads) * 1'000'000;
+      rsched_options.memtable_enabled = ycsbc::utils::StrToBool(props.GetProperty("rsched_memtable", "false"));
+      rsched_options.memtable_update_interval_ms = std::stoi(props.GetProperty("rsched_memtable_interval_ms", "1000"));
+      rsched_options.memtable_change_threshold = std::stod(props.GetProperty("rsched_memtable_change_threshold", "0.1"));
+      const std::string rsched_policy = props.GetProperty("rsched_policy", "prf");
+      if (rsched_policy == "drf")
+      {
+        rsched_options.policy = ycsbc::AllocationPolicy::kDRF;
+      }
+      else if (rsched_policy != "prf")
+      {
+        std::cerr << "Unknown rsched_policy " << rsched_policy << std::endl;
+        exit(1);
+      }
+      const std::string rsched_estimator = props.GetProperty("rsched_estimator", "max");
+      if (rsched_estimator == "max")
+      {
+        rsched_options.estimator.type = ycsbc::DemandEstimatorType::kMaxWindow;
+      }
+      else if (rsched_estimator == "ewma")
+      {
+        rsched_options.estimator.type = ycsbc::DemandEstimatorType::kEWMA;
+      }
+      else if (rsched_estimator == "holt_winters")
+      {
+        rsched_options.estimator.type = ycsbc::DemandEstimatorType::kHoltWinters;
+      }
+      else if (rsched_estimator == "schedule")
+      {
+        rsched_options.estimator.type = ycsbc::DemandEstimatorType::kSchedule;
+      }
+      else
+      {
+        std::cerr << "Unknown rsched_estimator " << rsched_estimator << std::endl;
+        exit(1);
+      }
+      rsched_options.estimator.lookback_intervals = rsched_options.lookback_intervals;
+      rsched_options.estimator.alpha = std::stod(props.GetProperty("rsched_estimator_alpha", "0.3"));
+      rsched_options.estimator.beta = std::stod(props.GetProperty("rsched_estimator_beta", "0.1"));
+      rsched_options.estimator.gamma = std::stod(props.GetProperty("rsched_estimator_gamma", "0.1"));
+      rsched_options.estimator.season_intervals = std::stoi(props.GetProperty("rsched_estimator_season_intervals", "0"));
+      rsched_options.estimator.interval_ms = rsched_options.rsched_interval_ms;
+      rsched_options.estimator.lookahead_ms = std::stoi(props.GetProperty("rsched_estimator_lookahead_ms", "0"));
+      rsched_options.schedule_start = schedule_start;
+      rsched_options.schedules.resize(num_threads);
+      rsched_options.weights.resize(num_threads, 1.0);
+      rsched_options.reservations.resize(num_threads);
+      for (const auto &client : clients)
+      {
+        rsched_options.weights[client.client_id] = client.weight;
+        rsched_options.reservations[client.client_id] = client.reservation;
+        rsched_options.schedules[client.client_id] = client.behaviors;
+      }
       rsched_future = std::async(std::launch::async, ycsbc::CentralResourceSchedulerThread, dbs,
-                                 measurements, per_client_measurements, rsched_options, &latch);
+                                 measurements, per_client_measurements, rsched_options, &latch, &cpu_layout, &threadpool);
     }
 
-    assert((int)client_threads.size() == num_threads);
+    std::future<void> cachectl_future;
+    if (enable_cache_controller)
+    {
+      ycsbc::CacheControllerOptions cachectl_options;
+      cachectl_options.interval_ms = std::stoi(props.GetProperty("cache_ctl_interval_ms", "5000"));
+      cachectl_options.units = std::stoi(props.GetProperty("cache_ctl_units", "64"));
+      cachectl_options.min_fraction = std::stod(props.GetProperty("cache_ctl_min_fraction", "0.25"));
+      cachectl_options.min_cache_kb.resize(num_threads, 0);
+      for (const auto &client : clients)
+      {
+        cachectl_options.min_cache_kb[client.client_id] = client.reservation.cache_kb;
+      }
+      cachectl_future = std::async(std::launch::async, ycsbc::CacheControllerThread, dbs, tenant_mrcs,
+                                   cachectl_options, &latch, &init_latch, &cpu_layout);
+    }
+
+    assert(client_driver_threads > 0 || (int)client_threads.size() == num_threads);
 
     if (show_status)
     {
@@ -471,6 +693,10 @@ int main(const int argc, const char *argv[])
     {
       rsched_future.wait();
     }
+    if (enable_cache_controller)
+    {
+      cachectl_future.wait();
+    }
   }
 
   for (int i = 0; i < num_threads; i++)
@@ -80,6 +80,8 @@ set -x  # This will print the command before executing it
   -p min_memtable_count=$((16)) \
   -p max_memtable_size_kb=$((64 * 1024)) \
   -p min_memtable_size_kb=$((64 * 1024)) \
+  -p rsched_memtable=false \
+  -p rsched_memtable_interval_ms=1000 \
   | tee status_thread.txt &
 set +x
 
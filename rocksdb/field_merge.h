@@ -0,0 +1,217 @@
+//
+//  field_merge.h
+//  YCSB-cpp
+//
+//  Field-level merge operator, so an UPDATE can be a blind write of the
+//  fields it changes instead of a read-modify-write of the whole row.
+//
+
+#ifndef YCSB_C_ROCKSDB_FIELD_MERGE_H_
+#define YCSB_C_ROCKSDB_FIELD_MERGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <rocksdb/merge_operator.h>
+#include <rocksdb/slice.h>
+
+#include "core/db.h"
+#include "row_schema.h"
+
+namespace ycsbc {
+
+///
+/// Merges field patches into rows. Rows keep the RocksdbDB::SerializeRow
+/// layout (fixed32 lengths); a patch is the changed fields with varint32
+/// lengths, which saves six bytes per field on every merge operand:
+///
+///   patch := (varint32 name_len, name, varint32 value_len, value)*
+///
+/// A later operand wins per field and fields the row lacks are appended.
+/// With a RowSchema (rocksdb.format=schema) rows use its layout instead and
+/// every patched field must be in the schema. PartialMergeMulti folds
+/// stacked patches into one, so reads and compactions above the base row
+/// handle a single operand. Fields are kept as slices into the inputs and
+/// copied once, into the output.
+///
+class FieldPatchMergeOperator : public rocksdb::MergeOperator {
+ public:
+  explicit FieldPatchMergeOperator(std::shared_ptr<const RowSchema> schema = nullptr)
+    : schema_(std::move(schema)) {}
+
+  static void EncodePatch(const std::vector<DB::Field> &fields, std::string &patch) {
+    for (const DB::Field &field : fields) {
+      PutVarint32(patch, field.name.size());
+      patch.append(field.name);
+      PutVarint32(patch, field.value.size());
+      patch.append(field.value);
+    }
+  }
+
+  const char *Name() const override { return "FieldPatchMergeOperator"; }
+
+  bool FullMergeV2(const MergeOperationInput &merge_in, MergeOperationOutput *merge_out) const override {
+    if (schema_ != nullptr) {
+      return MergeIntoSchemaRow(merge_in, merge_out->new_value);
+    }
+    FieldList fields;
+    if (merge_in.existing_value != nullptr && !DecodeRow(*merge_in.existing_value, fields)) {
+      return false;
+    }
+    for (const rocksdb::Slice &operand : merge_in.operand_list) {
+      if (!ApplyPatch(operand, fields)) {
+        return false;
+      }
+    }
+    std::string &row = merge_out->new_value;
+    row.clear();
+    for (const auto &field : fields) {
+      PutFixed32Prefixed(row, field.first);
+      PutFixed32Prefixed(row, field.second);
+    }
+    return true;
+  }
+
+  bool PartialMergeMulti(const rocksdb::Slice &key, const std::deque<rocksdb::Slice> &operand_list,
+                         std::string *new_value, rocksdb::Logger *logger) const override {
+    FieldList fields;
+    for (const rocksdb::Slice &operand : operand_list) {
+      if (!ApplyPatch(operand, fields)) {
+        return false;
+      }
+    }
+    new_value->clear();
+    for (const auto &field : fields) {
+      PutVarint32(*new_value, field.first.size());
+      new_value->append(field.first.data(), field.first.size());
+      PutVarint32(*new_value, field.second.size());
+      new_value->append(field.second.data(), field.second.size());
+    }
+    return true;
+  }
+
+ private:
+  using FieldList = std::vector<std::pair<rocksdb::Slice, rocksdb::Slice>>;
+
+  bool MergeIntoSchemaRow(const MergeOperationInput &merge_in, std::string &row) const {
+    std::vector<rocksdb::Slice> by_index(schema_->field_count());
+    if (merge_in.existing_value != nullptr && !schema_->Decode(*merge_in.existing_value, by_index)) {
+      return false;
+    }
+    FieldList patched;
+    for (const rocksdb::Slice &operand : merge_in.operand_list) {
+      if (!ApplyPatch(operand, patched)) {
+        return false;
+      }
+    }
+    for (const auto &field : patched) {
+      int i = schema_->IndexOf(field.first.ToString());
+      if (i < 0) {
+        return false;
+      }
+      by_index[i] = field.second;
+    }
+    row.clear();
+    schema_->Encode(by_index, row);
+    return true;
+  }
+
+  static void PutVarint32(std::string &dst, uint32_t v) {
+    while (v >= 0x80) {
+      dst.push_back(static_cast<char>(v | 0x80));
+      v >>= 7;
+    }
+    dst.push_back(static_cast<char>(v));
+  }
+
+  static bool GetVarint32(const char *&p, const char *lim, uint32_t &v) {
+    v = 0;
+    for (int shift = 0; shift <= 28 && p < lim; shift += 7) {
+      uint32_t byte = static_cast<unsigned char>(*p++);
+      v |= (byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static void PutFixed32Prefixed(std::string &dst, const rocksdb::Slice &s) {
+    uint32_t len = s.size();
+    dst.append(reinterpret_cast<char *>(&len), sizeof(uint32_t));
+    dst.append(s.data(), s.size());
+  }
+
+  static bool GetFixed32Prefixed(const char *&p, const char *lim, rocksdb::Slice &s) {
+    uint32_t len;
+    if (lim - p < static_cast<ptrdiff_t>(sizeof(uint32_t))) {
+      return false;
+    }
+    std::memcpy(&len, p, sizeof(uint32_t));
+    p += sizeof(uint32_t);
+    if (static_cast<size_t>(lim - p) < len) {
+      return false;
+    }
+    s = rocksdb::Slice(p, len);
+    p += len;
+    return true;
+  }
+
+  static bool GetVarint32Prefixed(const char *&p, const char *lim, rocksdb::Slice &s) {
+    uint32_t len;
+    if (!GetVarint32(p, lim, len) || static_cast<size_t>(lim - p) < len) {
+      return false;
+    }
+    s = rocksdb::Slice(p, len);
+    p += len;
+    return true;
+  }
+
+  static bool DecodeRow(const rocksdb::Slice &row, FieldList &fields) {
+    const char *p = row.data();
+    const char *lim = p + row.size();
+    while (p < lim) {
+      rocksdb::Slice name, value;
+      if (!GetFixed32Prefixed(p, lim, name) || !GetFixed32Prefixed(p, lim, value)) {
+        return false;
+      }
+      fields.emplace_back(name, value);
+    }
+    return true;
+  }
+
+  static bool ApplyPatch(const rocksdb::Slice &patch, FieldList &fields) {
+    const char *p = patch.data();
+    const char *lim = p + patch.size();
+    while (p < lim) {
+      rocksdb::Slice name, value;
+      if (!GetVarint32Prefixed(p, lim, name) || !GetVarint32Prefixed(p, lim, value)) {
+        return false;
+      }
+      bool found = false;
+      for (auto &field : fields) {
+        if (field.first == name) {
+          field.second = value;
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        fields.emplace_back(name, value);
+      }
+    }
+    return true;
+  }
+
+  std::shared_ptr<const RowSchema> schema_;
+};
+
+} // ycsbc
+
+#endif // YCSB_C_ROCKSDB_FIELD_MERGE_H_
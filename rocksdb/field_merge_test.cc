@@ -0,0 +1,172 @@
+//
+//  field_merge_test.cc
+//  YCSB-cpp
+//
+//  Patch application in FieldPatchMergeOperator.
+//
+
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "field_merge.h"
+#include "row_schema.h"
+#include "utils/test_util.h"
+
+namespace
+{
+  using ycsbc::DB;
+  using ycsbc::FieldPatchMergeOperator;
+  using ycsbc::RowSchema;
+  using Fields = std::vector<DB::Field>;
+
+  // RocksdbDB::SerializeRow's layout without a schema.
+  std::string Row(const Fields &fields)
+  {
+    std::string row;
+    for (const DB::Field &field : fields)
+    {
+      uint32_t len = field.name.size();
+      row.append(reinterpret_cast<char *>(&len), sizeof(uint32_t));
+      row.append(field.name);
+      len = field.value.size();
+      row.append(reinterpret_cast<char *>(&len), sizeof(uint32_t));
+      row.append(field.value);
+    }
+    return row;
+  }
+
+  std::string Patch(const Fields &fields)
+  {
+    std::string patch;
+    FieldPatchMergeOperator::EncodePatch(fields, patch);
+    return patch;
+  }
+
+  // Runs FullMergeV2; `base` is null for a merge with no existing value.
+  bool FullMerge(const FieldPatchMergeOperator &op, const std::string *base,
+                 const std::vector<std::string> &operands, std::string &result)
+  {
+    rocksdb::Slice key("user1");
+    rocksdb::Slice existing;
+    if (base != nullptr)
+    {
+      existing = rocksdb::Slice(*base);
+    }
+    std::vector<rocksdb::Slice> operand_list(operands.begin(), operands.end());
+    rocksdb::MergeOperator::MergeOperationInput in(key, base != nullptr ? &existing : nullptr, operand_list,
+                                                   nullptr);
+    rocksdb::Slice existing_operand;
+    rocksdb::MergeOperator::MergeOperationOutput out(result, existing_operand);
+    return op.FullMergeV2(in, &out);
+  }
+
+  void TestPatchOverwritesAndAppends()
+  {
+    FieldPatchMergeOperator op;
+    std::string base = Row({{"field0", "a"}, {"field1", "b"}});
+    std::string result;
+    TEST_CHECK(FullMerge(op, &base,
+                         {Patch({{"field1", "x"}}), Patch({{"field2", "y"}, {"field1", "z"}})}, result));
+    // Later operands win; new fields go at the end.
+    TEST_CHECK(result == Row({{"field0", "a"}, {"field1", "z"}, {"field2", "y"}}));
+  }
+
+  void TestMergeWithoutBase()
+  {
+    FieldPatchMergeOperator op;
+    std::string result;
+    TEST_CHECK(FullMerge(op, nullptr, {Patch({{"field0", "a"}}), Patch({{"field1", ""}})}, result));
+    TEST_CHECK(result == Row({{"field0", "a"}, {"field1", ""}}));
+  }
+
+  void TestLongValues()
+  {
+    // 300 bytes needs a two-byte varint length in the patch.
+    FieldPatchMergeOperator op;
+    std::string value(300, 'v');
+    std::string patch = Patch({{"field0", value}});
+    TEST_CHECK(patch.size() == 1 + 6 + 2 + 300);
+    std::string base = Row({{"field0", "a"}});
+    std::string result;
+    TEST_CHECK(FullMerge(op, &base, {patch}, result));
+    TEST_CHECK(result == Row({{"field0", value}}));
+  }
+
+  void TestPartialMergeFoldsPatches()
+  {
+    FieldPatchMergeOperator op;
+    std::vector<std::string> patches = {Patch({{"field1", "x"}, {"field3", "q"}}),
+                                        Patch({{"field1", "z"}}), Patch({{"field2", "y"}})};
+    std::deque<rocksdb::Slice> operand_list(patches.begin(), patches.end());
+    std::string folded;
+    TEST_CHECK(op.PartialMergeMulti(rocksdb::Slice("user1"), operand_list, &folded, nullptr));
+    TEST_CHECK(folded == Patch({{"field1", "z"}, {"field3", "q"}, {"field2", "y"}}));
+
+    // Merging the folded patch matches merging the stack.
+    std::string base = Row({{"field0", "a"}, {"field1", "b"}});
+    std::string stacked, single;
+    TEST_CHECK(FullMerge(op, &base, patches, stacked));
+    TEST_CHECK(FullMerge(op, &base, {folded}, single));
+    TEST_CHECK(stacked == single);
+  }
+
+  void TestMalformedInputs()
+  {
+    FieldPatchMergeOperator op;
+    std::string result;
+    std::string patch = Patch({{"field0", "abc"}});
+
+    // Truncated operand.
+    std::string base = Row({{"field0", "a"}});
+    TEST_CHECK(!FullMerge(op, &base, {patch.substr(0, patch.size() - 1)}, result));
+    // Unterminated varint.
+    TEST_CHECK(!FullMerge(op, &base, {std::string(1, '\x80')}, result));
+    // Truncated base row.
+    std::string short_base = base.substr(0, base.size() - 1);
+    TEST_CHECK(!FullMerge(op, &short_base, {patch}, result));
+
+    std::deque<rocksdb::Slice> operand_list = {rocksdb::Slice(patch.data(), 3)};
+    std::string folded;
+    TEST_CHECK(!op.PartialMergeMulti(rocksdb::Slice("user1"), operand_list, &folded, nullptr));
+  }
+
+  void TestSchemaRows()
+  {
+    auto schema = std::make_shared<const RowSchema>("field", 3);
+    FieldPatchMergeOperator op(schema);
+    std::string base;
+    schema->Encode(Fields{{"field0", "a"}, {"field1", "b"}, {"field2", "c"}}, base);
+
+    std::string result;
+    TEST_CHECK(FullMerge(op, &base, {Patch({{"field2", "zz"}}), Patch({{"field0", ""}})}, result));
+    std::string expected;
+    schema->Encode(Fields{{"field0", ""}, {"field1", "b"}, {"field2", "zz"}}, expected);
+    TEST_CHECK(result == expected);
+
+    // Without a base, unpatched fields are stored empty.
+    TEST_CHECK(FullMerge(op, nullptr, {Patch({{"field1", "b"}})}, result));
+    expected.clear();
+    schema->Encode(Fields{{"field1", "b"}}, expected);
+    TEST_CHECK(result == expected);
+
+    // Fields outside the schema and malformed base rows fail the merge.
+    TEST_CHECK(!FullMerge(op, &base, {Patch({{"field9", "x"}})}, result));
+    std::string short_base = base.substr(0, 3);
+    TEST_CHECK(!FullMerge(op, &short_base, {Patch({{"field1", "x"}})}, result));
+  }
+}
+
+int main()
+{
+  TestPatchOverwritesAndAppends();
+  TestMergeWithoutBase();
+  TestLongValues();
+  TestPartialMergeFoldsPatches();
+  TestMalformedInputs();
+  TestSchemaRows();
+  std::cout << "field_merge_test: OK" << std::endl;
+  return 0;
+}
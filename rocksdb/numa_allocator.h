@@ -0,0 +1,61 @@
+//
+//  numa_allocator.h
+//  YCSB-cpp
+//
+//  Block cache allocator that places a tenant's cache blocks on one NUMA node.
+//
+
+#ifndef YCSB_C_ROCKSDB_NUMA_ALLOCATOR_H_
+#define YCSB_C_ROCKSDB_NUMA_ALLOCATOR_H_
+
+#ifdef USE_NUMA
+
+#include <numa.h>
+
+#include <cstddef>
+#include <string>
+
+#include <rocksdb/memory_allocator.h>
+
+namespace ycsbc {
+
+class NumaMemoryAllocator : public rocksdb::MemoryAllocator {
+ public:
+  explicit NumaMemoryAllocator(int node) : node_(node) {}
+
+  static const char *kClassName() { return "NumaMemoryAllocator"; }
+  const char *Name() const override { return kClassName(); }
+
+  // numa_free() needs the allocation size, so it is stored in a header ahead
+  // of the block handed to RocksDB.
+  void *Allocate(size_t size) override {
+    void *p = numa_alloc_onnode(size + kHeaderSize, node_);
+    if (p == nullptr) {
+      return nullptr;
+    }
+    *static_cast<size_t *>(p) = size;
+    return static_cast<char *>(p) + kHeaderSize;
+  }
+
+  void Deallocate(void *p) override {
+    if (p == nullptr) {
+      return;
+    }
+    char *base = static_cast<char *>(p) - kHeaderSize;
+    numa_free(base, *reinterpret_cast<size_t *>(base) + kHeaderSize);
+  }
+
+  size_t UsableSize(void *p, size_t allocation_size) const override {
+    return allocation_size;
+  }
+
+ private:
+  static constexpr size_t kHeaderSize = alignof(std::max_align_t);
+  int node_;
+};
+
+} // ycsbc
+
+#endif // USE_NUMA
+
+#endif // YCSB_C_ROCKSDB_NUMA_ALLOCATOR_H_
@@ -7,11 +7,21 @@
 //
 
 #include "rocksdb_db.h"
+#include "numa_allocator.h"
+#include "tenant_cache.h"
+#include "field_merge.h"
 
 #include "core/core_workload.h"
 #include "core/db_factory.h"
+#include "utils/countdown_latch.h"
+#include "utils/cpu_topology.h"
 #include "utils/utils.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
 #include <sstream>
+#include <thread>
 #include <iostream>
 #include <rocksdb/cache.h>
 #include <rocksdb/filter_policy.h>
@@ -24,6 +34,7 @@
 #include <rocksdb/db.h>
 #include <rocksdb/options.h>
 #include <rocksdb/rate_limiter.h>
+#include <rocksdb/slice_transform.h>
 // #include <rocksdb/util/rate_limiter_multi_tenant_impl.h>
 #include <rocksdb/tg_thread_local.h>
 
@@ -32,9 +43,23 @@ namespace
   const std::string PROP_NAME = "rocksdb.dbname";
   const std::string PROP_NAME_DEFAULT = "";
 
+  // Per CF (one value for all or one per CF):
+  // single: every field stored as [len][name][len][value].
+  // schema: names kept once in a RowSchema, rows hold an offset header.
+  // row: one entry per field under <key>\0<field>.
+  // column: one entry per field under <field>\0<key>.
   const std::string PROP_FORMAT = "rocksdb.format";
   const std::string PROP_FORMAT_DEFAULT = "single";
 
+  // Separates the parts of a row/column composite key. It sorts below any
+  // byte of a key or field name, so composite keys sort by their first part
+  // and then their second ("user1" rows before "user10" rows), and
+  // [part + kCompKeySep, part + kCompKeyEnd) is exactly one row or column.
+  const char kCompKeySep = '\0';
+  const char kCompKeyEnd = '\1';
+
+  // Per CF (one value for all or one per CF): UPDATE writes a field patch
+  // through FieldPatchMergeOperator instead of reading and rewriting the row.
   const std::string PROP_MERGEUPDATE = "rocksdb.mergeupdate";
   const std::string PROP_MERGEUPDATE_DEFAULT = "false";
 
@@ -98,6 +123,50 @@ namespace
   const std::string PROP_CACHE_SIZE = "rocksdb.cache_size";
   const std::string PROP_CACHE_SIZE_DEFAULT = "0";
 
+  // per_cf: a private LRUCache per CF. shared_quota: one cache sized to the
+  // sum of rocksdb.cache_size, with each entry of rocksdb.cache_size acting
+  // as that tenant's soft quota (see tenant_cache.h).
+  const std::string PROP_CACHE_MODE = "rocksdb.cache_mode";
+  const std::string PROP_CACHE_MODE_DEFAULT = "per_cf";
+
+  const std::string PROP_CACHE_HARD_QUOTA_RATIO = "rocksdb.cache_hard_quota_ratio";
+  const std::string PROP_CACHE_HARD_QUOTA_RATIO_DEFAULT = "2.0";
+
+  // Share of the shared_quota LRU cache kept for LOW-priority (data) blocks.
+  // What high and low pools leave is the bottom pool, where over-quota
+  // tenants' blocks go and which is evicted first.
+  const std::string PROP_CACHE_LOW_PRI_POOL_RATIO = "rocksdb.cache_low_pri_pool_ratio";
+  const std::string PROP_CACHE_LOW_PRI_POOL_RATIO_DEFAULT = "0.4";
+
+  // lru: FairDB's LRUCache (pooling, per-client rampups). hyper_clock: lock-free
+  // HyperClockCache, sized per tenant like lru but without the FairDB extensions.
+  const std::string PROP_CACHE_TYPE = "rocksdb.cache_type";
+  const std::string PROP_CACHE_TYPE_DEFAULT = "lru";
+
+  // HyperClockCache slot-table sizing; 0 derives it from the block_size of
+  // the CFs the cache serves (rocksdb.lsm.<cf>.block_size).
+  const std::string PROP_CACHE_ESTIMATED_ENTRY_CHARGE = "rocksdb.cache_estimated_entry_charge";
+  const std::string PROP_CACHE_ESTIMATED_ENTRY_CHARGE_DEFAULT = "0";
+
+  // Per-CF CompressedSecondaryCache capacity in bytes behind each tenant's
+  // block cache (per_cf mode only); empty or 0 = none.
+  const std::string PROP_SECONDARY_CACHE_SIZE = "rocksdb.secondary_cache_size";
+  const std::string PROP_SECONDARY_CACHE_SIZE_DEFAULT = "";
+
+  const std::string PROP_SECONDARY_CACHE_COMPRESSION = "rocksdb.secondary_cache_compression";
+  const std::string PROP_SECONDARY_CACHE_COMPRESSION_DEFAULT = "lz4";
+
+  // Secondary cache built with SecondaryCache::CreateFromString instead, e.g.
+  // a file-backed cache plugin on local SSD. "{cf}" is replaced by the CF
+  // index so each tenant gets its own path.
+  const std::string PROP_SECONDARY_CACHE_URI = "rocksdb.secondary_cache_uri";
+  const std::string PROP_SECONDARY_CACHE_URI_DEFAULT = "";
+
+  // One value: a row cache of that size shared by all tenants. One value
+  // per CF: each tenant's row cache quota (see TenantRowCache).
+  const std::string PROP_ROW_CACHE_SIZE = "rocksdb.row_cache_size";
+  const std::string PROP_ROW_CACHE_SIZE_DEFAULT = "0";
+
   const std::string PROP_COMPRESSED_CACHE_SIZE = "rocksdb.compressed_cache_size";
   const std::string PROP_COMPRESSED_CACHE_SIZE_DEFAULT = "0";
 
@@ -152,7 +221,143 @@ namespace
   const std::string PROP_NUM_LEVELS = "rocksdb.num_levels";
   const std::string PROP_NUM_LEVELS_DEFAULT = "4";
 
+  // rocksdb.lsm.<cf>.<option>: one CF's LSM shape, normally set from its
+  // client's YAML `lsm:` block. Options left unset keep the settings above.
+  const std::string PROP_LSM_PREFIX = "rocksdb.lsm.";
+
+  // Per-tenant write options, each one value for every CF or one per CF.
+  // The WAL stays off unless enabled here.
+  const std::string PROP_WAL = "rocksdb.wal";
+  const std::string PROP_WAL_DEFAULT = "false";
+
+  const std::string PROP_WAL_SYNC = "rocksdb.wal_sync";
+  const std::string PROP_WAL_SYNC_DEFAULT = "false";
+
+  // Writes that would stall fail as Incomplete instead; reported as *_FAILED.
+  const std::string PROP_WRITE_NO_SLOWDOWN = "rocksdb.write_no_slowdown";
+  const std::string PROP_WRITE_NO_SLOWDOWN_DEFAULT = "false";
+
+  const std::string PROP_WRITE_LOW_PRI = "rocksdb.write_low_pri";
+  const std::string PROP_WRITE_LOW_PRI_DEFAULT = "false";
+
+  const std::string PROP_ENABLE_PIPELINED_WRITE = "rocksdb.enable_pipelined_write";
+  const std::string PROP_ENABLE_PIPELINED_WRITE_DEFAULT = "false";
+
+  const std::string PROP_UNORDERED_WRITE = "rocksdb.unordered_write";
+  const std::string PROP_UNORDERED_WRITE_DEFAULT = "false";
+
+  const std::string PROP_TWO_WRITE_QUEUES = "rocksdb.two_write_queues";
+  const std::string PROP_TWO_WRITE_QUEUES_DEFAULT = "false";
+
+  const std::string PROP_ALLOW_CONCURRENT_MEMTABLE_WRITE = "rocksdb.allow_concurrent_memtable_write";
+  const std::string PROP_ALLOW_CONCURRENT_MEMTABLE_WRITE_DEFAULT = "true";
+
+  // With manual_wal_flush, WAL writes stay buffered until a background
+  // thread calls FlushWAL every wal_flush_interval_ms (0 = only on sync).
+  const std::string PROP_MANUAL_WAL_FLUSH = "rocksdb.manual_wal_flush";
+  const std::string PROP_MANUAL_WAL_FLUSH_DEFAULT = "false";
+
+  const std::string PROP_WAL_FLUSH_INTERVAL_MS = "rocksdb.wal_flush_interval_ms";
+  const std::string PROP_WAL_FLUSH_INTERVAL_MS_DEFAULT = "10";
+
+  const std::string PROP_WAL_FLUSH_SYNC = "rocksdb.wal_flush_sync";
+  const std::string PROP_WAL_FLUSH_SYNC_DEFAULT = "false";
+
+  // How often blob GC traffic is read from the CF stats of tenants with
+  // blob files, for the resource scheduler.
+  const std::string PROP_BLOB_STATS_INTERVAL_MS = "rocksdb.blob_stats_interval_ms";
+  const std::string PROP_BLOB_STATS_INTERVAL_MS_DEFAULT = "1000";
+
+  // Per-CF NUMA node for the block cache and memtable allocations, -1 for
+  // unbound. Requires building with USE_NUMA.
+  const std::string PROP_NUMA_NODES = "rocksdb.numa_nodes";
+  const std::string PROP_NUMA_NODES_DEFAULT = "";
+
+  // Confines RocksDB flush/compaction jobs to the "rocksdb_bg" cpus of the
+  // layout. Env has no thread-start hook, so each scheduled job is wrapped and
+  // the pool thread restricts itself the first time it runs one.
+  class CpuPinnedEnv : public rocksdb::EnvWrapper
+  {
+  public:
+    CpuPinnedEnv(rocksdb::Env *target, const ycsbc::utils::CpuLayout &layout)
+        : rocksdb::EnvWrapper(target), layout_(layout) {}
+
+    void Schedule(void (*function)(void *arg), void *arg, Priority pri = LOW, void *tag = nullptr,
+                  void (*unschedFunction)(void *arg) = nullptr) override
+    {
+      PinnedJob *job = new PinnedJob{this, function, arg, unschedFunction};
+      target()->Schedule(&CpuPinnedEnv::RunJob, job, pri, tag, &CpuPinnedEnv::UnscheduleJob);
+    }
+
+  private:
+    struct PinnedJob
+    {
+      CpuPinnedEnv *env;
+      void (*function)(void *);
+      void *arg;
+      void (*unschedFunction)(void *);
+    };
+
+    static void RunJob(void *arg)
+    {
+      static thread_local bool restricted = false;
+      PinnedJob *job = static_cast<PinnedJob *>(arg);
+      if (!restricted)
+      {
+        restricted = job->env->layout_.RestrictCurrentThread("rocksdb_bg");
+      }
+      job->function(job->arg);
+      delete job;
+    }
+
+    static void UnscheduleJob(void *arg)
+    {
+      PinnedJob *job = static_cast<PinnedJob *>(arg);
+      if (job->unschedFunction)
+      {
+        job->unschedFunction(job->arg);
+      }
+      delete job;
+    }
+
+    ycsbc::utils::CpuLayout layout_;
+  };
+
+  // Runs a task on its own thread every interval_ms until stopped.
+  class PeriodicTask
+  {
+  public:
+    void Start(int interval_ms, std::function<void()> task)
+    {
+      stop_.reset(new ycsbc::utils::CountDownLatch(1));
+      thread_ = std::thread([this, interval_ms, task]()
+                            {
+        while (!stop_->AwaitForMs(interval_ms))
+        {
+          task();
+        } });
+    }
+
+    void Stop()
+    {
+      if (thread_.joinable())
+      {
+        stop_->CountDown();
+        thread_.join();
+      }
+    }
+
+  private:
+    std::unique_ptr<ycsbc::utils::CountDownLatch> stop_;
+    std::thread thread_;
+  };
+
+  // Background FlushWAL for rocksdb.manual_wal_flush.
+  static PeriodicTask wal_flusher;
+  // Background blob stats sampling for the resource usage snapshot.
+  static PeriodicTask blob_sampler;
   static std::shared_ptr<rocksdb::Env> env_guard;
+  static std::unique_ptr<rocksdb::Env> pinned_env_guard;
   static std::shared_ptr<rocksdb::Cache> block_cache;
 #if ROCKSDB_MAJOR < 8
   static std::shared_ptr<rocksdb::Cache> block_cache_compressed;
@@ -163,9 +368,36 @@ namespace ycsbc
 {
 
   std::vector<rocksdb::ColumnFamilyHandle *> RocksdbDB::cf_handles_;
+  std::unordered_map<std::string, TenantHandle> RocksdbDB::tenants_;
   rocksdb::DB *RocksdbDB::db_ = nullptr;
   int RocksdbDB::ref_cnt_ = 0;
   std::mutex RocksdbDB::mu_;
+  std::vector<int> RocksdbDB::numa_node_by_client_;
+  std::unique_ptr<utils::MultiTenantCounter> RocksdbDB::numa_local_ops_;
+  std::unique_ptr<utils::MultiTenantCounter> RocksdbDB::numa_remote_ops_;
+  rocksdb::RateLimiter *RocksdbDB::write_rate_limiter_ = nullptr;
+  rocksdb::RateLimiter *RocksdbDB::read_rate_limiter_ = nullptr;
+  std::unique_ptr<utils::ResourceUsageSnapshot> RocksdbDB::usage_snapshot_;
+  std::shared_ptr<rocksdb::Cache> RocksdbDB::row_cache_;
+  std::vector<rocksdb::WriteOptions> RocksdbDB::write_options_;
+  std::vector<bool> RocksdbDB::blob_files_by_client_;
+  std::vector<bool> RocksdbDB::merge_update_;
+  std::shared_ptr<const RowSchema> RocksdbDB::schema_;
+  std::vector<RocksdbDB::RocksFormat> RocksdbDB::format_by_client_;
+  std::vector<std::string> RocksdbDB::field_names_;
+
+  const RocksdbDB::FormatMethods RocksdbDB::kWholeRowMethods = {
+      &RocksdbDB::ReadSingle,   &RocksdbDB::ReadMany,   &RocksdbDB::ScanSingle,
+      &RocksdbDB::UpdateSingle, &RocksdbDB::InsertSingle, &RocksdbDB::InsertMany,
+      &RocksdbDB::DeleteSingle, &RocksdbDB::ReadModifyInsertMany,
+  };
+  const RocksdbDB::FormatMethods RocksdbDB::kCompKeyMethods = {
+      &RocksdbDB::ReadCompKey,   &RocksdbDB::ReadManyCompKey, &RocksdbDB::ScanCompKey,
+      &RocksdbDB::InsertCompKey, &RocksdbDB::InsertCompKey,   &RocksdbDB::InsertManyCompKey,
+      &RocksdbDB::DeleteCompKey, &RocksdbDB::ReadModifyInsertManyCompKey,
+  };
+  bool RocksdbDB::wal_enabled_ = false;
+  std::shared_ptr<rocksdb::Statistics> RocksdbDB::statistics_;
 
   std::vector<int64_t> stringToIntVector(const std::string &input)
   {
@@ -179,83 +411,287 @@ namespace ycsbc
     return result;
   }
 
-  void RocksdbDB::Init()
+  rocksdb::CompressionType StringToCompressionType(const std::string &compression_type)
   {
-// merge operator disabled by default due to link error
-#ifdef USE_MERGEUPDATE
-    class YCSBUpdateMerge : public rocksdb::AssociativeMergeOperator
+    if (compression_type == "no")
     {
-    public:
-      virtual bool Merge(const rocksdb::Slice &key, const rocksdb::Slice *existing_value,
-                         const rocksdb::Slice &value, std::string *new_value,
-                         rocksdb::Logger *logger) const override
-      {
-        assert(existing_value);
+      return rocksdb::kNoCompression;
+    }
+    else if (compression_type == "snappy")
+    {
+      return rocksdb::kSnappyCompression;
+    }
+    else if (compression_type == "zlib")
+    {
+      return rocksdb::kZlibCompression;
+    }
+    else if (compression_type == "bzip2")
+    {
+      return rocksdb::kBZip2Compression;
+    }
+    else if (compression_type == "lz4")
+    {
+      return rocksdb::kLZ4Compression;
+    }
+    else if (compression_type == "lz4hc")
+    {
+      return rocksdb::kLZ4HCCompression;
+    }
+    else if (compression_type == "xpress")
+    {
+      return rocksdb::kXpressCompression;
+    }
+    else if (compression_type == "zstd")
+    {
+      return rocksdb::kZSTD;
+    }
+    else
+    {
+      throw utils::Exception("Unknown compression type");
+    }
+  }
 
-        std::vector<Field> values;
-        const char *p = existing_value->data();
-        const char *lim = p + existing_value->size();
-        DeserializeRow(values, p, lim);
+  std::string LsmCfName(size_t i)
+  {
+    return i == 0 ? rocksdb::kDefaultColumnFamilyName : "cf" + std::to_string(i);
+  }
 
-        std::vector<Field> new_values;
-        p = value.data();
-        lim = p + value.size();
-        DeserializeRow(new_values, p, lim);
+  // The data block size ApplyLsmOptions will give the CF, needed earlier to
+  // size its block cache.
+  size_t LsmBlockSize(const utils::Properties &props, const std::string &cf_name)
+  {
+    const std::string value = props.GetProperty(PROP_LSM_PREFIX + cf_name + ".block_size", "");
+    return value.empty() ? rocksdb::BlockBasedTableOptions().block_size : std::stoull(value);
+  }
 
-        for (Field &new_field : new_values)
-        {
-          bool found = false;
-          for (Field &field : values)
-          {
-            if (field.name == new_field.name)
-            {
-              found = true;
-              field.value = new_field.value;
-              break;
-            }
-          }
-          if (!found)
-          {
-            values.push_back(new_field);
-          }
-        }
+  void ApplyLsmOptions(const utils::Properties &props, const std::string &cf_name,
+                       rocksdb::ColumnFamilyOptions &cf_opt, rocksdb::BlockBasedTableOptions &table_options)
+  {
+    auto lsm = [&](const std::string &option)
+    {
+      const std::string value = props.GetProperty(PROP_LSM_PREFIX + cf_name + "." + option, "");
+      if (!value.empty())
+      {
+        std::cout << "[FAIRDB_LOG] CF " << cf_name << " lsm " << option << "=" << value << std::endl;
+      }
+      return value;
+    };
+    std::string val;
 
-        SerializeRow(values, *new_value);
-        return true;
+    if (!(val = lsm("compaction_style")).empty())
+    {
+      if (val == "level")
+      {
+        cf_opt.compaction_style = rocksdb::kCompactionStyleLevel;
+      }
+      else if (val == "universal")
+      {
+        cf_opt.compaction_style = rocksdb::kCompactionStyleUniversal;
+      }
+      else if (val == "fifo")
+      {
+        cf_opt.compaction_style = rocksdb::kCompactionStyleFIFO;
       }
+      else
+      {
+        throw utils::Exception("Unknown lsm compaction_style for " + cf_name + ": " + val);
+      }
+    }
+    if (!(val = lsm("num_levels")).empty())
+    {
+      cf_opt.num_levels = std::stoi(val);
+    }
+    if (!(val = lsm("level0_file_num_compaction_trigger")).empty())
+    {
+      cf_opt.level0_file_num_compaction_trigger = std::stoi(val);
+    }
+    if (!(val = lsm("level0_slowdown_writes_trigger")).empty())
+    {
+      cf_opt.level0_slowdown_writes_trigger = std::stoi(val);
+    }
+    if (!(val = lsm("level0_stop_writes_trigger")).empty())
+    {
+      cf_opt.level0_stop_writes_trigger = std::stoi(val);
+    }
+    if (!(val = lsm("target_file_size_base")).empty())
+    {
+      cf_opt.target_file_size_base = std::stoull(val);
+    }
+    if (!(val = lsm("target_file_size_multiplier")).empty())
+    {
+      cf_opt.target_file_size_multiplier = std::stoi(val);
+    }
+    if (!(val = lsm("max_bytes_for_level_base")).empty())
+    {
+      cf_opt.max_bytes_for_level_base = std::stoull(val);
+    }
+    if (!(val = lsm("max_bytes_for_level_multiplier")).empty())
+    {
+      cf_opt.max_bytes_for_level_multiplier = std::stod(val);
+    }
+    if (!(val = lsm("level_compaction_dynamic_level_bytes")).empty())
+    {
+      cf_opt.level_compaction_dynamic_level_bytes = val == "true";
+    }
+    if (!(val = lsm("universal_size_ratio")).empty())
+    {
+      cf_opt.compaction_options_universal.size_ratio = std::stoi(val);
+    }
+    if (!(val = lsm("universal_max_size_amplification_percent")).empty())
+    {
+      cf_opt.compaction_options_universal.max_size_amplification_percent = std::stoi(val);
+    }
+    if (!(val = lsm("fifo_max_table_files_size")).empty())
+    {
+      cf_opt.compaction_options_fifo.max_table_files_size = std::stoull(val);
+    }
 
-      virtual const char *Name() const override
+    if (!(val = lsm("compression")).empty())
+    {
+      cf_opt.compression = StringToCompressionType(val);
+    }
+    if (!(val = lsm("compression_per_level")).empty())
+    {
+      // Levels past the end of the list use its last entry.
+      cf_opt.compression_per_level.clear();
+      for (const std::string &level : Prop2vector(props, PROP_LSM_PREFIX + cf_name + ".compression_per_level", ""))
       {
-        return "YCSBUpdateMerge";
+        cf_opt.compression_per_level.push_back(StringToCompressionType(level));
       }
-    };
-#endif
-    const std::lock_guard<std::mutex> lock(mu_);
+    }
+    if (!(val = lsm("bottommost_compression")).empty())
+    {
+      cf_opt.bottommost_compression = StringToCompressionType(val);
+    }
 
-    const utils::Properties &props = *props_;
-    const std::string format = props.GetProperty(PROP_FORMAT, PROP_FORMAT_DEFAULT);
-    if (format == "single")
-    {
-      format_ = kSingleRow;
-      method_read_ = &RocksdbDB::ReadSingle;
-      method_read_batch_ = &RocksdbDB::ReadMany;
-      method_scan_ = &RocksdbDB::ScanSingle;
-      method_update_ = &RocksdbDB::UpdateSingle;
-      method_insert_ = &RocksdbDB::InsertSingle;
-      method_delete_ = &RocksdbDB::DeleteSingle;
-      method_insert_batch_ = &RocksdbDB::InsertMany;
-      method_read_modify_insert_batch_ = &RocksdbDB::ReadModifyInsertMany;
-#ifdef USE_MERGEUPDATE
-      if (props.GetProperty(PROP_MERGEUPDATE, PROP_MERGEUPDATE_DEFAULT) == "true")
-      {
-        method_update_ = &RocksdbDB::MergeSingle;
+    if (!(val = lsm("bloom_bits")).empty())
+    {
+      const int bloom_bits = std::stoi(val);
+      table_options.filter_policy.reset(bloom_bits > 0 ? rocksdb::NewBloomFilterPolicy(bloom_bits) : nullptr);
+    }
+    if (!(val = lsm("block_size")).empty())
+    {
+      table_options.block_size = std::stoull(val);
+    }
+
+    // fixed:<n> or capped:<n> bytes of the key. Keys are "user<n>", so a
+    // prefix past "user" groups neighbouring key numbers; fixed leaves keys
+    // shorter than n out of the prefix filters, capped does not.
+    if (!(val = lsm("prefix_extractor")).empty())
+    {
+      const size_t colon = val.find(':');
+      const std::string kind = val.substr(0, colon);
+      const size_t len = colon == std::string::npos ? 0 : std::stoul(val.substr(colon + 1));
+      if (len == 0 || (kind != "fixed" && kind != "capped"))
+      {
+        throw utils::Exception("lsm prefix_extractor for " + cf_name + " must be fixed:<n> or capped:<n>: " + val);
       }
-#endif
+      cf_opt.prefix_extractor.reset(kind == "fixed" ? rocksdb::NewFixedPrefixTransform(len)
+                                                    : rocksdb::NewCappedPrefixTransform(len));
+    }
+    if (!(val = lsm("memtable_prefix_bloom_size_ratio")).empty())
+    {
+      cf_opt.memtable_prefix_bloom_size_ratio = std::stod(val);
+    }
+    if (!(val = lsm("whole_key_filtering")).empty())
+    {
+      // false keeps only prefix entries in the filters, for scan-only tenants.
+      table_options.whole_key_filtering = val == "true";
+    }
+    if (!(val = lsm("index_type")).empty())
+    {
+      if (val == "binary")
+      {
+        table_options.index_type = rocksdb::BlockBasedTableOptions::kBinarySearch;
+      }
+      else if (val == "hash")
+      {
+        table_options.index_type = rocksdb::BlockBasedTableOptions::kHashSearch;
+      }
+      else
+      {
+        throw utils::Exception("Unknown lsm index_type for " + cf_name + ": " + val);
+      }
+    }
+    if (table_options.index_type == rocksdb::BlockBasedTableOptions::kHashSearch && !cf_opt.prefix_extractor)
+    {
+      throw utils::Exception("lsm index_type=hash for " + cf_name + " needs a prefix_extractor");
+    }
+    if (!(val = lsm("optimize_filters_for_hits")).empty())
+    {
+      // Skips filters on the last level: hot-read tenants whose lookups
+      // mostly hit trade a little read IO on misses for filter memory.
+      cf_opt.optimize_filters_for_hits = val == "true";
+    }
+
+    // Key-value separation: values of at least min_blob_size go to blob
+    // files, so compactions rewrite only keys and blob references.
+    if (!(val = lsm("enable_blob_files")).empty())
+    {
+      cf_opt.enable_blob_files = val == "true";
+    }
+    if (!(val = lsm("min_blob_size")).empty())
+    {
+      cf_opt.min_blob_size = std::stoull(val);
+    }
+    if (!(val = lsm("blob_file_size")).empty())
+    {
+      cf_opt.blob_file_size = std::stoull(val);
+    }
+    if (!(val = lsm("blob_compression")).empty())
+    {
+      cf_opt.blob_compression_type = StringToCompressionType(val);
+    }
+    if (!(val = lsm("enable_blob_garbage_collection")).empty())
+    {
+      cf_opt.enable_blob_garbage_collection = val == "true";
+    }
+    if (!(val = lsm("blob_garbage_collection_age_cutoff")).empty())
+    {
+      cf_opt.blob_garbage_collection_age_cutoff = std::stod(val);
+    }
+  }
+
+  // For every iterator. With a prefix extractor, a bounded iterator uses
+  // prefix filters only where the bound makes that safe (auto_prefix_mode);
+  // an unbounded one must see keys across prefixes, so it seeks in total
+  // order.
+  rocksdb::ReadOptions IteratorReadOptions(const rocksdb::Slice *upper_bound)
+  {
+    rocksdb::ReadOptions read_options = rocksdb::ReadOptions();
+    read_options.rate_limiter_priority = rocksdb::Env::IOPriority::IO_USER;
+    if (upper_bound != nullptr)
+    {
+      read_options.iterate_upper_bound = upper_bound;
+      read_options.auto_prefix_mode = true;
     }
     else
     {
-      throw utils::Exception("unknown format");
+      read_options.total_order_seek = true;
+    }
+    return read_options;
+  }
+
+  // Incomplete means a rocksdb.write_no_slowdown write hit a stall: the
+  // request fails. Any other error is fatal, as before.
+  DB::Status CheckWriteStatus(const rocksdb::Status &s, const std::string &op)
+  {
+    if (s.ok())
+    {
+      return DB::kOK;
     }
+    if (s.IsIncomplete())
+    {
+      return DB::kError;
+    }
+    throw utils::Exception("RocksDB " + op + ": " + s.ToString());
+  }
+
+  void RocksdbDB::Init()
+  {
+    const std::lock_guard<std::mutex> lock(mu_);
+
+    const utils::Properties &props = *props_;
     fieldcount_ = std::stoi(props.GetProperty(CoreWorkload::FIELD_COUNT_PROPERTY,
                                               CoreWorkload::FIELD_COUNT_DEFAULT));
 
@@ -273,6 +709,58 @@ namespace ycsbc
 
     std::vector<rocksdb::ColumnFamilyOptions> cf_opts;
     const int num_cfs = std::stoi(props.GetProperty(PROP_NUM_CFS, PROP_NUM_CFS_DEFAULT));
+
+    // Whole-row CFs share SerializeRow, so single and schema cannot be mixed;
+    // row and column CFs can sit next to either.
+    const std::string field_prefix =
+        props.GetProperty(CoreWorkload::FIELD_NAME_PREFIX, CoreWorkload::FIELD_NAME_PREFIX_DEFAULT);
+    std::vector<std::string> formats = Prop2vector(props, PROP_FORMAT, PROP_FORMAT_DEFAULT);
+    if (formats.size() != 1 && formats.size() != static_cast<size_t>(num_cfs))
+    {
+      throw utils::Exception(PROP_FORMAT + " must have one value or one per column family");
+    }
+    bool any_single = false;
+    bool any_schema = false;
+    for (int i = 0; i < num_cfs; ++i)
+    {
+      const std::string &format = formats[formats.size() == 1 ? 0 : i];
+      if (format == "single")
+      {
+        format_by_client_.push_back(kSingleRow);
+        any_single = true;
+      }
+      else if (format == "schema")
+      {
+        format_by_client_.push_back(kSchemaRow);
+        any_schema = true;
+      }
+      else if (format == "row")
+      {
+        format_by_client_.push_back(kRowMajor);
+      }
+      else if (format == "column")
+      {
+        format_by_client_.push_back(kColumnMajor);
+      }
+      else
+      {
+        throw utils::Exception("unknown format");
+      }
+      std::cout << "[FAIRDB_LOG] CF " << i << " format: " << format << std::endl;
+    }
+    if (any_single && any_schema)
+    {
+      throw utils::Exception("rocksdb.format cannot mix single and schema column families");
+    }
+    for (int i = 0; i < fieldcount_; ++i)
+    {
+      field_names_.push_back(field_prefix + std::to_string(i));
+    }
+    if (any_schema)
+    {
+      schema_ = std::make_shared<RowSchema>(field_prefix, fieldcount_);
+      std::cout << "[FAIRDB_LOG] Schema row format with " << fieldcount_ << " fields" << std::endl;
+    }
     for (int i = 0; i < num_cfs; ++i)
     {
       cf_opts.push_back(rocksdb::ColumnFamilyOptions());
@@ -296,11 +784,47 @@ namespace ycsbc
       {
         cf_name = "cf" + std::to_string(i);
       }
+      // Installed on every CF so rows written with merges stay readable
+      // whatever rocksdb.mergeupdate says on a later run.
+      cf_opts[i].merge_operator = std::make_shared<FieldPatchMergeOperator>(schema_);
       cf_descs.emplace_back(cf_name, cf_opts[i]);
       std::cout << "[FAIRDB_LOG] Init column family: " << cf_name << std::endl;
     }
 
     opt.statistics = rocksdb::CreateDBStatistics();
+    statistics_ = opt.statistics;
+
+    auto per_cf_flags = [&](const std::string &prop, const std::string &default_value)
+    {
+      std::vector<std::string> vals = Prop2vector(props, prop, default_value);
+      if (vals.size() != 1 && vals.size() != static_cast<size_t>(num_cfs))
+      {
+        throw utils::Exception(prop + " must have one value or one per column family");
+      }
+      std::vector<bool> flags;
+      for (int i = 0; i < num_cfs; ++i)
+      {
+        flags.push_back(vals[vals.size() == 1 ? 0 : i] == "true");
+      }
+      return flags;
+    };
+    std::vector<bool> wal = per_cf_flags(PROP_WAL, PROP_WAL_DEFAULT);
+    std::vector<bool> wal_sync = per_cf_flags(PROP_WAL_SYNC, PROP_WAL_SYNC_DEFAULT);
+    std::vector<bool> no_slowdown = per_cf_flags(PROP_WRITE_NO_SLOWDOWN, PROP_WRITE_NO_SLOWDOWN_DEFAULT);
+    std::vector<bool> low_pri = per_cf_flags(PROP_WRITE_LOW_PRI, PROP_WRITE_LOW_PRI_DEFAULT);
+    merge_update_ = per_cf_flags(PROP_MERGEUPDATE, PROP_MERGEUPDATE_DEFAULT);
+    write_options_.assign(num_cfs, rocksdb::WriteOptions());
+    wal_enabled_ = false;
+    for (int i = 0; i < num_cfs; ++i)
+    {
+      write_options_[i].disableWAL = !wal[i];
+      write_options_[i].sync = wal[i] && wal_sync[i];
+      write_options_[i].no_slowdown = no_slowdown[i];
+      write_options_[i].low_pri = low_pri[i];
+      wal_enabled_ = wal_enabled_ || wal[i];
+      std::cout << "[FAIRDB_LOG] CF " << i << " writes: wal=" << wal[i] << " sync=" << write_options_[i].sync
+                << " no_slowdown=" << no_slowdown[i] << " low_pri=" << low_pri[i] << std::endl;
+    }
 
     rocksdb::Status s;
     if (props.GetProperty(PROP_DESTROY, PROP_DESTROY_DEFAULT) == "true")
@@ -323,6 +847,48 @@ namespace ycsbc
     {
       throw utils::Exception(std::string("RocksDB Open: ") + s.ToString());
     }
+
+    // The DB holds its own reference to the limiter for as long as db_ is open.
+    write_rate_limiter_ = opt.rate_limiter.get();
+    read_rate_limiter_ = write_rate_limiter_ ? write_rate_limiter_->GetReadRateLimiter() : nullptr;
+    usage_snapshot_.reset(new utils::ResourceUsageSnapshot(cf_handles_.size()));
+
+    if (opt.manual_wal_flush)
+    {
+      int interval_ms = std::stoi(props.GetProperty(PROP_WAL_FLUSH_INTERVAL_MS, PROP_WAL_FLUSH_INTERVAL_MS_DEFAULT));
+      if (interval_ms > 0)
+      {
+        const bool sync = props.GetProperty(PROP_WAL_FLUSH_SYNC, PROP_WAL_FLUSH_SYNC_DEFAULT) == "true";
+        wal_flusher.Start(interval_ms, [sync]()
+                          {
+          rocksdb::Status s = db_->FlushWAL(sync);
+          if (!s.ok())
+          {
+            std::cout << "[FAIRDB_LOG] FlushWAL failed: " << s.ToString() << std::endl;
+          } });
+      }
+    }
+
+    if (std::find(blob_files_by_client_.begin(), blob_files_by_client_.end(), true) != blob_files_by_client_.end())
+    {
+      int interval_ms = std::stoi(props.GetProperty(PROP_BLOB_STATS_INTERVAL_MS, PROP_BLOB_STATS_INTERVAL_MS_DEFAULT));
+      if (interval_ms <= 0)
+      {
+        throw utils::Exception("rocksdb.blob_stats_interval_ms must be positive");
+      }
+      SampleBlobUsage();
+      blob_sampler.Start(interval_ms, &RocksdbDB::SampleBlobUsage);
+    }
+
+    for (size_t i = 0; i < cf_handles_.size(); ++i)
+    {
+      TenantHandle tenant;
+      tenant.table = cf_handles_[i]->GetName();
+      tenant.client_id = table2clientId(tenant.table);
+      tenant.cf = cf_handles_[i];
+      tenant.cf_index = static_cast<int>(i);
+      tenants_[tenant.table] = tenant;
+    }
   }
 
   void RocksdbDB::Cleanup()
@@ -332,6 +898,8 @@ namespace ycsbc
     {
       return;
     }
+    wal_flusher.Stop();
+    blob_sampler.Stop();
     for (size_t i = 0; i < cf_handles_.size(); i++)
     {
       if (cf_handles_[i] != nullptr)
@@ -340,6 +908,18 @@ namespace ycsbc
         cf_handles_[i] = nullptr;
       }
     }
+    write_rate_limiter_ = nullptr;
+    read_rate_limiter_ = nullptr;
+    usage_snapshot_.reset();
+    row_cache_.reset();
+    tenants_.clear();
+    blob_files_by_client_.clear();
+    write_options_.clear();
+    merge_update_.clear();
+    schema_.reset();
+    format_by_client_.clear();
+    field_names_.clear();
+    statistics_.reset();
     delete db_;
   }
 
@@ -361,6 +941,13 @@ namespace ycsbc
       opt->env = env;
     }
 
+    if (cpu_layout_ && cpu_layout_->HasRole("rocksdb_bg"))
+    {
+      pinned_env_guard.reset(new CpuPinnedEnv(env, *cpu_layout_));
+      env = pinned_env_guard.get();
+      opt->env = env;
+    }
+
     const std::string options_file = props.GetProperty(PROP_OPTIONS_FILE, PROP_OPTIONS_FILE_DEFAULT);
     if (options_file != "")
     {
@@ -378,42 +965,7 @@ namespace ycsbc
     {
       const std::string compression_type = props.GetProperty(PROP_COMPRESSION,
                                                              PROP_COMPRESSION_DEFAULT);
-      if (compression_type == "no")
-      {
-        opt->compression = rocksdb::kNoCompression;
-      }
-      else if (compression_type == "snappy")
-      {
-        opt->compression = rocksdb::kSnappyCompression;
-      }
-      else if (compression_type == "zlib")
-      {
-        opt->compression = rocksdb::kZlibCompression;
-      }
-      else if (compression_type == "bzip2")
-      {
-        opt->compression = rocksdb::kBZip2Compression;
-      }
-      else if (compression_type == "lz4")
-      {
-        opt->compression = rocksdb::kLZ4Compression;
-      }
-      else if (compression_type == "lz4hc")
-      {
-        opt->compression = rocksdb::kLZ4HCCompression;
-      }
-      else if (compression_type == "xpress")
-      {
-        opt->compression = rocksdb::kXpressCompression;
-      }
-      else if (compression_type == "zstd")
-      {
-        opt->compression = rocksdb::kZSTD;
-      }
-      else
-      {
-        throw utils::Exception("Unknown compression type");
-      }
+      opt->compression = StringToCompressionType(compression_type);
 
       int val = std::stoi(props.GetProperty(PROP_MAX_BG_JOBS, PROP_MAX_BG_JOBS_DEFAULT));
       if (val != 0)
@@ -491,6 +1043,55 @@ namespace ycsbc
       {
         opt->allow_mmap_reads = true;
       }
+      if (props.GetProperty(PROP_ENABLE_PIPELINED_WRITE, PROP_ENABLE_PIPELINED_WRITE_DEFAULT) == "true")
+      {
+        opt->enable_pipelined_write = true;
+      }
+      if (props.GetProperty(PROP_UNORDERED_WRITE, PROP_UNORDERED_WRITE_DEFAULT) == "true")
+      {
+        opt->unordered_write = true;
+      }
+      if (props.GetProperty(PROP_TWO_WRITE_QUEUES, PROP_TWO_WRITE_QUEUES_DEFAULT) == "true")
+      {
+        opt->two_write_queues = true;
+      }
+      if (props.GetProperty(PROP_ALLOW_CONCURRENT_MEMTABLE_WRITE, PROP_ALLOW_CONCURRENT_MEMTABLE_WRITE_DEFAULT) == "false")
+      {
+        opt->allow_concurrent_memtable_write = false;
+      }
+      if (props.GetProperty(PROP_MANUAL_WAL_FLUSH, PROP_MANUAL_WAL_FLUSH_DEFAULT) == "true")
+      {
+        opt->manual_wal_flush = true;
+      }
+      std::vector<std::string> row_cache_vals = Prop2vector(props, PROP_ROW_CACHE_SIZE, PROP_ROW_CACHE_SIZE_DEFAULT);
+      if (row_cache_vals.size() != 1 && row_cache_vals.size() != static_cast<size_t>(num_clients))
+      {
+        throw utils::Exception("PROP_ROW_CACHE_SIZE must have one value or one per column family");
+      }
+      size_t row_cache_capacity = 0;
+      std::vector<size_t> row_cache_quotas;
+      for (const auto &row_cache_val : row_cache_vals)
+      {
+        row_cache_quotas.push_back(std::stoul(row_cache_val));
+        row_cache_capacity += row_cache_quotas.back();
+      }
+      if (row_cache_capacity > 0)
+      {
+        std::shared_ptr<rocksdb::Cache> shared_row_cache = rocksdb::NewLRUCache(row_cache_capacity);
+        if (row_cache_quotas.size() == 1)
+        {
+          // Shared: every tenant may use all of it; the views only count hits.
+          row_cache_quotas.assign(num_clients, row_cache_capacity);
+          row_cache_ = std::make_shared<TenantRowCache>(shared_row_cache, row_cache_quotas, 0);
+        }
+        else
+        {
+          row_cache_ = std::make_shared<TenantRowCache>(shared_row_cache, row_cache_quotas, 1.0);
+        }
+        opt->row_cache = row_cache_;
+        std::cout << "[FAIRDB_LOG] Creating row cache of size " << row_cache_capacity
+                  << (row_cache_vals.size() == 1 ? " shared by all tenants" : " with per-tenant quotas") << std::endl;
+      }
       rocksdb::BlockBasedTableOptions table_options;
       table_options.no_block_cache = true; // We handle block cache at per-CF level
 #if ROCKSDB_MAJOR < 8
@@ -619,8 +1220,128 @@ namespace ycsbc
       throw utils::Exception("PROP_CACHE_SIZE doesn't match number of column families");
     }
 
+    std::vector<int> numa_nodes(cf_opt.size(), -1);
+    if (props.GetProperty(PROP_NUMA_NODES, PROP_NUMA_NODES_DEFAULT) != "")
+    {
+      std::vector<std::string> numa_vals = Prop2vector(props, PROP_NUMA_NODES, PROP_NUMA_NODES_DEFAULT);
+      if (numa_vals.size() != cf_opt.size())
+      {
+        throw utils::Exception("PROP_NUMA_NODES doesn't match number of column families");
+      }
+#ifdef USE_NUMA
+      if (numa_available() < 0)
+      {
+        throw utils::Exception("rocksdb.numa_nodes set but NUMA is not available on this host");
+      }
+      for (size_t i = 0; i < cf_opt.size(); ++i)
+      {
+        numa_nodes[i] = std::stoi(numa_vals[i]);
+        if (numa_nodes[i] > numa_max_node())
+        {
+          throw utils::Exception("rocksdb.numa_nodes names missing node " + numa_vals[i]);
+        }
+      }
+      numa_node_by_client_ = numa_nodes;
+      numa_local_ops_.reset(new utils::MultiTenantCounter(cf_opt.size()));
+      numa_remote_ops_.reset(new utils::MultiTenantCounter(cf_opt.size()));
+#else
+      throw utils::Exception("rocksdb.numa_nodes requires building with USE_NUMA");
+#endif
+    }
+
+    int num_levels = std::stoi(props.GetProperty(PROP_NUM_LEVELS, PROP_NUM_LEVELS_DEFAULT));
+    for (size_t i = 0; i < cf_opt.size(); ++i) {
+      cf_opt[i].num_levels = num_levels;
+    }
+
     // TODO(tgriggs|devbali): cache additions
     bool use_pooled = props.GetProperty(PROP_FAIRDB_USE_POOLED, PROP_FAIRDB_USE_POOLED_DEFAULT) == "true";
+
+    const int num_shard_bits = std::stoi(props.GetProperty(PROP_CACHE_NUM_SHARD_BITS, PROP_CACHE_NUM_SHARD_BITS_DEFAULT));
+    const std::string cache_type = props.GetProperty(PROP_CACHE_TYPE, PROP_CACHE_TYPE_DEFAULT);
+    const bool hyper_clock = cache_type == "hyper_clock";
+    if (!hyper_clock && cache_type != "lru")
+    {
+      throw utils::Exception("Unknown rocksdb.cache_type: " + cache_type);
+    }
+    const size_t configured_entry_charge = std::stoul(props.GetProperty(PROP_CACHE_ESTIMATED_ENTRY_CHARGE, PROP_CACHE_ESTIMATED_ENTRY_CHARGE_DEFAULT));
+    // Entry charge for a HyperClockCache serving CFs [begin, end). Data blocks
+    // dominate the cache and are charged close to block_size, so a cache
+    // shared by several CFs is sized for the largest.
+    auto estimated_entry_charge = [&](size_t begin, size_t end)
+    {
+      size_t charge = configured_entry_charge;
+      for (size_t i = begin; configured_entry_charge == 0 && i < end; ++i)
+      {
+        charge = std::max(charge, LsmBlockSize(props, LsmCfName(i)));
+      }
+      return charge;
+    };
+    if (hyper_clock && use_pooled)
+    {
+      std::cout << "[FAIRDB_LOG] fairdb_use_pooled is ignored with rocksdb.cache_type=hyper_clock" << std::endl;
+    }
+
+    const std::string cache_mode = props.GetProperty(PROP_CACHE_MODE, PROP_CACHE_MODE_DEFAULT);
+    std::shared_ptr<rocksdb::Cache> shared_cache;
+    if (cache_mode == "shared_quota")
+    {
+      size_t shared_capacity = 0;
+      for (const auto &val : vals)
+      {
+        shared_capacity += std::stoul(val);
+      }
+      if (hyper_clock)
+      {
+        const size_t entry_charge = estimated_entry_charge(0, cf_opt.size());
+        shared_cache = rocksdb::HyperClockCacheOptions(shared_capacity, entry_charge, num_shard_bits).MakeSharedCache();
+        std::cout << "[FAIRDB_LOG] Using HyperClockCache, estimated entry charge " << entry_charge << std::endl;
+      }
+      else
+      {
+        rocksdb::LRUCacheOptions cache_opts;
+        cache_opts.capacity = shared_capacity;
+        cache_opts.strict_capacity_limit = false;
+        cache_opts.num_shard_bits = num_shard_bits;
+        cache_opts.low_pri_pool_ratio = std::stod(props.GetProperty(PROP_CACHE_LOW_PRI_POOL_RATIO, PROP_CACHE_LOW_PRI_POOL_RATIO_DEFAULT));
+        if (cache_opts.high_pri_pool_ratio + cache_opts.low_pri_pool_ratio >= 1.0)
+        {
+          throw utils::Exception("rocksdb.cache_low_pri_pool_ratio leaves no bottom pool for over-quota tenants");
+        }
+        shared_cache = rocksdb::NewLRUCache(cache_opts);
+      }
+      std::cout << "[FAIRDB_LOG] Creating shared cache of size " << shared_capacity << " with per-tenant quotas" << std::endl;
+    }
+    else if (cache_mode != "per_cf")
+    {
+      throw utils::Exception("Unknown rocksdb.cache_mode: " + cache_mode);
+    }
+    const double hard_quota_ratio = std::stod(props.GetProperty(PROP_CACHE_HARD_QUOTA_RATIO, PROP_CACHE_HARD_QUOTA_RATIO_DEFAULT));
+
+    std::vector<size_t> secondary_sizes(cf_opt.size(), 0);
+    if (props.GetProperty(PROP_SECONDARY_CACHE_SIZE, PROP_SECONDARY_CACHE_SIZE_DEFAULT) != "")
+    {
+      std::vector<std::string> secondary_vals = Prop2vector(props, PROP_SECONDARY_CACHE_SIZE, PROP_SECONDARY_CACHE_SIZE_DEFAULT);
+      if (secondary_vals.size() != cf_opt.size())
+      {
+        throw utils::Exception("PROP_SECONDARY_CACHE_SIZE doesn't match number of column families");
+      }
+      for (size_t i = 0; i < cf_opt.size(); ++i)
+      {
+        secondary_sizes[i] = std::stoul(secondary_vals[i]);
+      }
+    }
+    const std::string secondary_cache_uri = props.GetProperty(PROP_SECONDARY_CACHE_URI, PROP_SECONDARY_CACHE_URI_DEFAULT);
+    const bool want_secondary = !secondary_cache_uri.empty() ||
+                                std::any_of(secondary_sizes.begin(), secondary_sizes.end(), [](size_t s) { return s > 0; });
+    if (want_secondary && shared_cache)
+    {
+      // TenantQuotaCache boxes its entries, which makes them ineligible for demotion.
+      std::cout << "[FAIRDB_LOG] Secondary caches are not supported with rocksdb.cache_mode=shared_quota, ignoring" << std::endl;
+    }
+    const rocksdb::CompressionType secondary_compression = StringToCompressionType(
+      props.GetProperty(PROP_SECONDARY_CACHE_COMPRESSION, PROP_SECONDARY_CACHE_COMPRESSION_DEFAULT));
+    secondary_caches_by_client_.assign(cf_opt.size(), nullptr);
     // auto client_to_cf = Prop2vector(props, CoreWorkload::CLIENT_TO_CF_MAP, CoreWorkload::CLIENT_TO_CF_MAP_DEFAULT);
 
     for (size_t i = 0; i < cf_opt.size(); ++i) {
@@ -639,7 +1360,51 @@ namespace ycsbc
 
       rocksdb::BlockBasedTableOptions table_options;
       std::string val = vals[i];
-      if (std::stoul(val) > 0) {
+      std::shared_ptr<rocksdb::SecondaryCache> secondary_cache;
+      if (want_secondary && !shared_cache && std::stoul(val) > 0) {
+        if (!secondary_cache_uri.empty()) {
+          std::string uri = secondary_cache_uri;
+          size_t pos = uri.find("{cf}");
+          if (pos != std::string::npos) {
+            uri.replace(pos, 4, std::to_string(i));
+          }
+          rocksdb::Status s = rocksdb::SecondaryCache::CreateFromString(rocksdb::ConfigOptions(), uri, &secondary_cache);
+          if (!s.ok()) {
+            throw utils::Exception(std::string("RocksDB SecondaryCache::CreateFromString: ") + s.ToString());
+          }
+          std::cout << "[FAIRDB_LOG] CF #" << i << " secondary cache: " << uri << std::endl;
+        } else if (secondary_sizes[i] > 0) {
+          rocksdb::CompressedSecondaryCacheOptions secondary_opts;
+          secondary_opts.capacity = secondary_sizes[i];
+          secondary_opts.num_shard_bits = num_shard_bits;
+          secondary_opts.compression_type = secondary_compression;
+          secondary_cache = rocksdb::NewCompressedSecondaryCache(secondary_opts);
+          std::cout << "[FAIRDB_LOG] CF #" << i << " compressed secondary cache of size " << secondary_sizes[i] << std::endl;
+        }
+        if (secondary_cache) {
+          secondary_cache = std::make_shared<TenantSecondaryCache>(secondary_cache);
+          secondary_caches_by_client_[i] = secondary_cache;
+        }
+      }
+      if (shared_cache && std::stoul(val) > 0) {
+        table_options.block_cache = std::make_shared<TenantQuotaCache>(shared_cache, std::stoul(val), hard_quota_ratio);
+        block_caches_by_client_.insert(block_caches_by_client_.begin() + i, table_options.block_cache);
+        std::cout << "[FAIRDB_LOG] CF #" << i << " gets a shared-cache quota of " << val << std::endl;
+      } else if (std::stoul(val) > 0 && hyper_clock) {
+        rocksdb::HyperClockCacheOptions cache_opts(std::stoul(val), estimated_entry_charge(i, i + 1), num_shard_bits);
+        cache_opts.secondary_cache = secondary_cache;
+#ifdef USE_NUMA
+        if (numa_nodes[i] >= 0)
+        {
+          cache_opts.memory_allocator = std::make_shared<NumaMemoryAllocator>(numa_nodes[i]);
+          std::cout << "[FAIRDB_LOG] Binding cache for CF #" << i << " to NUMA node " << numa_nodes[i] << std::endl;
+        }
+#endif
+        table_options.block_cache = cache_opts.MakeSharedCache();
+        block_caches_by_client_.insert(block_caches_by_client_.begin() + i, table_options.block_cache);
+        std::cout << "[FAIRDB_LOG] Creating hyper clock cache for CF #" << i << " of size " << val
+                  << ", estimated entry charge " << cache_opts.estimated_entry_charge << std::endl;
+      } else if (std::stoul(val) > 0) {
 
         int request_additional_delay_microseconds = std::stoi(props.GetProperty(PROP_FAIRDB_CACHE_RAD_MICROSECONDS, PROP_FAIRDB_CACHE_RAD_MICROSECONDS_DEFAULT));
         int read_io_mbps = std::stoi(props.GetProperty(PROP_FAIRDB_IO_READ_CAPACITY_MBPS, PROP_FAIRDB_IO_READ_CAPACITY_MBPS_DEFAULT));
@@ -657,23 +1422,40 @@ namespace ycsbc
         cache_opts.request_additional_delay_microseconds = request_additional_delay_microseconds;
         cache_opts.read_io_mbps = read_io_mbps;
         cache_opts.additional_rampups_supported = 0;
-        cache_opts.num_shard_bits = std::stoi(props.GetProperty(PROP_CACHE_NUM_SHARD_BITS, PROP_CACHE_NUM_SHARD_BITS_DEFAULT));
+        cache_opts.num_shard_bits = num_shard_bits;
+        cache_opts.secondary_cache = secondary_cache;
+#ifdef USE_NUMA
+        if (numa_nodes[i] >= 0)
+        {
+          cache_opts.memory_allocator = std::make_shared<NumaMemoryAllocator>(numa_nodes[i]);
+          std::cout << "[FAIRDB_LOG] Binding cache for CF #" << i << " to NUMA node " << numa_nodes[i] << std::endl;
+        }
+#endif
         table_options.block_cache = rocksdb::NewLRUCache(cache_opts);
         block_caches_by_client_.insert(block_caches_by_client_.begin() + i, table_options.block_cache);
         std::cout << "[FAIRDB_LOG] Creating cache for CF #" << i << " of size " << val << std::endl;
       } else {
         table_options.no_block_cache = true;  // Disable block cache
       }
+      ApplyLsmOptions(props, LsmCfName(i), cf_opt[i], table_options);
+      if (cf_opt[i].enable_blob_files && table_options.block_cache)
+      {
+        // Blobs share the tenant's block cache: one quota bounds both, and
+        // they show up in its cache usage.
+        cf_opt[i].blob_cache = table_options.block_cache;
+      }
       cf_opt[i].table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
-    }
-    int num_levels = std::stoi(props.GetProperty(PROP_NUM_LEVELS, PROP_NUM_LEVELS_DEFAULT));
-    for (size_t i = 0; i < cf_opt.size(); ++i) {
-      cf_opt[i].num_levels = num_levels;
+      blob_files_by_client_.push_back(cf_opt[i].enable_blob_files);
     }
   }
 
   void RocksdbDB::SerializeRow(const std::vector<Field> &values, std::string &data)
   {
+    if (schema_)
+    {
+      schema_->Encode(values, data);
+      return;
+    }
     for (const Field &field : values)
     {
       uint32_t len = field.name.size();
@@ -688,6 +1470,22 @@ namespace ycsbc
   void RocksdbDB::DeserializeRowFilter(std::vector<Field> &values, const char *p, const char *lim,
                                        const std::vector<std::string> &fields)
   {
+    if (schema_)
+    {
+      // Each requested field is two offset reads away.
+      rocksdb::Slice row(p, lim - p);
+      for (const std::string &name : fields)
+      {
+        int i = schema_->IndexOf(name);
+        rocksdb::Slice value;
+        if (i < 0 || !schema_->Field(row, i, value))
+        {
+          throw utils::Exception("Bad schema row or unknown field: " + name);
+        }
+        values.push_back({name, value.ToString()});
+      }
+      return;
+    }
     std::vector<std::string>::const_iterator filter_iter = fields.begin();
     while (p != lim && filter_iter != fields.end())
     {
@@ -719,6 +1517,20 @@ namespace ycsbc
 
   void RocksdbDB::DeserializeRow(std::vector<Field> &values, const char *p, const char *lim)
   {
+    if (schema_)
+    {
+      rocksdb::Slice row(p, lim - p);
+      for (size_t i = 0; i < schema_->field_count(); ++i)
+      {
+        rocksdb::Slice value;
+        if (!schema_->Field(row, i, value))
+        {
+          throw utils::Exception("Bad schema row");
+        }
+        values.push_back({schema_->Name(i), value.ToString()});
+      }
+      return;
+    }
     while (p != lim)
     {
       assert(p < lim);
@@ -741,23 +1553,45 @@ namespace ycsbc
     DeserializeRow(values, p, lim);
   }
 
-  rocksdb::ColumnFamilyHandle *RocksdbDB::table2handle(const std::string &table)
+  void RocksdbDB::UpdateRow(std::vector<Field> &current_values, const std::vector<Field> &values)
   {
-    int cf_idx;
-    if (table == "default")
+    for (const Field &new_field : values)
     {
-      cf_idx = 0;
+      bool found MAYBE_UNUSED = false;
+      for (Field &cur_field : current_values)
+      {
+        if (cur_field.name == new_field.name)
+        {
+          found = true;
+          cur_field.value = new_field.value;
+          break;
+        }
+      }
+      assert(found);
     }
-    else if (table.substr(0, 2) == "cf")
+  }
+
+  const TenantHandle &RocksdbDB::TenantFor(const std::string &table)
+  {
+    auto it = tenants_.find(table);
+    if (it != tenants_.end())
     {
-      cf_idx = std::stoi(table.substr(2));
+      return it->second;
     }
-    else
+    static thread_local TenantHandle unknown;
+    unknown.table = table;
+    return unknown;
+  }
+
+  void RocksdbDB::ResolveTenant(const std::string &table, int client_id, TenantHandle &tenant)
+  {
+    auto it = tenants_.find(table);
+    if (it == tenants_.end())
     {
-      return nullptr;
+      throw utils::Exception("No column family for table " + table);
     }
-    assert(cf_idx < cf_handles_.size());
-    return cf_handles_[cf_idx];
+    tenant = it->second;
+    tenant.client_id = client_id;
   }
 
   int RocksdbDB::table2clientId(const std::string &table)
@@ -773,19 +1607,111 @@ namespace ycsbc
     return -2;
   }
 
-  DB::Status RocksdbDB::ReadSingle(const std::string &table, const std::string &key,
+  void RocksdbDB::BindToTenantNodeSlow(int client_id)
+  {
+#ifdef USE_NUMA
+    if (client_id < 0 || static_cast<size_t>(client_id) >= numa_node_by_client_.size())
+    {
+      return;
+    }
+    int node = numa_node_by_client_[client_id];
+    if (node < 0)
+    {
+      return;
+    }
+    // Only touch the memory policy when this worker switches nodes.
+    static thread_local int preferred_node = -1;
+    if (preferred_node != node)
+    {
+      numa_set_preferred(node);
+      preferred_node = node;
+    }
+    if (numa_node_of_cpu(sched_getcpu()) == node)
+    {
+      numa_local_ops_->update(client_id, 1);
+    }
+    else
+    {
+      numa_remote_ops_->update(client_id, 1);
+    }
+#endif
+  }
+
+  std::vector<ycsbc::utils::TenantNumaStats> RocksdbDB::GetNumaStats()
+  {
+    std::vector<ycsbc::utils::TenantNumaStats> stats;
+    for (size_t i = 0; i < numa_node_by_client_.size(); ++i)
+    {
+      stats.push_back({numa_node_by_client_[i], numa_local_ops_->get_and_reset(i),
+                       numa_remote_ops_->get_and_reset(i)});
+    }
+    return stats;
+  }
+
+  const rocksdb::WriteOptions &RocksdbDB::WriteOptionsFor(const TenantHandle &tenant)
+  {
+    if (tenant.cf_index >= 0 && static_cast<size_t>(tenant.cf_index) < write_options_.size())
+    {
+      return write_options_[tenant.cf_index];
+    }
+    static const rocksdb::WriteOptions unregistered = []()
+    {
+      rocksdb::WriteOptions wopt;
+      wopt.disableWAL = true;
+      return wopt;
+    }();
+    return unregistered;
+  }
+
+  bool RocksdbDB::MergesUpdates(const TenantHandle &tenant)
+  {
+    return tenant.cf_index >= 0 && static_cast<size_t>(tenant.cf_index) < merge_update_.size() &&
+           merge_update_[tenant.cf_index];
+  }
+
+  bool RocksdbDB::GetWalStats(ycsbc::utils::WalStats &stats)
+  {
+    if (!wal_enabled_ || statistics_ == nullptr)
+    {
+      return false;
+    }
+    static std::mutex wal_stats_mu;
+    static uint64_t last_bytes = 0;
+    static uint64_t last_syncs = 0;
+    static uint64_t last_sync_micros = 0;
+    const std::lock_guard<std::mutex> lock(wal_stats_mu);
+
+    uint64_t bytes = statistics_->getTickerCount(rocksdb::WAL_FILE_BYTES);
+    uint64_t syncs = statistics_->getTickerCount(rocksdb::WAL_FILE_SYNCED);
+    rocksdb::HistogramData sync_hist;
+    statistics_->histogramData(rocksdb::WAL_FILE_SYNC_MICROS, &sync_hist);
+
+    stats.bytes_written = bytes - last_bytes;
+    stats.syncs = syncs - last_syncs;
+    stats.avg_sync_us = stats.syncs > 0 ? double(sync_hist.sum - last_sync_micros) / stats.syncs : 0;
+    last_bytes = bytes;
+    last_syncs = syncs;
+    last_sync_micros = sync_hist.sum;
+    return true;
+  }
+
+  DB::Status RocksdbDB::ReadSingle(const TenantHandle &tenant, const std::string &key,
                                    const std::vector<std::string> *fields,
                                    std::vector<Field> &result)
   {
     std::string data;
 
-    auto *handle = table2handle(table);
+    auto *handle = tenant.cf;
     if (handle == nullptr)
     {
-      std::cout << "[FAIRDB_LOG] Bad table/handle: " << table << std::endl;
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
       return kError;
     }
 
+    // Attributes row cache lookups to this tenant.
+    auto &thread_metadata = TG_GetThreadMetadata();
+    thread_metadata.client_id = tenant.client_id;
+
     // Set the rate limiter priority to highest (USER request).
     rocksdb::ReadOptions read_options = rocksdb::ReadOptions();
     read_options.rate_limiter_priority = rocksdb::Env::IOPriority::IO_USER;
@@ -811,18 +1737,18 @@ namespace ycsbc
     return kOK;
   }
 
-  DB::Status RocksdbDB::ReadMany(const std::string &table, const std::vector<std::string> &keys,
+  DB::Status RocksdbDB::ReadMany(const TenantHandle &tenant, const std::vector<std::string> &keys,
                    const std::vector<std::vector<std::string>> *fields,
                    std::vector<std::vector<Field>> &result) {
-    auto *handle = table2handle(table);
+    auto *handle = tenant.cf;
     if (handle == nullptr)
     {
-      std::cout << "[FAIRDB_LOG] Bad table/handle: " << table << std::endl;
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
       return kError;
     }
 
     auto &thread_metadata = TG_GetThreadMetadata();
-    thread_metadata.client_id = table2clientId(table);
+    thread_metadata.client_id = tenant.client_id;
 
     // Set the rate limiter priority to highest (USER request).
     rocksdb::ReadOptions read_options = rocksdb::ReadOptions();
@@ -865,20 +1791,184 @@ namespace ycsbc
     return kOK;
   }
 
-  DB::Status RocksdbDB::ScanSingle(const std::string &table, const std::string &key, int len,
+  void RocksdbDB::MultiRead(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                            const std::vector<std::vector<std::string>> *fields,
+                            std::vector<std::vector<Field>> &result, std::vector<Status> &statuses)
+  {
+    if (IsCompKey(FormatOf(tenant)))
+    {
+      DB::MultiRead(tenant, keys, fields, result, statuses);
+      return;
+    }
+    result.resize(keys.size());
+    statuses.assign(keys.size(), kError);
+    auto *handle = tenant.cf;
+    if (handle == nullptr)
+    {
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
+      return;
+    }
+    BindToTenantNode(tenant);
+
+    auto &thread_metadata = TG_GetThreadMetadata();
+    thread_metadata.client_id = tenant.client_id;
+
+    rocksdb::ReadOptions read_options = rocksdb::ReadOptions();
+    read_options.rate_limiter_priority = rocksdb::Env::IOPriority::IO_USER;
+
+    // The batched MultiGet shares block cache lookups and filter probes
+    // across keys that land in the same SST blocks.
+    std::vector<rocksdb::Slice> key_slices(keys.begin(), keys.end());
+    std::vector<rocksdb::PinnableSlice> values(keys.size());
+    std::vector<rocksdb::Status> db_statuses(keys.size());
+    db_->MultiGet(read_options, handle, keys.size(), key_slices.data(), values.data(), db_statuses.data());
+
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+      if (db_statuses[i].IsNotFound())
+      {
+        statuses[i] = kNotFound;
+        continue;
+      }
+      else if (!db_statuses[i].ok())
+      {
+        throw utils::Exception(std::string("RocksDB MultiGet for key ") + keys[i] + ": " + db_statuses[i].ToString());
+      }
+      const char *p = values[i].data();
+      const char *lim = p + values[i].size();
+      if (fields != nullptr)
+      {
+        DeserializeRowFilter(result[i], p, lim, (*fields)[i]);
+      }
+      else
+      {
+        DeserializeRow(result[i], p, lim);
+        assert(result[i].size() == static_cast<size_t>(fieldcount_));
+      }
+      statuses[i] = kOK;
+    }
+  }
+
+  void RocksdbDB::MultiWrite(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                             std::vector<std::vector<Field>> &values, const std::vector<bool> &is_update,
+                             std::vector<Status> &statuses)
+  {
+    statuses.assign(keys.size(), kError);
+    auto *handle = tenant.cf;
+    if (handle == nullptr)
+    {
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
+      return;
+    }
+    BindToTenantNode(tenant);
+
+    auto &thread_metadata = TG_GetThreadMetadata();
+    thread_metadata.client_id = tenant.client_id;
+
+    // Composite-key rows need no read: every request is a Put per field.
+    const RocksFormat format = FormatOf(tenant);
+    if (IsCompKey(format))
+    {
+      rocksdb::WriteBatch batch;
+      for (size_t i = 0; i < keys.size(); i++)
+      {
+        AppendCompKeyPuts(format, handle, keys[i], values[i], batch);
+      }
+      statuses.assign(keys.size(), CheckWriteStatus(db_->Write(WriteOptionsFor(tenant), &batch), "Write"));
+      return;
+    }
+
+    // Updates rewrite the whole row unless they go through the merge
+    // operator, so their current rows are fetched with one MultiGet first.
+    const bool merge_updates = MergesUpdates(tenant);
+    std::vector<rocksdb::Slice> read_keys;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+      if (is_update[i] && !merge_updates)
+      {
+        read_keys.emplace_back(keys[i]);
+      }
+    }
+    std::vector<rocksdb::PinnableSlice> current(read_keys.size());
+    std::vector<rocksdb::Status> read_statuses(read_keys.size());
+    if (!read_keys.empty())
+    {
+      rocksdb::ReadOptions read_options = rocksdb::ReadOptions();
+      read_options.rate_limiter_priority = rocksdb::Env::IOPriority::IO_USER;
+      db_->MultiGet(read_options, handle, read_keys.size(), read_keys.data(), current.data(),
+                    read_statuses.data());
+    }
+
+    // Rows already put in this batch, so a later update of the same key
+    // builds on them instead of on the stale stored row.
+    std::unordered_map<std::string, std::string> batched_rows;
+    rocksdb::WriteBatch batch;
+    size_t next_read = 0;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+      std::string data;
+      if (is_update[i] && merge_updates)
+      {
+        FieldPatchMergeOperator::EncodePatch(values[i], data);
+        batch.Merge(handle, keys[i], data);
+        statuses[i] = kOK;
+        continue;
+      }
+      if (is_update[i])
+      {
+        const size_t r = next_read++;
+        std::vector<Field> current_values;
+        auto it = batched_rows.find(keys[i]);
+        if (it != batched_rows.end())
+        {
+          DeserializeRow(current_values, it->second);
+        }
+        else if (read_statuses[r].IsNotFound())
+        {
+          statuses[i] = kNotFound;
+          continue;
+        }
+        else if (!read_statuses[r].ok())
+        {
+          throw utils::Exception(std::string("RocksDB MultiGet for key ") + keys[i] + ": " + read_statuses[r].ToString());
+        }
+        else
+        {
+          DeserializeRow(current_values, current[r].data(), current[r].data() + current[r].size());
+        }
+        assert(current_values.size() == static_cast<size_t>(fieldcount_));
+        UpdateRow(current_values, values[i]);
+        SerializeRow(current_values, data);
+      }
+      else
+      {
+        SerializeRow(values[i], data);
+      }
+      batch.Put(handle, keys[i], data);
+      batched_rows[keys[i]] = std::move(data);
+      statuses[i] = kOK;
+    }
+
+    rocksdb::Status s = db_->Write(WriteOptionsFor(tenant), &batch);
+    if (CheckWriteStatus(s, "Write") != kOK)
+    {
+      std::replace(statuses.begin(), statuses.end(), kOK, kError);
+    }
+  }
+
+  DB::Status RocksdbDB::ScanSingle(const TenantHandle &tenant, const std::string &key, const std::string &upper_bound, int len,
                                    const std::vector<std::string> *fields,
                                    std::vector<std::vector<Field>> &result)
   {
-    auto *handle = table2handle(table);
+    auto *handle = tenant.cf;
     if (handle == nullptr)
     {
-      std::cout << "[FAIRDB_LOG] Bad table/handle: " << table << std::endl;
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
       return kError;
     }
 
-    // Set the rate limiter priority to highest (USER request).
-    rocksdb::ReadOptions read_options = rocksdb::ReadOptions();
-    read_options.rate_limiter_priority = rocksdb::Env::IOPriority::IO_USER;
+    rocksdb::Slice upper_bound_slice(upper_bound);
+    rocksdb::ReadOptions read_options = IteratorReadOptions(upper_bound.empty() ? nullptr : &upper_bound_slice);
 
     rocksdb::Iterator *db_iter = db_->NewIterator(read_options, handle);
     db_iter->Seek(key);
@@ -902,15 +1992,29 @@ namespace ycsbc
     return kOK;
   }
 
-  DB::Status RocksdbDB::UpdateSingle(const std::string &table, const std::string &key,
+  DB::Status RocksdbDB::UpdateSingle(const TenantHandle &tenant, const std::string &key,
                                      std::vector<Field> &values)
   {
+    if (MergesUpdates(tenant))
+    {
+      return MergeSingle(tenant, key, values);
+    }
+    auto *handle = tenant.cf;
+    if (handle == nullptr)
+    {
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
+      return kError;
+    }
+
+    auto &thread_metadata = TG_GetThreadMetadata();
+    thread_metadata.client_id = tenant.client_id;
+
     // Set the rate limiter priority to highest (USER request).
     rocksdb::ReadOptions read_options = rocksdb::ReadOptions();
     read_options.rate_limiter_priority = rocksdb::Env::IOPriority::IO_USER;
 
     std::string data;
-    rocksdb::Status s = db_->Get(read_options, key, &data);
+    rocksdb::Status s = db_->Get(read_options, handle, key, &data);
     if (s.IsNotFound())
     {
       return kNotFound;
@@ -922,87 +2026,65 @@ namespace ycsbc
     std::vector<Field> current_values;
     DeserializeRow(current_values, data);
     assert(current_values.size() == static_cast<size_t>(fieldcount_));
-    for (Field &new_field : values)
-    {
-      bool found MAYBE_UNUSED = false;
-      for (Field &cur_field : current_values)
-      {
-        if (cur_field.name == new_field.name)
-        {
-          found = true;
-          cur_field.value = new_field.value;
-          break;
-        }
-      }
-      assert(found);
-    }
-    rocksdb::WriteOptions wopt;
-    // TODO: WAL disabled
-    wopt.disableWAL = true;
+    UpdateRow(current_values, values);
 
     data.clear();
     SerializeRow(current_values, data);
-    s = db_->Put(wopt, key, data);
-    if (!s.ok())
-    {
-      throw utils::Exception(std::string("RocksDB Put: ") + s.ToString());
-    }
-    return kOK;
+    s = db_->Put(WriteOptionsFor(tenant), handle, key, data);
+    return CheckWriteStatus(s, "Put");
   }
 
-  DB::Status RocksdbDB::MergeSingle(const std::string &table, const std::string &key,
+  // Blind write: the patch is folded into the row on read or compaction.
+  DB::Status RocksdbDB::MergeSingle(const TenantHandle &tenant, const std::string &key,
                                     std::vector<Field> &values)
   {
-    std::string data;
-    SerializeRow(values, data);
-    rocksdb::WriteOptions wopt;
-    rocksdb::Status s = db_->Merge(wopt, key, data);
-    if (!s.ok())
+    auto *handle = tenant.cf;
+    if (handle == nullptr)
     {
-      throw utils::Exception(std::string("RocksDB Merge: ") + s.ToString());
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
+      return kError;
     }
-    return kOK;
+
+    auto &thread_metadata = TG_GetThreadMetadata();
+    thread_metadata.client_id = tenant.client_id;
+
+    std::string patch;
+    FieldPatchMergeOperator::EncodePatch(values, patch);
+    rocksdb::Status s = db_->Merge(WriteOptionsFor(tenant), handle, key, patch);
+    return CheckWriteStatus(s, "Merge");
   }
 
-  DB::Status RocksdbDB::InsertSingle(const std::string &table, const std::string &key,
+  DB::Status RocksdbDB::InsertSingle(const TenantHandle &tenant, const std::string &key,
                                      std::vector<Field> &values)
   {
-    auto *handle = table2handle(table);
+    auto *handle = tenant.cf;
     if (handle == nullptr)
     {
-      std::cout << "[FAIRDB_LOG] Bad table/handle: " << table << std::endl;
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
       return kError;
     }
 
     auto &thread_metadata = TG_GetThreadMetadata();
-    thread_metadata.client_id = table2clientId(table);
+    thread_metadata.client_id = tenant.client_id;
 
     std::string data;
     SerializeRow(values, data);
-    rocksdb::WriteOptions wopt;
-    // TODO: WAL disabled
-    wopt.disableWAL = true;
-    rocksdb::Status s = db_->Put(wopt, handle, key, data);
-    // rocksdb::Status s = db_->Put(wopt, key, data);
-    if (!s.ok())
-    {
-      throw utils::Exception(std::string("RocksDB Put: ") + s.ToString());
-    }
-    return kOK;
+    rocksdb::Status s = db_->Put(WriteOptionsFor(tenant), handle, key, data);
+    return CheckWriteStatus(s, "Put");
   }
 
-  DB::Status RocksdbDB::InsertMany(const std::string &table, int start_key,
+  DB::Status RocksdbDB::InsertMany(const TenantHandle &tenant, int start_key,
                                    std::vector<Field> &values, int num_keys)
   {
-    auto *handle = table2handle(table);
+    auto *handle = tenant.cf;
     if (handle == nullptr)
     {
-      std::cout << "[FAIRDB_LOG] Bad table/handle: " << table << std::endl;
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
       return kError;
     }
 
     auto &thread_metadata = TG_GetThreadMetadata();
-    thread_metadata.client_id = table2clientId(table);
+    thread_metadata.client_id = tenant.client_id;
 
     std::string data;
     SerializeRow(values, data);
@@ -1012,32 +2094,24 @@ namespace ycsbc
       batch.Put(handle, "user" + std::to_string(start_key + i), data);
     }
 
-    rocksdb::WriteOptions wopt;
-    // TODO: WAL disabled
-    wopt.disableWAL = true;
-    rocksdb::Status s = db_->Write(wopt, &batch);
-
-    if (!s.ok())
-    {
-      throw utils::Exception(std::string("RocksDB WriteBatch: ") + s.ToString());
-    }
-    return kOK;
+    rocksdb::Status s = db_->Write(WriteOptionsFor(tenant), &batch);
+    return CheckWriteStatus(s, "WriteBatch");
   }
 
 
-  DB::Status RocksdbDB::ReadModifyInsertMany(const std::string &table, 
+  DB::Status RocksdbDB::ReadModifyInsertMany(const TenantHandle &tenant, 
                                             const std::vector<std::string> &keys,
                                             const std::vector<std::vector<std::string>> *fields,
                                             std::vector<std::vector<Field>> &result,
                                             std::vector<Field> &new_values) {
-    auto *handle = table2handle(table);
+    auto *handle = tenant.cf;
     if (handle == nullptr) {
-      std::cout << "[FAIRDB_LOG] Bad table/handle: " << table << std::endl;
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
       return kError;
     }
 
     auto &thread_metadata = TG_GetThreadMetadata();
-    thread_metadata.client_id = table2clientId(table);
+    thread_metadata.client_id = tenant.client_id;
 
     // First perform the read operation
     rocksdb::ReadOptions read_options = rocksdb::ReadOptions();
@@ -1082,17 +2156,333 @@ namespace ycsbc
       batch.Put(handle, key, data);
     }
 
-    rocksdb::WriteOptions wopt;
-    wopt.disableWAL = true;  // Maintaining the same WAL setting as InsertMany
-    rocksdb::Status write_status = db_->Write(wopt, &batch);
+    rocksdb::Status write_status = db_->Write(WriteOptionsFor(tenant), &batch);
+    return CheckWriteStatus(write_status, "WriteBatch");
+  }
+
+  // Row-major keys sort a row's fields together, so a row is one bounded
+  // range; column-major keys sort a field's values together, so a scan
+  // projecting few fields reads only those columns. Keys and field names
+  // must not contain kCompKeySep.
+  std::string RocksdbDB::BuildCompKey(RocksFormat format, const std::string &key, const std::string &field_name)
+  {
+    return format == kRowMajor ? key + kCompKeySep + field_name : field_name + kCompKeySep + key;
+  }
+
+  void RocksdbDB::SplitCompKey(RocksFormat format, const rocksdb::Slice &comp_key, std::string &key,
+                               std::string &field_name)
+  {
+    const char *sep = static_cast<const char *>(std::memchr(comp_key.data(), kCompKeySep, comp_key.size()));
+    const size_t n = sep == nullptr ? comp_key.size() : sep - comp_key.data();
+    std::string first(comp_key.data(), n);
+    std::string second = sep == nullptr ? std::string() : std::string(sep + 1, comp_key.size() - n - 1);
+    if (format == kRowMajor)
+    {
+      key = std::move(first);
+      field_name = std::move(second);
+    }
+    else
+    {
+      field_name = std::move(first);
+      key = std::move(second);
+    }
+  }
+
+  void RocksdbDB::AppendCompKeyPuts(RocksFormat format, rocksdb::ColumnFamilyHandle *handle, const std::string &key,
+                                    const std::vector<Field> &values, rocksdb::WriteBatch &batch)
+  {
+    for (const Field &field : values)
+    {
+      batch.Put(handle, BuildCompKey(format, key, field.name), field.value);
+    }
+  }
+
+  // One batched MultiGet of the composite keys; fields the row lacks are
+  // skipped, and a row with none of them is not found.
+  DB::Status RocksdbDB::GetCompKeyFields(const TenantHandle &tenant, const std::string &key,
+                                         const std::vector<std::string> &field_names, std::vector<Field> &result)
+  {
+    const RocksFormat format = FormatOf(tenant);
+    std::vector<std::string> comp_keys;
+    comp_keys.reserve(field_names.size());
+    for (const std::string &name : field_names)
+    {
+      comp_keys.push_back(BuildCompKey(format, key, name));
+    }
+    std::vector<rocksdb::Slice> key_slices(comp_keys.begin(), comp_keys.end());
+    std::vector<rocksdb::PinnableSlice> values(comp_keys.size());
+    std::vector<rocksdb::Status> statuses(comp_keys.size());
+
+    rocksdb::ReadOptions read_options = rocksdb::ReadOptions();
+    read_options.rate_limiter_priority = rocksdb::Env::IOPriority::IO_USER;
+    db_->MultiGet(read_options, tenant.cf, comp_keys.size(), key_slices.data(), values.data(), statuses.data());
+
+    for (size_t i = 0; i < comp_keys.size(); i++)
+    {
+      if (statuses[i].IsNotFound())
+      {
+        continue;
+      }
+      else if (!statuses[i].ok())
+      {
+        throw utils::Exception(std::string("RocksDB MultiGet for key ") + comp_keys[i] + ": " + statuses[i].ToString());
+      }
+      result.push_back({field_names[i], values[i].ToString()});
+    }
+    return result.empty() ? kNotFound : kOK;
+  }
+
+  DB::Status RocksdbDB::ReadCompKey(const TenantHandle &tenant, const std::string &key,
+                                    const std::vector<std::string> *fields, std::vector<Field> &result)
+  {
+    auto *handle = tenant.cf;
+    if (handle == nullptr)
+    {
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
+      return kError;
+    }
+
+    auto &thread_metadata = TG_GetThreadMetadata();
+    thread_metadata.client_id = tenant.client_id;
+
+    // Projections are point lookups either way; so is a whole column-major
+    // row, whose fields live in different columns.
+    const RocksFormat format = FormatOf(tenant);
+    if (fields != nullptr || format == kColumnMajor)
+    {
+      return GetCompKeyFields(tenant, key, fields != nullptr ? *fields : field_names_, result);
+    }
+
+    // A whole row-major row is one range.
+    const std::string lower = key + kCompKeySep;
+    const std::string upper = key + kCompKeyEnd;
+    rocksdb::Slice upper_bound(upper);
+    rocksdb::ReadOptions read_options = IteratorReadOptions(&upper_bound);
+
+    rocksdb::Iterator *db_iter = db_->NewIterator(read_options, handle);
+    std::string cur_key, cur_field;
+    for (db_iter->Seek(lower); db_iter->Valid(); db_iter->Next())
+    {
+      SplitCompKey(format, db_iter->key(), cur_key, cur_field);
+      result.push_back({cur_field, db_iter->value().ToString()});
+    }
+    rocksdb::Status s = db_iter->status();
+    delete db_iter;
+    if (!s.ok())
+    {
+      throw utils::Exception(std::string("RocksDB Iterator: ") + s.ToString());
+    }
+    return result.empty() ? kNotFound : kOK;
+  }
+
+  DB::Status RocksdbDB::ReadManyCompKey(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                                        const std::vector<std::vector<std::string>> *fields,
+                                        std::vector<std::vector<Field>> &result)
+  {
+    result.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+      Status s = ReadCompKey(tenant, keys[i], fields != nullptr ? &(*fields)[i] : nullptr, result[i]);
+      if (s == kError)
+      {
+        return s;
+      }
+    }
+    return kOK;
+  }
+
+  DB::Status RocksdbDB::ScanCompKey(const TenantHandle &tenant, const std::string &key, const std::string &upper_bound, int len,
+                                    const std::vector<std::string> *fields,
+                                    std::vector<std::vector<Field>> &result)
+  {
+    if (tenant.cf == nullptr)
+    {
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
+      return kError;
+    }
+
+    auto &thread_metadata = TG_GetThreadMetadata();
+    thread_metadata.client_id = tenant.client_id;
+
+    if (FormatOf(tenant) == kRowMajor)
+    {
+      return ScanCompKeyRM(tenant, key, upper_bound, len, fields, result);
+    }
+    return ScanCompKeyCM(tenant, key, upper_bound, len, fields, result);
+  }
 
-    if (!write_status.ok()) {
-      throw utils::Exception(std::string("RocksDB WriteBatch: ") + write_status.ToString());
+  // Walks consecutive composite keys from the start row, one row per change
+  // of row key, keeping only the projected fields. Composite keys sort by
+  // row key first (see kCompKeySep), so the row bound bounds them too.
+  DB::Status RocksdbDB::ScanCompKeyRM(const TenantHandle &tenant, const std::string &key, const std::string &upper_bound, int len,
+                                      const std::vector<std::string> *fields,
+                                      std::vector<std::vector<Field>> &result)
+  {
+    rocksdb::Slice upper_bound_slice(upper_bound);
+    rocksdb::ReadOptions read_options = IteratorReadOptions(upper_bound.empty() ? nullptr : &upper_bound_slice);
+
+    rocksdb::Iterator *db_iter = db_->NewIterator(read_options, tenant.cf);
+    std::string row_key, cur_key, cur_field;
+    for (db_iter->Seek(key + kCompKeySep); db_iter->Valid(); db_iter->Next())
+    {
+      SplitCompKey(kRowMajor, db_iter->key(), cur_key, cur_field);
+      if (result.empty() || cur_key != row_key)
+      {
+        if (static_cast<int>(result.size()) == len)
+        {
+          break;
+        }
+        row_key = cur_key;
+        result.push_back(std::vector<Field>());
+      }
+      if (fields == nullptr || std::find(fields->begin(), fields->end(), cur_field) != fields->end())
+      {
+        result.back().push_back({cur_field, db_iter->value().ToString()});
+      }
+    }
+    rocksdb::Status s = db_iter->status();
+    delete db_iter;
+    if (!s.ok())
+    {
+      throw utils::Exception(std::string("RocksDB Iterator: ") + s.ToString());
     }
+    return kOK;
+  }
 
+  // One bounded iterator per projected column, each reading len values from
+  // the start key. Rows are keyed by the first column; a row missing from
+  // it is dropped.
+  DB::Status RocksdbDB::ScanCompKeyCM(const TenantHandle &tenant, const std::string &key, const std::string &upper_bound, int len,
+                                      const std::vector<std::string> *fields,
+                                      std::vector<std::vector<Field>> &result)
+  {
+    const std::vector<std::string> &columns = fields != nullptr ? *fields : field_names_;
+    std::unordered_map<std::string, size_t> row_index;
+    std::string cur_key, cur_field;
+    for (size_t c = 0; c < columns.size(); c++)
+    {
+      const std::string upper = upper_bound.empty() ? columns[c] + kCompKeyEnd : BuildCompKey(kColumnMajor, upper_bound, columns[c]);
+      rocksdb::Slice upper_slice(upper);
+      rocksdb::ReadOptions read_options = IteratorReadOptions(&upper_slice);
+
+      rocksdb::Iterator *db_iter = db_->NewIterator(read_options, tenant.cf);
+      db_iter->Seek(BuildCompKey(kColumnMajor, key, columns[c]));
+      for (int i = 0; db_iter->Valid() && i < len; i++, db_iter->Next())
+      {
+        SplitCompKey(kColumnMajor, db_iter->key(), cur_key, cur_field);
+        if (c == 0)
+        {
+          row_index[cur_key] = result.size();
+          result.push_back(std::vector<Field>());
+        }
+        auto it = row_index.find(cur_key);
+        if (it != row_index.end())
+        {
+          result[it->second].push_back({cur_field, db_iter->value().ToString()});
+        }
+      }
+      rocksdb::Status s = db_iter->status();
+      delete db_iter;
+      if (!s.ok())
+      {
+        throw utils::Exception(std::string("RocksDB Iterator: ") + s.ToString());
+      }
+    }
     return kOK;
   }
 
+  // Serves both inserts and updates: an update of one field is one small
+  // Put, with no read of the rest of the row.
+  DB::Status RocksdbDB::InsertCompKey(const TenantHandle &tenant, const std::string &key,
+                                      std::vector<Field> &values)
+  {
+    auto *handle = tenant.cf;
+    if (handle == nullptr)
+    {
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
+      return kError;
+    }
+
+    auto &thread_metadata = TG_GetThreadMetadata();
+    thread_metadata.client_id = tenant.client_id;
+
+    const RocksFormat format = FormatOf(tenant);
+    if (values.size() == 1)
+    {
+      rocksdb::Status s = db_->Put(WriteOptionsFor(tenant), handle, BuildCompKey(format, key, values[0].name),
+                                   values[0].value);
+      return CheckWriteStatus(s, "Put");
+    }
+    rocksdb::WriteBatch batch;
+    AppendCompKeyPuts(format, handle, key, values, batch);
+    rocksdb::Status s = db_->Write(WriteOptionsFor(tenant), &batch);
+    return CheckWriteStatus(s, "WriteBatch");
+  }
+
+  DB::Status RocksdbDB::DeleteCompKey(const TenantHandle &tenant, const std::string &key)
+  {
+    auto *handle = tenant.cf;
+    if (handle == nullptr)
+    {
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
+      return kError;
+    }
+
+    const RocksFormat format = FormatOf(tenant);
+    rocksdb::WriteBatch batch;
+    for (const std::string &name : field_names_)
+    {
+      batch.Delete(handle, BuildCompKey(format, key, name));
+    }
+    rocksdb::Status s = db_->Write(WriteOptionsFor(tenant), &batch);
+    return CheckWriteStatus(s, "WriteBatch");
+  }
+
+  DB::Status RocksdbDB::InsertManyCompKey(const TenantHandle &tenant, int start_key,
+                                          std::vector<Field> &values, int num_keys)
+  {
+    auto *handle = tenant.cf;
+    if (handle == nullptr)
+    {
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
+      return kError;
+    }
+
+    auto &thread_metadata = TG_GetThreadMetadata();
+    thread_metadata.client_id = tenant.client_id;
+
+    const RocksFormat format = FormatOf(tenant);
+    rocksdb::WriteBatch batch;
+    for (int i = 0; i < num_keys; ++i)
+    {
+      AppendCompKeyPuts(format, handle, "user" + std::to_string(start_key + i), values, batch);
+    }
+    rocksdb::Status s = db_->Write(WriteOptionsFor(tenant), &batch);
+    return CheckWriteStatus(s, "WriteBatch");
+  }
+
+  DB::Status RocksdbDB::ReadModifyInsertManyCompKey(const TenantHandle &tenant,
+                                                    const std::vector<std::string> &keys,
+                                                    const std::vector<std::vector<std::string>> *fields,
+                                                    std::vector<std::vector<Field>> &result,
+                                                    std::vector<Field> &new_values)
+  {
+    Status s = ReadManyCompKey(tenant, keys, fields, result);
+    if (s != kOK)
+    {
+      return s;
+    }
+
+    const RocksFormat format = FormatOf(tenant);
+    rocksdb::WriteBatch batch;
+    for (const auto &key : keys)
+    {
+      AppendCompKeyPuts(format, tenant.cf, key, new_values, batch);
+    }
+    rocksdb::Status write_status = db_->Write(WriteOptionsFor(tenant), &batch);
+    return CheckWriteStatus(write_status, "WriteBatch");
+  }
+
   // TODO(tgriggs): remove this
   void RocksdbDB::UpdateRateLimit(int client_id, int64_t rate_limit_bytes)
   {
@@ -1101,69 +2491,127 @@ namespace ycsbc
     (void)rate_limit_bytes;
   }
 
-  // TODO(tgriggs): remove this
   void RocksdbDB::UpdateMemtableSize(int client_id, int memtable_size_bytes)
   {
+    if (client_id < 0 || client_id >= static_cast<int>(cf_handles_.size()))
+    {
+      throw utils::Exception("UpdateMemtableSize: no column family for client " + std::to_string(client_id));
+    }
     std::unordered_map<std::string, std::string> cf_opt_updates;
     cf_opt_updates["write_buffer_size"] = std::to_string(memtable_size_bytes);
-    cf_opt_updates["max_write_buffer_number"] = std::to_string(2);
-    db_->SetOptions(cf_handles_[0], cf_opt_updates);
-    db_->SetOptions(cf_handles_[1], cf_opt_updates);
+    rocksdb::Status s = db_->SetOptions(cf_handles_[client_id], cf_opt_updates);
+    if (!s.ok())
+    {
+      throw utils::Exception(std::string("RocksDB SetOptions: ") + s.ToString());
+    }
+  }
+
+  // One SetOptions call per CF so both options change in the same
+  // MutableCFOptions install (and a single superversion bump).
+  void RocksdbDB::UpdateMemtableShares(const std::vector<ycsbc::utils::MemtableShare> &shares)
+  {
+    for (const auto &share : shares)
+    {
+      if (share.client_id < 0 || share.client_id >= static_cast<int>(cf_handles_.size()))
+      {
+        throw utils::Exception("UpdateMemtableShares: no column family for client " + std::to_string(share.client_id));
+      }
+      std::unordered_map<std::string, std::string> cf_opt_updates;
+      cf_opt_updates["write_buffer_size"] = std::to_string(share.write_buffer_size_bytes);
+      // A single memtable would stall writes during every flush.
+      cf_opt_updates["max_write_buffer_number"] = std::to_string(std::max(2, share.max_write_buffer_number));
+      rocksdb::Status s = db_->SetOptions(cf_handles_[share.client_id], cf_opt_updates);
+      if (!s.ok())
+      {
+        throw utils::Exception(std::string("RocksDB SetOptions: ") + s.ToString());
+      }
+    }
   }
 
   // TODO(tgriggs): is there a way to perform the memtable updates without converting to string?
   void RocksdbDB::UpdateResourceShares(std::vector<ycsbc::utils::MultiTenantResourceShares> res_opts)
   {
-    // std::unordered_map<std::string, std::string> cf_opt_updates;
-    // for (size_t i = 0; i < res_opts.size(); ++i) {
-    //   cf_opt_updates["write_buffer_size"] = std::to_string(res_opts[i].write_buffer_size_kb * 1024);
-    //   cf_opt_updates["max_write_buffer_number"] = std::to_string(res_opts[i].max_write_buffer_number);
-    //   db_->SetOptions(cf_handles_[i], cf_opt_updates);
-    // }
-
-    // TODO(tgriggs): restructure this so that we don't have to rearrange on every update
-    std::vector<int64_t> write_rate_limits(res_opts.size());
-    std::vector<int64_t> read_rate_limits(res_opts.size());
+    // Memtable options are applied separately (UpdateMemtableShares) and
+    // only when they change, since every SetOptions installs a new
+    // superversion.
+    if (write_rate_limiter_ == nullptr)
+    {
+      throw utils::Exception("[FAIRDB_LOG] Cannot enable scheduler thread without rate limiter.");
+    }
+    // Only the scheduler thread calls this; reuse its buffers across calls.
+    static thread_local std::vector<int64_t> write_rate_limits;
+    static thread_local std::vector<int64_t> read_rate_limits;
+    write_rate_limits.resize(res_opts.size());
+    read_rate_limits.resize(res_opts.size());
     for (size_t i = 0; i < res_opts.size(); ++i)
     {
-      write_rate_limits[i] = res_opts[i].write_rate_limit_kbs * 1024;
-      read_rate_limits[i] = res_opts[i].read_rate_limit_kbs * 1024;
+      write_rate_limits[i] = int64_t(res_opts[i].write_rate_limit_kbs) * 1024;
+      read_rate_limits[i] = int64_t(res_opts[i].read_rate_limit_kbs) * 1024;
     }
-    std::shared_ptr<rocksdb::RateLimiter> write_rate_limiter = db_->GetOptions().rate_limiter;
-    rocksdb::RateLimiter *read_rate_limiter = write_rate_limiter->GetReadRateLimiter();
-    write_rate_limiter->SetBytesPerSecond(write_rate_limits);
-    read_rate_limiter->SetBytesPerSecond(read_rate_limits);
+    write_rate_limiter_->SetBytesPerSecond(write_rate_limits);
+    read_rate_limiter_->SetBytesPerSecond(read_rate_limits);
   }
 
   std::vector<ycsbc::utils::MultiTenantResourceUsage> RocksdbDB::GetResourceUsage() {
-    std::shared_ptr<rocksdb::RateLimiter> write_rate_limiter = db_->GetOptions().rate_limiter;
-    if (write_rate_limiter == nullptr) {
+    std::vector<ycsbc::utils::MultiTenantResourceUsage> all_stats(cf_handles_.size());
+    ReadResourceUsage(all_stats);
+    return all_stats;
+  }
+
+  // Samples the limiter counters into the seqlock snapshot, then copies it
+  // out. Concurrent callers publish at most once between them and never
+  // see a torn cut across tenants.
+  void RocksdbDB::ReadResourceUsage(std::vector<ycsbc::utils::MultiTenantResourceUsage> &usage) {
+    if (write_rate_limiter_ == nullptr) {
       throw utils::Exception("[FAIRDB_LOG] Cannot enable scheduler thread without rate limiter.");
     }
-    rocksdb::RateLimiter *read_rate_limiter = write_rate_limiter->GetReadRateLimiter();
+    usage_snapshot_->TryPublish([](size_t i, int64_t *written_kb, int64_t *read_kb) {
+      *written_kb = write_rate_limiter_->GetTotalBytesThroughForClient(i) / 1024;
+      *read_kb = read_rate_limiter_->GetTotalBytesThroughForClient(i) / 1024;
+    });
+    usage_snapshot_->Read(usage);
+  }
 
-    int num_clients = cf_handles_.size();
-    std::vector<ycsbc::utils::MultiTenantResourceUsage> all_stats;
-    all_stats.reserve(num_clients);
-    for (int i = 0; i < num_clients; ++i)
+  // From the CF's cumulative compaction stats, which only tenants with blob
+  // files pay for. Compaction reads blobs only to relocate them during
+  // garbage collection; user reads of blobs are charged to the tenant's
+  // read limiter like block reads. The stats take the DB mutex, so they are
+  // sampled every rocksdb.blob_stats_interval_ms into the usage snapshot
+  // rather than on each ReadResourceUsage().
+  void RocksdbDB::SampleBlobUsage()
+  {
+    const size_t n = std::min({usage_snapshot_->size(), cf_handles_.size(), blob_files_by_client_.size()});
+    std::map<std::string, std::string> cf_stats;
+    for (size_t i = 0; i < n; ++i)
     {
-      ycsbc::utils::MultiTenantResourceUsage client_stats;
-      client_stats.io_bytes_written_kb = write_rate_limiter->GetTotalBytesThroughForClient(i) / 1024;
-      client_stats.io_bytes_read_kb = read_rate_limiter->GetTotalBytesThroughForClient(i) / 1024;
-      all_stats.push_back(client_stats);
+      if (!blob_files_by_client_[i])
+      {
+        continue;
+      }
+      cf_stats.clear();
+      if (!db_->GetMapProperty(cf_handles_[i], rocksdb::DB::Properties::kCFStats, &cf_stats))
+      {
+        continue;
+      }
+      auto kb = [&cf_stats](const std::string &key) -> int64_t
+      {
+        auto it = cf_stats.find(key);
+        return it == cf_stats.end() ? 0 : static_cast<int64_t>(std::stod(it->second) * 1024 * 1024);
+      };
+      usage_snapshot_->PublishBlob(i, kb("compaction.Sum.RblobGB"), kb("compaction.Sum.WblobGB"));
     }
-    return all_stats;
   }
 
-  DB::Status RocksdbDB::DeleteSingle(const std::string &table, const std::string &key)
+  DB::Status RocksdbDB::DeleteSingle(const TenantHandle &tenant, const std::string &key)
   {
-    rocksdb::WriteOptions wopt;
-    rocksdb::Status s = db_->Delete(wopt, key);
-    if (!s.ok())
+    auto *handle = tenant.cf;
+    if (handle == nullptr)
     {
-      throw utils::Exception(std::string("RocksDB Delete: ") + s.ToString());
+      std::cout << "[FAIRDB_LOG] Bad table/handle: " << tenant.table << std::endl;
+      return kError;
     }
-    return kOK;
+    rocksdb::Status s = db_->Delete(WriteOptionsFor(tenant), handle, key);
+    return CheckWriteStatus(s, "Delete");
   }
 
   DB *NewRocksdbDB()
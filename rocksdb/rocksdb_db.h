@@ -10,8 +10,11 @@
 
 #include <string>
 #include <mutex>
+#include <unordered_map>
 
 #include "core/db.h"
+#include "core/tenant.h"
+#include "row_schema.h"
 #include "utils/properties.h"
 #include "utils/resources.h"
 
@@ -19,6 +22,8 @@
 #include <rocksdb/options.h>
 #include <rocksdb/statistics.h>
 #include <rocksdb/cache.h>
+#include <rocksdb/secondary_cache.h>
+#include <rocksdb/write_batch.h>
 
 namespace rocksdb {
   class DMutex;
@@ -38,6 +43,13 @@ class RocksdbDB : public DB {
     return block_caches_by_client_[client_idx];
   }
 
+  std::shared_ptr<rocksdb::SecondaryCache> GetSecondaryCacheByClientIdx (int client_idx) {
+    if (static_cast<size_t>(client_idx) >= secondary_caches_by_client_.size()) return nullptr;
+    return secondary_caches_by_client_[client_idx];
+  }
+
+  std::shared_ptr<rocksdb::Cache> GetRowCache() { return row_cache_; }
+
   void Init();
 
   void Cleanup();
@@ -45,62 +57,134 @@ class RocksdbDB : public DB {
   Status Read(const std::string &table, const std::string &key,
               const std::vector<std::string> *fields, std::vector<Field> &result,
               int client_id = 0) {
-    return (this->*(method_read_))(table, key, fields, result);
+    return Read(TenantFor(table), key, fields, result);
+  }
+  Status Read(const TenantHandle &tenant, const std::string &key,
+              const std::vector<std::string> *fields, std::vector<Field> &result) {
+    BindToTenantNode(tenant);
+    return (this->*(MethodsFor(tenant).read))(tenant, key, fields, result);
   }
 
   Status ReadBatch(const std::string &table, const std::vector<std::string> &keys,
                    const std::vector<std::vector<std::string>> *fields,
                    std::vector<std::vector<Field>> &result, int client_id = 0) {
-    return (this->*(method_read_batch_))(table, keys, fields, result);
+    return ReadBatch(TenantFor(table), keys, fields, result);
   }
+  Status ReadBatch(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                   const std::vector<std::vector<std::string>> *fields,
+                   std::vector<std::vector<Field>> &result) {
+    BindToTenantNode(tenant);
+    return (this->*(MethodsFor(tenant).read_batch))(tenant, keys, fields, result);
+  }
+
+  void MultiRead(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                 const std::vector<std::vector<std::string>> *fields,
+                 std::vector<std::vector<Field>> &result, std::vector<Status> &statuses);
+
+  void MultiWrite(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                  std::vector<std::vector<Field>> &values, const std::vector<bool> &is_update,
+                  std::vector<Status> &statuses);
 
   Status Scan(const std::string &table, const std::string &key, int len,
               const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result, int client_id = 0) {
-    return (this->*(method_scan_))(table, key, len, fields, result);
+    return Scan(TenantFor(table), key, len, fields, result);
+  }
+  Status Scan(const TenantHandle &tenant, const std::string &key, int len,
+              const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result) {
+    return ScanBounded(tenant, key, "", len, fields, result);
+  }
+  Status ScanBounded(const TenantHandle &tenant, const std::string &key, const std::string &upper_bound, int len,
+                     const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result) {
+    BindToTenantNode(tenant);
+    return (this->*(MethodsFor(tenant).scan))(tenant, key, upper_bound, len, fields, result);
   }
 
   Status Update(const std::string &table, const std::string &key, std::vector<Field> &values, int client_id = 0) {
-    return (this->*(method_update_))(table, key, values);
+    return Update(TenantFor(table), key, values);
+  }
+  Status Update(const TenantHandle &tenant, const std::string &key, std::vector<Field> &values) {
+    BindToTenantNode(tenant);
+    return (this->*(MethodsFor(tenant).update))(tenant, key, values);
   }
 
   Status Insert(const std::string &table, const std::string &key, std::vector<Field> &values, int client_id = 0) {
-    return (this->*(method_insert_))(table, key, values);
+    return Insert(TenantFor(table), key, values);
+  }
+  Status Insert(const TenantHandle &tenant, const std::string &key, std::vector<Field> &values) {
+    BindToTenantNode(tenant);
+    return (this->*(MethodsFor(tenant).insert))(tenant, key, values);
   }
 
   Status InsertBatch(const std::string &table, int start_key, std::vector<Field> &values, int num_keys, int client_id = 0) {
-    return (this->*(method_insert_batch_))(table, start_key, values, num_keys);
+    return InsertBatch(TenantFor(table), start_key, values, num_keys);
+  }
+  Status InsertBatch(const TenantHandle &tenant, int start_key, std::vector<Field> &values, int num_keys) {
+    BindToTenantNode(tenant);
+    return (this->*(MethodsFor(tenant).insert_batch))(tenant, start_key, values, num_keys);
   }
 
   Status Delete(const std::string &table, const std::string &key) {
-    return (this->*(method_delete_))(table, key);
+    const TenantHandle &tenant = TenantFor(table);
+    BindToTenantNode(tenant);
+    return (this->*(MethodsFor(tenant).del))(tenant, key);
   }
+
   Status ReadModifyInsertBatch(const std::string &table,
                              const std::vector<std::string> &keys,
                              const std::vector<std::vector<std::string>> *fields,
                              std::vector<std::vector<Field>> &result,
                              std::vector<Field> &new_values, int client_id = 0) {
-    return (this->*(method_read_modify_insert_batch_))(table, keys, fields, result, new_values);
+    return ReadModifyInsertBatch(TenantFor(table), keys, fields, result, new_values);
+  }
+  Status ReadModifyInsertBatch(const TenantHandle &tenant,
+                             const std::vector<std::string> &keys,
+                             const std::vector<std::vector<std::string>> *fields,
+                             std::vector<std::vector<Field>> &result,
+                             std::vector<Field> &new_values) {
+    BindToTenantNode(tenant);
+    return (this->*(MethodsFor(tenant).read_modify_insert_batch))(tenant, keys, fields, result, new_values);
   }
 
+  void ResolveTenant(const std::string &table, int client_id, TenantHandle &tenant);
+
   void UpdateRateLimit(int client_id, int64_t rate_limit_bytes);
   void UpdateMemtableSize(int client_id, int memtable_size_bytes);
   void UpdateResourceShares(std::vector<ycsbc::utils::MultiTenantResourceShares> res_opts);
+  void UpdateMemtableShares(const std::vector<ycsbc::utils::MemtableShare> &shares);
   std::vector<ycsbc::utils::MultiTenantResourceUsage> GetResourceUsage();
+  void ReadResourceUsage(std::vector<ycsbc::utils::MultiTenantResourceUsage> &usage);
   
   void PrintDbStats();
-  rocksdb::ColumnFamilyHandle* table2handle(const std::string& table);
+  std::vector<ycsbc::utils::TenantNumaStats> GetNumaStats();
+  bool GetWalStats(ycsbc::utils::WalStats &stats);
   int table2clientId(const std::string& table);
 
  private:
   enum RocksFormat {
-    kSingleRow,
+    kSingleRow,   // one entry per row, fields tagged with their names
+    kSchemaRow,   // one entry per row, fields located through schema_
+    kRowMajor,    // one entry per field under "<key>\0<field>"
+    kColumnMajor, // one entry per field under "<field>\0<key>"
   };
-  RocksFormat format_;
 
   void GetOptions(const int num_clients, const utils::Properties &props, rocksdb::Options *opt,
                   std::vector<rocksdb::ColumnFamilyDescriptor> *cf_descs);
   void GetCfOptions(const utils::Properties &props, 
                     std::vector<rocksdb::ColumnFamilyOptions>& cf_opt);
+  // Prefers the tenant's NUMA node for this worker's allocations (memtable
+  // arenas) and counts local vs remote operations. No-op unless
+  // rocksdb.numa_nodes is set.
+  void BindToTenantNode(const TenantHandle &tenant) {
+    if (!numa_node_by_client_.empty()) {
+      BindToTenantNodeSlow(tenant.client_id);
+    }
+  }
+  void BindToTenantNodeSlow(int client_id);
+
+  // Registry lookup for the table-name API; unknown tables get a handle
+  // with no CF, which the ops reject.
+  static const TenantHandle &TenantFor(const std::string &table);
+
   static void SerializeRow(const std::vector<Field> &values, std::string &data);
   static void DeserializeRowFilter(std::vector<Field> &values, const char *p, const char *lim,
                                    const std::vector<std::string> &fields);
@@ -108,55 +192,132 @@ class RocksdbDB : public DB {
                                    const std::vector<std::string> &fields);
   static void DeserializeRow(std::vector<Field> &values, const char *p, const char *lim);
   static void DeserializeRow(std::vector<Field> &values, const std::string &data);
+  // The tenant's rocksdb.wal / write_* settings; WAL off for unknown tables.
+  static const rocksdb::WriteOptions &WriteOptionsFor(const TenantHandle &tenant);
+
+  // rocksdb.mergeupdate for the tenant's CF.
+  static bool MergesUpdates(const TenantHandle &tenant);
+  // Publishes blob GC traffic of tenants with blob files to usage_snapshot_.
+  static void SampleBlobUsage();
 
-  Status ReadSingle(const std::string &table, const std::string &key,
+  // Overwrites the fields of `current_values` named in `values`.
+  static void UpdateRow(std::vector<Field> &current_values, const std::vector<Field> &values);
+
+  Status ReadSingle(const TenantHandle &tenant, const std::string &key,
                     const std::vector<std::string> *fields, std::vector<Field> &result);
-  Status ReadMany(const std::string &table, const std::vector<std::string> &keys,
+  Status ReadMany(const TenantHandle &tenant, const std::vector<std::string> &keys,
                    const std::vector<std::vector<std::string>> *fields,
                    std::vector<std::vector<Field>> &result);
-  Status ScanSingle(const std::string &table, const std::string &key, int len,
+  Status ScanSingle(const TenantHandle &tenant, const std::string &key, const std::string &upper_bound, int len,
                     const std::vector<std::string> *fields,
                     std::vector<std::vector<Field>> &result);
-  Status UpdateSingle(const std::string &table, const std::string &key,
+  Status UpdateSingle(const TenantHandle &tenant, const std::string &key,
                       std::vector<Field> &values);
-  Status MergeSingle(const std::string &table, const std::string &key,
+  Status MergeSingle(const TenantHandle &tenant, const std::string &key,
                      std::vector<Field> &values);
-  Status InsertSingle(const std::string &table, const std::string &key,
+  Status InsertSingle(const TenantHandle &tenant, const std::string &key,
                       std::vector<Field> &values);
-  Status DeleteSingle(const std::string &table, const std::string &key);
-  Status InsertMany(const std::string &table, int start_key,
+  Status DeleteSingle(const TenantHandle &tenant, const std::string &key);
+  Status InsertMany(const TenantHandle &tenant, int start_key,
                       std::vector<Field> &values, int num_keys);
-  Status ReadModifyInsertMany(const std::string &table,
+  Status ReadModifyInsertMany(const TenantHandle &tenant,
                              const std::vector<std::string> &keys,
                              const std::vector<std::vector<std::string>> *fields,
                              std::vector<std::vector<Field>> &result,
                              std::vector<Field> &new_values);
 
-  Status (RocksdbDB::*method_read_)(const std::string &, const std:: string &,
-                                    const std::vector<std::string> *, std::vector<Field> &);
-  Status (RocksdbDB::*method_read_batch_)(const std::string &, const std::vector<std::string> &,
+  static std::string BuildCompKey(RocksFormat format, const std::string &key, const std::string &field_name);
+  static void SplitCompKey(RocksFormat format, const rocksdb::Slice &comp_key, std::string &key,
+                           std::string &field_name);
+  static void AppendCompKeyPuts(RocksFormat format, rocksdb::ColumnFamilyHandle *handle, const std::string &key,
+                                const std::vector<Field> &values, rocksdb::WriteBatch &batch);
+  Status GetCompKeyFields(const TenantHandle &tenant, const std::string &key,
+                          const std::vector<std::string> &field_names, std::vector<Field> &result);
+  Status ScanCompKeyRM(const TenantHandle &tenant, const std::string &key, const std::string &upper_bound, int len,
+                       const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result);
+  Status ScanCompKeyCM(const TenantHandle &tenant, const std::string &key, const std::string &upper_bound, int len,
+                       const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result);
+
+  Status ReadCompKey(const TenantHandle &tenant, const std::string &key,
+                     const std::vector<std::string> *fields, std::vector<Field> &result);
+  Status ReadManyCompKey(const TenantHandle &tenant, const std::vector<std::string> &keys,
+                         const std::vector<std::vector<std::string>> *fields,
+                         std::vector<std::vector<Field>> &result);
+  Status ScanCompKey(const TenantHandle &tenant, const std::string &key, const std::string &upper_bound, int len,
+                     const std::vector<std::string> *fields,
+                     std::vector<std::vector<Field>> &result);
+  Status InsertCompKey(const TenantHandle &tenant, const std::string &key,
+                       std::vector<Field> &values);
+  Status DeleteCompKey(const TenantHandle &tenant, const std::string &key);
+  Status InsertManyCompKey(const TenantHandle &tenant, int start_key,
+                           std::vector<Field> &values, int num_keys);
+  Status ReadModifyInsertManyCompKey(const TenantHandle &tenant,
+                                     const std::vector<std::string> &keys,
+                                     const std::vector<std::vector<std::string>> *fields,
+                                     std::vector<std::vector<Field>> &result,
+                                     std::vector<Field> &new_values);
+
+  // One implementation of each operation per layout; every CF picks its
+  // layout with rocksdb.format.
+  struct FormatMethods {
+    Status (RocksdbDB::*read)(const TenantHandle &, const std::string &,
+                              const std::vector<std::string> *, std::vector<Field> &);
+    Status (RocksdbDB::*read_batch)(const TenantHandle &, const std::vector<std::string> &,
                                     const std::vector<std::vector<std::string>> *, std::vector<std::vector<Field>> &);
-  Status (RocksdbDB::*method_scan_)(const std::string &, const std::string &,
-                                    int, const std::vector<std::string> *,
-                                    std::vector<std::vector<Field>> &);
-  Status (RocksdbDB::*method_update_)(const std::string &, const std::string &,
-                                      std::vector<Field> &);
-  Status (RocksdbDB::*method_insert_)(const std::string &, const std::string &,
-                                      std::vector<Field> &);
-  Status (RocksdbDB::*method_insert_batch_)(const std::string &, int,
+    Status (RocksdbDB::*scan)(const TenantHandle &, const std::string &, const std::string &,
+                              int, const std::vector<std::string> *,
+                              std::vector<std::vector<Field>> &);
+    Status (RocksdbDB::*update)(const TenantHandle &, const std::string &,
+                                std::vector<Field> &);
+    Status (RocksdbDB::*insert)(const TenantHandle &, const std::string &,
+                                std::vector<Field> &);
+    Status (RocksdbDB::*insert_batch)(const TenantHandle &, int,
                                       std::vector<Field> &, int);
-  Status (RocksdbDB::*method_delete_)(const std::string &, const std::string &);
-  Status (RocksdbDB::*method_read_modify_insert_batch_)(const std::string &, const std::vector<std::string> &,
-                                      const std::vector<std::vector<std::string>> *, std::vector<std::vector<Field>> &,
-                                      std::vector<Field> &);
+    Status (RocksdbDB::*del)(const TenantHandle &, const std::string &);
+    Status (RocksdbDB::*read_modify_insert_batch)(const TenantHandle &, const std::vector<std::string> &,
+                                                  const std::vector<std::vector<std::string>> *,
+                                                  std::vector<std::vector<Field>> &, std::vector<Field> &);
+  };
+  static const FormatMethods kWholeRowMethods; // single, schema
+  static const FormatMethods kCompKeyMethods;  // row, column
+
+  static bool IsCompKey(RocksFormat format) { return format == kRowMajor || format == kColumnMajor; }
+  // The tenant CF's rocksdb.format; single for unknown tables.
+  static RocksFormat FormatOf(const TenantHandle &tenant) {
+    if (tenant.cf_index < 0 || static_cast<size_t>(tenant.cf_index) >= format_by_client_.size()) {
+      return kSingleRow;
+    }
+    return format_by_client_[tenant.cf_index];
+  }
+  static const FormatMethods &MethodsFor(const TenantHandle &tenant) {
+    return IsCompKey(FormatOf(tenant)) ? kCompKeyMethods : kWholeRowMethods;
+  }
 
   int fieldcount_;
 
   static std::vector<rocksdb::ColumnFamilyHandle *> cf_handles_;
+  static std::unordered_map<std::string, TenantHandle> tenants_;
   static rocksdb::DB *db_;
   static int ref_cnt_;
   static std::mutex mu_;
+  static std::vector<int> numa_node_by_client_;
+  static std::unique_ptr<utils::MultiTenantCounter> numa_local_ops_;
+  static std::unique_ptr<utils::MultiTenantCounter> numa_remote_ops_;
+  // Cached at Init so the scheduler never copies Options to reach them.
+  static rocksdb::RateLimiter *write_rate_limiter_;
+  static rocksdb::RateLimiter *read_rate_limiter_;
+  static std::unique_ptr<utils::ResourceUsageSnapshot> usage_snapshot_;
+  static std::shared_ptr<rocksdb::Cache> row_cache_;
+  static std::vector<rocksdb::WriteOptions> write_options_; // by client id
+  static std::vector<bool> blob_files_by_client_;          // lsm enable_blob_files
+  static std::vector<bool> merge_update_;                  // by client id
+  static std::shared_ptr<const RowSchema> schema_;         // rocksdb.format=schema, else null
+  static std::vector<RocksFormat> format_by_client_;
+  static std::vector<std::string> field_names_;            // fieldnameprefix0 .. fieldcount - 1
+  static bool wal_enabled_;
+  static std::shared_ptr<rocksdb::Statistics> statistics_;
   std::vector<std::shared_ptr<rocksdb::Cache>> block_caches_by_client_;
+  std::vector<std::shared_ptr<rocksdb::SecondaryCache>> secondary_caches_by_client_;
 };
 
 DB *NewRocksdbDB();
@@ -0,0 +1,138 @@
+//
+//  row_schema.h
+//  YCSB-cpp
+//
+//  Row layout for rocksdb.format=schema: field names are kept once, here,
+//  instead of in every row, and fields are found by offset.
+//
+
+#ifndef YCSB_C_ROCKSDB_ROW_SCHEMA_H_
+#define YCSB_C_ROCKSDB_ROW_SCHEMA_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <rocksdb/slice.h>
+
+#include "core/db.h"
+#include "utils/utils.h"
+
+namespace ycsbc {
+
+///
+/// The workload's field names (prefix0 .. prefix<field_count - 1>) and the
+/// row codec that uses them. A row is
+///
+///   [u8 width][field_count x end offset, `width` bytes each][values]
+///
+/// where end offsets count from the first value byte and width is 2 when
+/// the values fit in 64 KiB, else 4. Field i spans [end[i - 1], end[i]), so
+/// projecting a field reads two offsets and copies only its own bytes.
+/// Fields a row is written without are stored empty.
+///
+class RowSchema {
+ public:
+  RowSchema(const std::string &prefix, int field_count) {
+    for (int i = 0; i < field_count; ++i) {
+      names_.push_back(prefix + std::to_string(i));
+      index_[names_.back()] = i;
+    }
+  }
+
+  size_t field_count() const { return names_.size(); }
+  const std::string &Name(size_t i) const { return names_[i]; }
+
+  // -1 if the name is not in the schema.
+  int IndexOf(const std::string &name) const {
+    auto it = index_.find(name);
+    return it == index_.end() ? -1 : it->second;
+  }
+
+  void Encode(const std::vector<DB::Field> &values, std::string &row) const {
+    std::vector<rocksdb::Slice> by_index(names_.size());
+    for (const DB::Field &field : values) {
+      int i = IndexOf(field.name);
+      if (i < 0) {
+        throw utils::Exception("Field not in row schema: " + field.name);
+      }
+      by_index[i] = rocksdb::Slice(field.value);
+    }
+    Encode(by_index, row);
+  }
+
+  void Encode(const std::vector<rocksdb::Slice> &by_index, std::string &row) const {
+    size_t total = 0;
+    for (const rocksdb::Slice &value : by_index) {
+      total += value.size();
+    }
+    const uint8_t width = total <= UINT16_MAX ? 2 : 4;
+    row.push_back(static_cast<char>(width));
+    uint32_t end = 0;
+    for (const rocksdb::Slice &value : by_index) {
+      end += value.size();
+      if (width == 2) {
+        uint16_t end16 = end;
+        row.append(reinterpret_cast<const char *>(&end16), sizeof(end16));
+      } else {
+        row.append(reinterpret_cast<const char *>(&end), sizeof(end));
+      }
+    }
+    for (const rocksdb::Slice &value : by_index) {
+      row.append(value.data(), value.size());
+    }
+  }
+
+  // Value of field i; false if the row is malformed.
+  bool Field(const rocksdb::Slice &row, size_t i, rocksdb::Slice &value) const {
+    const size_t n = names_.size();
+    if (row.size() < 1) {
+      return false;
+    }
+    const size_t width = static_cast<uint8_t>(row[0]);
+    const size_t header = 1 + n * width;
+    if ((width != 2 && width != 4) || row.size() < header || i >= n) {
+      return false;
+    }
+    const char *offsets = row.data() + 1;
+    uint32_t begin = i == 0 ? 0 : Offset(offsets, width, i - 1);
+    uint32_t end = Offset(offsets, width, i);
+    if (begin > end || header + end > row.size()) {
+      return false;
+    }
+    value = rocksdb::Slice(row.data() + header + begin, end - begin);
+    return true;
+  }
+
+  // Every field, indexed like the schema; false if the row is malformed.
+  bool Decode(const rocksdb::Slice &row, std::vector<rocksdb::Slice> &by_index) const {
+    by_index.resize(names_.size());
+    for (size_t i = 0; i < names_.size(); ++i) {
+      if (!Field(row, i, by_index[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  static uint32_t Offset(const char *offsets, size_t width, size_t i) {
+    if (width == 2) {
+      uint16_t v;
+      std::memcpy(&v, offsets + i * width, sizeof(v));
+      return v;
+    }
+    uint32_t v;
+    std::memcpy(&v, offsets + i * width, sizeof(v));
+    return v;
+  }
+
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, int> index_;
+};
+
+} // ycsbc
+
+#endif // YCSB_C_ROCKSDB_ROW_SCHEMA_H_
@@ -0,0 +1,122 @@
+//
+//  row_schema_test.cc
+//  YCSB-cpp
+//
+//  RowSchema encoding, offset width selection and malformed rows.
+//
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "row_schema.h"
+#include "utils/test_util.h"
+
+namespace
+{
+  using ycsbc::DB;
+  using ycsbc::RowSchema;
+  using Fields = std::vector<DB::Field>;
+
+  std::vector<std::string> DecodeAll(const RowSchema &schema, const std::string &row)
+  {
+    std::vector<rocksdb::Slice> by_index;
+    TEST_CHECK(schema.Decode(row, by_index));
+    std::vector<std::string> values;
+    for (const rocksdb::Slice &value : by_index)
+    {
+      values.push_back(value.ToString());
+    }
+    return values;
+  }
+
+  void TestRoundTrip()
+  {
+    RowSchema schema("field", 3);
+    TEST_CHECK(schema.field_count() == 3);
+    TEST_CHECK(schema.Name(2) == "field2");
+    TEST_CHECK(schema.IndexOf("field1") == 1);
+    TEST_CHECK(schema.IndexOf("field3") == -1);
+
+    // Fields may come in any order; missing ones are stored empty.
+    std::string row;
+    schema.Encode(Fields{{"field2", "ccc"}, {"field0", "a"}}, row);
+    TEST_CHECK((DecodeAll(schema, row) == std::vector<std::string>{"a", "", "ccc"}));
+
+    rocksdb::Slice value;
+    TEST_CHECK(schema.Field(row, 2, value) && value.ToString() == "ccc");
+    TEST_CHECK(schema.Field(row, 1, value) && value.empty());
+    TEST_CHECK(!schema.Field(row, 3, value));
+  }
+
+  void TestUnknownFieldThrows()
+  {
+    RowSchema schema("field", 2);
+    std::string row;
+    TEST_CHECK_THROWS(schema.Encode(Fields{{"other", "x"}}, row), ycsbc::utils::Exception);
+  }
+
+  void TestOffsetWidth()
+  {
+    RowSchema schema("field", 2);
+    // 65535 value bytes still fit 16-bit offsets; one more needs 32-bit.
+    for (size_t total : {size_t(0), size_t(100), size_t(UINT16_MAX), size_t(UINT16_MAX) + 1, size_t(200000)})
+    {
+      std::string first(total / 2, 'a');
+      std::string second(total - total / 2, 'b');
+      std::string row;
+      schema.Encode(Fields{{"field0", first}, {"field1", second}}, row);
+
+      const size_t width = total <= UINT16_MAX ? 2 : 4;
+      TEST_CHECK(static_cast<uint8_t>(row[0]) == width);
+      TEST_CHECK(row.size() == 1 + 2 * width + total);
+      TEST_CHECK((DecodeAll(schema, row) == std::vector<std::string>{first, second}));
+    }
+  }
+
+  void TestMalformedRows()
+  {
+    RowSchema schema("field", 2);
+    std::string row;
+    schema.Encode(Fields{{"field0", "abc"}, {"field1", "de"}}, row);
+    std::vector<rocksdb::Slice> by_index;
+    rocksdb::Slice value;
+
+    TEST_CHECK(!schema.Decode(rocksdb::Slice(), by_index));
+
+    // Width byte other than 2 or 4.
+    std::string bad_width = row;
+    bad_width[0] = 3;
+    TEST_CHECK(!schema.Decode(bad_width, by_index));
+
+    // Header cut short.
+    TEST_CHECK(!schema.Decode(rocksdb::Slice(row.data(), 4), by_index));
+
+    // Values cut short: the first field is intact, the second is not.
+    std::string short_values = row.substr(0, row.size() - 1);
+    TEST_CHECK(schema.Field(short_values, 0, value) && value.ToString() == "abc");
+    TEST_CHECK(!schema.Field(short_values, 1, value));
+    TEST_CHECK(!schema.Decode(short_values, by_index));
+
+    // Offsets that go backwards.
+    std::string backwards = row;
+    uint16_t end0 = 4;
+    uint16_t end1 = 2;
+    std::memcpy(&backwards[1], &end0, sizeof(end0));
+    std::memcpy(&backwards[3], &end1, sizeof(end1));
+    TEST_CHECK(!schema.Field(backwards, 1, value));
+    TEST_CHECK(!schema.Decode(backwards, by_index));
+  }
+}
+
+int main()
+{
+  TestRoundTrip();
+  TestUnknownFieldThrows();
+  TestOffsetWidth();
+  TestMalformedRows();
+  std::cout << "row_schema_test: OK" << std::endl;
+  return 0;
+}
@@ -0,0 +1,276 @@
+//
+//  tenant_cache.h
+//  YCSB-cpp
+//
+//  Per-tenant views of caches shared by every column family: the block
+//  cache in shared_quota mode and the DB-wide row cache, plus hit counting
+//  for per-tenant secondary caches.
+//
+
+#ifndef YCSB_C_ROCKSDB_TENANT_CACHE_H_
+#define YCSB_C_ROCKSDB_TENANT_CACHE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include <rocksdb/advanced_cache.h>
+#include <rocksdb/cache.h>
+#include <rocksdb/secondary_cache.h>
+#include <rocksdb/tg_thread_local.h>
+
+namespace ycsbc {
+
+///
+/// Wraps the shared cache for one tenant and charges every entry the tenant
+/// inserts to it. Below its soft quota a tenant inserts at the priority
+/// RocksDB asked for; above it, at BOTTOM so its blocks are evicted before
+/// the LOW-priority data blocks of tenants within quota (the shared LRU
+/// cache is built with a low-priority pool for this);
+/// at the hard quota (soft * hard_ratio, 0 = none) inserts are refused and
+/// the block is read without being cached. Idle tenants' quota is thus
+/// usable by everyone until they come back.
+///
+/// Entries are boxed so the deleter can find the tenant to credit; Value(),
+/// GetCacheItemHelper() and ApplyToAllEntries() unbox them. The boxed
+/// helpers are not secondary-cache compatible.
+///
+/// GetUsage()/GetCapacity()/SetCapacity() refer to this tenant's charge and
+/// soft quota, so existing per-tenant cache code (status thread, resource
+/// scheduler, cache controller) works unchanged.
+///
+class TenantQuotaCache : public rocksdb::CacheWrapper {
+ public:
+  TenantQuotaCache(std::shared_ptr<rocksdb::Cache> shared, size_t soft_quota, double hard_ratio)
+      : rocksdb::CacheWrapper(std::move(shared)), charge_(std::make_shared<std::atomic<int64_t>>(0)),
+        hard_ratio_(hard_ratio) {
+    SetCapacity(soft_quota);
+  }
+
+  static const char *kClassName() { return "TenantQuotaCache"; }
+  const char *Name() const override { return kClassName(); }
+
+  rocksdb::Status Insert(const rocksdb::Slice &key, ObjectPtr obj, const CacheItemHelper *helper, size_t charge,
+                         Handle **handle = nullptr, Priority priority = Priority::LOW,
+                         const rocksdb::Slice &compressed = rocksdb::Slice(),
+                         rocksdb::CompressionType type = rocksdb::kNoCompression) override {
+    int64_t usage = charge_->load(std::memory_order_relaxed);
+    size_t hard_quota = hard_quota_.load(std::memory_order_relaxed);
+    if (hard_quota > 0 && usage + static_cast<int64_t>(charge) > static_cast<int64_t>(hard_quota)) {
+      // The caller keeps ownership of obj and uses the block uncached.
+      rejected_inserts_.fetch_add(1, std::memory_order_relaxed);
+      return rocksdb::Status::MemoryLimit("tenant cache hard quota reached");
+    }
+    if (usage + static_cast<int64_t>(charge) > static_cast<int64_t>(soft_quota_.load(std::memory_order_relaxed))) {
+      priority = Priority::BOTTOM;
+    }
+
+    TenantEntry *entry = new TenantEntry{charge_, obj, helper, charge};
+    charge_->fetch_add(charge, std::memory_order_relaxed);
+    rocksdb::Status s = target_->Insert(key, entry, BoxedHelper(helper), charge, handle, priority, compressed, type);
+    if (!s.ok()) {
+      // Caller keeps ownership of obj on failure.
+      charge_->fetch_sub(charge, std::memory_order_relaxed);
+      delete entry;
+    }
+    return s;
+  }
+
+  Handle *Lookup(const rocksdb::Slice &key, const CacheItemHelper *helper = nullptr,
+                 CreateContext *create_context = nullptr, Priority priority = Priority::LOW,
+                 rocksdb::Statistics *stats = nullptr) override {
+    Handle *h = target_->Lookup(key, helper, create_context, priority, stats);
+    (h != nullptr ? hits_ : misses_).fetch_add(1, std::memory_order_relaxed);
+    return h;
+  }
+
+  ObjectPtr Value(Handle *h) override {
+    ObjectPtr value = target_->Value(h);
+    return IsBoxed(target_->GetCacheItemHelper(h)) ? static_cast<TenantEntry *>(value)->obj : value;
+  }
+
+  const CacheItemHelper *GetCacheItemHelper(Handle *h) const override {
+    const CacheItemHelper *helper = target_->GetCacheItemHelper(h);
+    return IsBoxed(helper) ? static_cast<TenantEntry *>(target_->Value(h))->helper : helper;
+  }
+
+  void ApplyToAllEntries(
+      const std::function<void(const rocksdb::Slice &key, ObjectPtr obj, size_t charge, const CacheItemHelper *helper)> &callback,
+      const rocksdb::ApplyToAllEntriesOptions &opts) override {
+    target_->ApplyToAllEntries(
+        [&callback](const rocksdb::Slice &key, ObjectPtr obj, size_t charge, const CacheItemHelper *helper) {
+          if (IsBoxed(helper)) {
+            TenantEntry *entry = static_cast<TenantEntry *>(obj);
+            callback(key, entry->obj, charge, entry->helper);
+          } else {
+            callback(key, obj, charge, helper);
+          }
+        },
+        opts);
+  }
+
+  void SetCapacity(size_t soft_quota) override {
+    soft_quota_.store(soft_quota, std::memory_order_relaxed);
+    hard_quota_.store(hard_ratio_ > 0 ? static_cast<size_t>(soft_quota * hard_ratio_) : 0, std::memory_order_relaxed);
+  }
+  size_t GetCapacity() const override { return soft_quota_.load(std::memory_order_relaxed); }
+  size_t GetUsage() const override { return std::max<int64_t>(0, charge_->load(std::memory_order_relaxed)); }
+  using rocksdb::CacheWrapper::GetUsage;
+
+  size_t SharedUsage() const { return target_->GetUsage(); }
+  size_t SharedCapacity() const { return target_->GetCapacity(); }
+  uint64_t GetAndResetTenantHits() { return hits_.exchange(0, std::memory_order_relaxed); }
+  uint64_t GetAndResetTenantMisses() { return misses_.exchange(0, std::memory_order_relaxed); }
+  uint64_t GetAndResetRejectedInserts() { return rejected_inserts_.exchange(0, std::memory_order_relaxed); }
+
+ private:
+  // The charge counter is shared with every boxed entry so entries evicted
+  // after this wrapper is gone still have somewhere to credit.
+  struct TenantEntry {
+    std::shared_ptr<std::atomic<int64_t>> charge;
+    ObjectPtr obj;
+    const CacheItemHelper *helper;
+    size_t size;
+  };
+
+  static void DeleteEntry(ObjectPtr value, rocksdb::MemoryAllocator *allocator) {
+    TenantEntry *entry = static_cast<TenantEntry *>(value);
+    entry->charge->fetch_sub(entry->size, std::memory_order_relaxed);
+    if (entry->helper != nullptr && entry->helper->del_cb != nullptr) {
+      entry->helper->del_cb(entry->obj, allocator);
+    }
+    delete entry;
+  }
+
+  // One boxed helper per entry role, so role-based cache stats still work.
+  static const CacheItemHelper *BoxedHelpers() {
+    static const CacheItemHelper *helpers = [] {
+      auto *h = static_cast<CacheItemHelper *>(::operator new(sizeof(CacheItemHelper) * rocksdb::kNumCacheEntryRoles));
+      for (uint32_t r = 0; r < rocksdb::kNumCacheEntryRoles; ++r) {
+        new (&h[r]) CacheItemHelper(static_cast<rocksdb::CacheEntryRole>(r), &DeleteEntry);
+      }
+      return h;
+    }();
+    return helpers;
+  }
+
+  static const CacheItemHelper *BoxedHelper(const CacheItemHelper *helper) {
+    uint32_t role = helper != nullptr ? static_cast<uint32_t>(helper->role)
+                                      : static_cast<uint32_t>(rocksdb::CacheEntryRole::kMisc);
+    return &BoxedHelpers()[role];
+  }
+
+  static bool IsBoxed(const CacheItemHelper *helper) {
+    const CacheItemHelper *begin = BoxedHelpers();
+    return helper >= begin && helper < begin + rocksdb::kNumCacheEntryRoles;
+  }
+
+  std::shared_ptr<std::atomic<int64_t>> charge_;
+  const double hard_ratio_;
+  std::atomic<size_t> soft_quota_{0};
+  std::atomic<size_t> hard_quota_{0};
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> rejected_inserts_{0};
+};
+
+///
+/// RocksDB has one row cache per DB, so tenants are told apart by the
+/// calling thread's FairDB client id: each tenant's lookups and inserts go
+/// through its own TenantQuotaCache view of the shared cache, which sizes
+/// and counts them. Threads without a valid client id use the shared cache
+/// directly, uncharged.
+///
+class TenantRowCache : public rocksdb::CacheWrapper {
+ public:
+  TenantRowCache(std::shared_ptr<rocksdb::Cache> shared, const std::vector<size_t> &quotas, double hard_ratio)
+      : rocksdb::CacheWrapper(shared) {
+    for (size_t quota : quotas) {
+      tenants_.push_back(std::make_shared<TenantQuotaCache>(shared, quota, hard_ratio));
+    }
+  }
+
+  static const char *kClassName() { return "TenantRowCache"; }
+  const char *Name() const override { return kClassName(); }
+
+  rocksdb::Status Insert(const rocksdb::Slice &key, ObjectPtr obj, const CacheItemHelper *helper, size_t charge,
+                         Handle **handle = nullptr, Priority priority = Priority::LOW,
+                         const rocksdb::Slice &compressed = rocksdb::Slice(),
+                         rocksdb::CompressionType type = rocksdb::kNoCompression) override {
+    return Route()->Insert(key, obj, helper, charge, handle, priority, compressed, type);
+  }
+
+  Handle *Lookup(const rocksdb::Slice &key, const CacheItemHelper *helper = nullptr,
+                 CreateContext *create_context = nullptr, Priority priority = Priority::LOW,
+                 rocksdb::Statistics *stats = nullptr) override {
+    return Route()->Lookup(key, helper, create_context, priority, stats);
+  }
+
+  // Any tenant view can unbox any tenant's entries.
+  ObjectPtr Value(Handle *h) override { return tenants_.empty() ? target_->Value(h) : tenants_[0]->Value(h); }
+
+  const CacheItemHelper *GetCacheItemHelper(Handle *h) const override {
+    return tenants_.empty() ? target_->GetCacheItemHelper(h) : tenants_[0]->GetCacheItemHelper(h);
+  }
+
+  void ApplyToAllEntries(
+      const std::function<void(const rocksdb::Slice &key, ObjectPtr obj, size_t charge, const CacheItemHelper *helper)> &callback,
+      const rocksdb::ApplyToAllEntriesOptions &opts) override {
+    if (tenants_.empty()) {
+      target_->ApplyToAllEntries(callback, opts);
+    } else {
+      tenants_[0]->ApplyToAllEntries(callback, opts);
+    }
+  }
+
+  size_t NumTenants() const { return tenants_.size(); }
+  TenantQuotaCache *Tenant(size_t client_id) { return tenants_[client_id].get(); }
+
+ private:
+  rocksdb::Cache *Route() {
+    int client_id = TG_GetThreadMetadata().client_id;
+    if (client_id < 0 || static_cast<size_t>(client_id) >= tenants_.size()) {
+      return target_.get();
+    }
+    return tenants_[client_id].get();
+  }
+
+  std::vector<std::shared_ptr<TenantQuotaCache>> tenants_;
+};
+
+///
+/// Counts lookups that reach a tenant's secondary cache, i.e. primary
+/// misses, and how many of them it served.
+///
+class TenantSecondaryCache : public rocksdb::SecondaryCacheWrapper {
+ public:
+  explicit TenantSecondaryCache(std::shared_ptr<rocksdb::SecondaryCache> target)
+      : rocksdb::SecondaryCacheWrapper(std::move(target)) {}
+
+  static const char *kClassName() { return "TenantSecondaryCache"; }
+  const char *Name() const override { return kClassName(); }
+
+  std::unique_ptr<rocksdb::SecondaryCacheResultHandle> Lookup(
+      const rocksdb::Slice &key, const rocksdb::Cache::CacheItemHelper *helper,
+      rocksdb::Cache::CreateContext *create_context, bool wait, bool advise_erase, rocksdb::Statistics *stats,
+      bool &kept_in_sec_cache) override {
+    auto handle = target_->Lookup(key, helper, create_context, wait, advise_erase, stats, kept_in_sec_cache);
+    (handle != nullptr ? hits_ : misses_).fetch_add(1, std::memory_order_relaxed);
+    return handle;
+  }
+
+  uint64_t GetAndResetHits() { return hits_.exchange(0, std::memory_order_relaxed); }
+  uint64_t GetAndResetMisses() { return misses_.exchange(0, std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+};
+
+} // ycsbc
+
+#endif // YCSB_C_ROCKSDB_TENANT_CACHE_H_
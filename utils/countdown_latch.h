@@ -30,6 +30,10 @@ class CountDownLatch {
     std::unique_lock<std::mutex> lock(mu_);
     return cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this]{return count_ <= 0;});
   }
+  bool AwaitForUs(long timeout_us) {
+    std::unique_lock<std::mutex> lock(mu_);
+    return cv_.wait_for(lock, std::chrono::microseconds(timeout_us), [this]{return count_ <= 0;});
+  }
   void CountDown() {
     std::unique_lock<std::mutex> lock(mu_);
     if (--count_ <= 0) {
@@ -0,0 +1,310 @@
+//
+//  cpu_topology.h
+//  YCSB-cpp
+//
+//  Maps benchmark thread roles (clients, workers, status, ...) onto CPUs.
+//
+
+#ifndef YCSB_C_CPU_TOPOLOGY_H_
+#define YCSB_C_CPU_TOPOLOGY_H_
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.h"
+
+namespace ycsbc {
+
+namespace utils {
+
+///
+/// Parses a non-negative decimal id (cpu or NUMA node) that makes up all of
+/// `s`; returns -1 otherwise.
+///
+inline int ParseCpuId(const std::string &s) {
+  if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos) {
+    return -1;
+  }
+  try {
+    return std::stoi(s);
+  } catch (const std::out_of_range &) {
+    return -1;
+  }
+}
+
+///
+/// Parses a kernel-style cpu list such as "0-3,8,10-11".
+///
+inline std::vector<int> ParseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    range = Trim(range);
+    if (range.empty()) {
+      continue;
+    }
+    size_t dash = range.find('-');
+    if (dash == std::string::npos) {
+      int cpu = ParseCpuId(range);
+      if (cpu < 0) {
+        throw Exception("Invalid cpu list: " + list);
+      }
+      cpus.push_back(cpu);
+    } else {
+      int lo = ParseCpuId(Trim(range.substr(0, dash)));
+      int hi = ParseCpuId(Trim(range.substr(dash + 1)));
+      if (lo < 0 || hi < lo) {
+        throw Exception("Invalid cpu list: " + list);
+      }
+      for (int c = lo; c <= hi; c++) {
+        cpus.push_back(c);
+      }
+    }
+  }
+  return cpus;
+}
+
+///
+/// Online CPUs and NUMA nodes as reported by /sys/devices/system.
+///
+class CpuTopology {
+ public:
+  CpuTopology() {
+    std::string online;
+    if (ReadLine("/sys/devices/system/cpu/online", &online)) {
+      online_ = ParseCpuList(online);
+    } else {
+      for (unsigned c = 0; c < std::max(1u, std::thread::hardware_concurrency()); c++) {
+        online_.push_back(c);
+      }
+    }
+    std::set<int> online_set(online_.begin(), online_.end());
+    for (int node = 0;; node++) {
+      std::string cpulist;
+      if (!ReadLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", &cpulist)) {
+        break;
+      }
+      std::vector<int> cpus;
+      for (int c : ParseCpuList(cpulist)) {
+        if (online_set.count(c)) {
+          cpus.push_back(c);
+        }
+      }
+      nodes_.push_back(cpus);
+    }
+    if (nodes_.empty()) {
+      nodes_.push_back(online_);
+    }
+  }
+
+  const std::vector<int> &OnlineCpus() const { return online_; }
+  int NumNodes() const { return nodes_.size(); }
+  const std::vector<int> &NodeCpus(int node) const { return nodes_.at(node); }
+
+  bool IsOnline(int cpu) const {
+    return std::find(online_.begin(), online_.end(), cpu) != online_.end();
+  }
+
+  int NodeOf(int cpu) const {
+    for (size_t n = 0; n < nodes_.size(); n++) {
+      if (std::find(nodes_[n].begin(), nodes_[n].end(), cpu) != nodes_[n].end()) {
+        return n;
+      }
+    }
+    return -1;
+  }
+
+ private:
+  static bool ReadLine(const std::string &path, std::string *line) {
+    std::ifstream in(path);
+    return in.is_open() && std::getline(in, *line) && !Trim(*line).empty();
+  }
+
+  std::vector<int> online_;
+  std::vector<std::vector<int>> nodes_;
+};
+
+///
+/// Role -> cpu assignment parsed from the "cpu.layout" property, e.g.
+///   clients:0-15;workers:16-31@numa0;status:auto;rocksdb_bg:32-39
+/// A role may be restricted to one NUMA node with "@numaN". "auto" claims
+/// CPUs not named by any explicit role (one CPU for status and rsched, all
+/// remaining ones otherwise). Roles that are not listed fall back to the
+/// legacy hardcoded core chosen by the caller.
+///
+class CpuLayout {
+ public:
+  CpuLayout() = default;
+
+  CpuLayout(const std::string &spec, const CpuTopology &topology) : topology_(topology) {
+    std::vector<std::pair<std::string, int>> auto_roles;
+    std::set<int> claimed;
+    std::stringstream ss(spec);
+    std::string entry;
+    while (std::getline(ss, entry, ';')) {
+      entry = Trim(entry);
+      if (entry.empty()) {
+        continue;
+      }
+      size_t colon = entry.find(':');
+      if (colon == std::string::npos) {
+        throw Exception("Invalid cpu.layout entry: " + entry);
+      }
+      std::string role = Trim(entry.substr(0, colon));
+      std::string cpus = Trim(entry.substr(colon + 1));
+      int node = -1;
+      size_t at = cpus.find("@numa");
+      if (at != std::string::npos) {
+        node = ParseCpuId(Trim(cpus.substr(at + 5)));
+        if (node < 0) {
+          throw Exception("Invalid NUMA node in cpu.layout entry: " + entry);
+        }
+        if (node >= topology_.NumNodes()) {
+          throw Exception("cpu.layout role " + role + " names missing NUMA node " + std::to_string(node));
+        }
+        cpus = Trim(cpus.substr(0, at));
+      }
+      if (cpus == "auto") {
+        auto_roles.push_back({role, node});
+        continue;
+      }
+      std::vector<int> assigned;
+      for (int c : ParseCpuList(cpus)) {
+        if (!topology_.IsOnline(c)) {
+          throw Exception("cpu.layout role " + role + " uses offline cpu " + std::to_string(c));
+        }
+        if (node >= 0 && topology_.NodeOf(c) != node) {
+          continue;
+        }
+        assigned.push_back(c);
+        claimed.insert(c);
+      }
+      if (assigned.empty()) {
+        throw Exception("cpu.layout role " + role + " has no usable cpus");
+      }
+      roles_[role] = assigned;
+    }
+
+    for (auto &[role, node] : auto_roles) {
+      const std::vector<int> &pool = node >= 0 ? topology_.NodeCpus(node) : topology_.OnlineCpus();
+      bool single = role == "status" || role == "rsched";
+      std::vector<int> assigned;
+      for (int c : pool) {
+        if (claimed.count(c)) {
+          continue;
+        }
+        assigned.push_back(c);
+        claimed.insert(c);
+        if (single) {
+          break;
+        }
+      }
+      if (assigned.empty()) {
+        throw Exception("cpu.layout has no unclaimed cpus left for role " + role);
+      }
+      roles_[role] = assigned;
+    }
+
+    for (auto &[role, cpus] : roles_) {
+      std::cout << "[FAIRDB_LOG] cpu.layout " << role << " ->";
+      for (int c : cpus) {
+        std::cout << " " << c;
+      }
+      std::cout << std::endl;
+    }
+  }
+
+  bool HasRole(const std::string &role) const { return roles_.count(role) > 0; }
+
+  const std::vector<int> &RoleCpus(const std::string &role) const {
+    static const std::vector<int> kEmpty;
+    auto it = roles_.find(role);
+    return it == roles_.end() ? kEmpty : it->second;
+  }
+
+  ///
+  /// Cpu for the index-th thread of a role, wrapping around when the role
+  /// has fewer cpus than threads. Returns legacy_cpu if the role is not in
+  /// the layout, or -1 if that cpu is not online (caller leaves the thread
+  /// unpinned).
+  ///
+  int CpuFor(const std::string &role, int index, int legacy_cpu) const {
+    auto it = roles_.find(role);
+    if (it != roles_.end()) {
+      return it->second[index % it->second.size()];
+    }
+    if (legacy_cpu >= 0 && !topology_.IsOnline(legacy_cpu)) {
+      std::cerr << "[FAIRDB_LOG] Core " << legacy_cpu << " for " << role
+                << " is not online, leaving thread unpinned" << std::endl;
+      return -1;
+    }
+    return legacy_cpu;
+  }
+
+  ///
+  /// Pins the calling thread as the index-th thread of role. Exits on
+  /// failure, like the hardcoded pinning this replaces.
+  ///
+  void PinCurrentThread(const std::string &role, int index, int legacy_cpu,
+                        const std::string &thread_name) const {
+    int cpu = CpuFor(role, index, legacy_cpu);
+    if (cpu < 0) {
+      return;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    std::cout << "[FAIRDB_LOG] Pinning " << thread_name << " to core " << cpu << std::endl;
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if (rc != 0) {
+      fprintf(stderr, "Couldn't set thread affinity.\n");
+      std::exit(1);
+    }
+  }
+
+  ///
+  /// Restricts the calling thread to every cpu of role. Used for pools such
+  /// as RocksDB background threads that are not pinned one per core.
+  /// Returns false if the role is not in the layout.
+  ///
+  bool RestrictCurrentThread(const std::string &role) const {
+    auto it = roles_.find(role);
+    if (it == roles_.end()) {
+      return false;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (int c : it->second) {
+      CPU_SET(c, &cpuset);
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if (rc != 0) {
+      fprintf(stderr, "Couldn't set thread affinity.\n");
+      std::exit(1);
+    }
+    return true;
+  }
+
+ private:
+  CpuTopology topology_;
+  std::map<std::string, std::vector<int>> roles_;
+};
+
+} // utils
+
+} // ycsbc
+
+#endif // YCSB_C_CPU_TOPOLOGY_H_
@@ -0,0 +1,71 @@
+//
+//  cpu_topology_test.cc
+//  YCSB-cpp
+//
+//  Parsing of cpu lists and cpu.layout entries.
+//
+
+#include <string>
+#include <vector>
+
+#include "utils/cpu_topology.h"
+#include "utils/test_util.h"
+
+using ycsbc::utils::CpuLayout;
+using ycsbc::utils::CpuTopology;
+using ycsbc::utils::Exception;
+using ycsbc::utils::ParseCpuId;
+using ycsbc::utils::ParseCpuList;
+
+static void TestParseCpuId() {
+  TEST_CHECK(ParseCpuId("0") == 0);
+  TEST_CHECK(ParseCpuId("17") == 17);
+  TEST_CHECK(ParseCpuId("") == -1);
+  TEST_CHECK(ParseCpuId("-1") == -1);
+  TEST_CHECK(ParseCpuId("3x") == -1);
+  TEST_CHECK(ParseCpuId("x") == -1);
+  TEST_CHECK(ParseCpuId("99999999999999999999") == -1);
+}
+
+static void TestParseCpuList() {
+  TEST_CHECK((ParseCpuList("0-3,8,10-11") == std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  TEST_CHECK((ParseCpuList(" 4 , 6 - 7 ") == std::vector<int>{4, 6, 7}));
+  TEST_CHECK((ParseCpuList("5-5") == std::vector<int>{5}));
+  TEST_CHECK(ParseCpuList("").empty());
+  TEST_CHECK(ParseCpuList(",,").empty());
+}
+
+static void TestParseCpuListErrors() {
+  TEST_CHECK_THROWS(ParseCpuList("a"), Exception);
+  TEST_CHECK_THROWS(ParseCpuList("1,2x"), Exception);
+  TEST_CHECK_THROWS(ParseCpuList("5-2"), Exception);
+  TEST_CHECK_THROWS(ParseCpuList("1-"), Exception);
+  TEST_CHECK_THROWS(ParseCpuList("-3"), Exception);
+  TEST_CHECK_THROWS(ParseCpuList("0-x"), Exception);
+}
+
+static void TestLayoutErrors() {
+  CpuTopology topology;
+  std::string cpu = std::to_string(topology.OnlineCpus().front());
+
+  CpuLayout layout("clients:" + cpu, topology);
+  TEST_CHECK(layout.HasRole("clients"));
+  TEST_CHECK(layout.CpuFor("clients", 3, -1) == topology.OnlineCpus().front());
+
+  TEST_CHECK_THROWS(CpuLayout("clients", topology), Exception);
+  TEST_CHECK_THROWS(CpuLayout("clients:" + cpu + "@numax", topology), Exception);
+  TEST_CHECK_THROWS(CpuLayout("clients:" + cpu + "@numa", topology), Exception);
+  TEST_CHECK_THROWS(CpuLayout("clients:" + cpu + "@numa-1", topology), Exception);
+  TEST_CHECK_THROWS(CpuLayout("clients:" + cpu + "@numa" + std::to_string(topology.NumNodes()), topology),
+                    Exception);
+  TEST_CHECK_THROWS(CpuLayout("clients:1-0", topology), Exception);
+}
+
+int main() {
+  TestParseCpuId();
+  TestParseCpuList();
+  TestParseCpuListErrors();
+  TestLayoutErrors();
+  std::cout << "cpu_topology_test: OK" << std::endl;
+  return 0;
+}
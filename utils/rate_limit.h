@@ -25,10 +25,19 @@ class RateLimiter {
   RateLimiter(int64_t r, int64_t b) : r_(r * TOKEN_PRECISION), b_(b * TOKEN_PRECISION), tokens_(0), last_(Clock::now()) {}
 
   inline void Consume(int64_t n) {
-    std::unique_lock<std::mutex> lock(mutex_);
+    int64_t wait_time = Reserve(n);
+    if (wait_time > 0) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(wait_time));
+    }
+  }
+
+  // Takes n tokens without sleeping and returns how many nanoseconds the
+  // caller must wait before using them (0 if they were available).
+  inline int64_t Reserve(int64_t n) {
+    std::lock_guard<std::mutex> lock(mutex_);
 
     if (r_ <= 0) {
-      return;
+      return 0;
     }
 
     // refill tokens
@@ -39,13 +48,7 @@ class RateLimiter {
 
     // check tokens
     tokens_ -= n * TOKEN_PRECISION;
-
-    // sleep
-    if (tokens_ < 0) {
-      lock.unlock();
-      int64_t wait_time = -tokens_ * 1000000000 / r_;
-      std::this_thread::sleep_for(std::chrono::nanoseconds(wait_time));
-    }
+    return tokens_ < 0 ? -tokens_ * 1000000000 / r_ : 0;
   }
 
   inline void SetRate(int64_t r) {
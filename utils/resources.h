@@ -1,9 +1,12 @@
 #ifndef YCSB_C_RESOURCES_H_
 #define YCSB_C_RESOURCES_H_
 
+#include <algorithm>
 #include <atomic>
+#include <thread>
 #include <sstream>
 #include <cstdint>
+#include <vector>
 
 namespace ycsbc::utils {
 
@@ -23,6 +26,10 @@ class MultiTenantCounter {
       return counts[index].load(std::memory_order_relaxed);
     }
 
+    int64_t get_and_reset(size_t index) {
+      return counts[index].exchange(0, std::memory_order_relaxed);
+    }
+
   private:
     std::vector<std::atomic<int64_t>> counts;
 };
@@ -30,15 +37,20 @@ class MultiTenantCounter {
 struct MultiTenantResourceShares {
   uint32_t write_rate_limit_kbs;
   uint32_t read_rate_limit_kbs;
-  uint16_t write_buffer_size_kb;
+  uint32_t write_buffer_size_kb;
   int max_write_buffer_number;
+  int64_t cpu_share_us = 0; // worker CPU microseconds per second
+  int64_t memtable_alloc_kbs = 0; // memtable write KB/s granted by the allocator
+  int64_t cache_alloc_kb = 0;    // DRF only; informational until enforced
+  double dominant_share = 0;     // DRF only
 
   std::string ToString() const {
     std::ostringstream oss;
     oss << "Resource Shares: " << (write_rate_limit_kbs/1024) << " MB/s / "
         << (read_rate_limit_kbs/1024) << " MB/s / "
         << (write_buffer_size_kb/1024) << " MB / "
-        << (max_write_buffer_number) << " (Write IO / Read IO / Memtable Size / Memtable Count)\n";
+        << (max_write_buffer_number) << " / "
+        << (cpu_share_us/1000) << " ms/s (Write IO / Read IO / Memtable Size / Memtable Count / CPU)\n";
     return oss.str();
   }
 
@@ -46,8 +58,12 @@ struct MultiTenantResourceShares {
     std::ostringstream oss;
     oss << (write_rate_limit_kbs) << ","
         << (read_rate_limit_kbs) << ","
-        << (write_rate_limit_kbs) << ","
-        << (max_write_buffer_number);
+        << (write_buffer_size_kb) << ","
+        << (max_write_buffer_number) << ","
+        << (cpu_share_us) << ","
+        << (memtable_alloc_kbs) << ","
+        << (cache_alloc_kb) << ","
+        << (dominant_share);
     return oss.str();
   }
 };
@@ -56,12 +72,17 @@ struct MultiTenantResourceUsage {
   int64_t io_bytes_written_kb;
   int64_t io_bytes_read_kb;
   int64_t mem_bytes_written_kb;
+  int64_t cpu_time_us = 0; // worker CPU time spent on this tenant's requests
+  int64_t cache_usage_kb = 0; // block cache bytes held (a level, not a rate)
+  int64_t blob_read_kb = 0;   // blob bytes compaction read back, i.e. garbage collection input
+  int64_t blob_write_kb = 0;  // blob bytes written by flushes and garbage collection
 
   std::string ToString() const {
         std::ostringstream oss;
         oss << (io_bytes_written_kb / 1024) << " MB / "
             << (io_bytes_read_kb / 1024) << " MB / "
-             << (mem_bytes_written_kb / 1024) << " MB (IO write / IO read / Mem write)\n";
+             << (mem_bytes_written_kb / 1024) << " MB / "
+             << (cpu_time_us / 1000) << " ms (IO write / IO read / Mem write / CPU)\n";
         return oss.str();
     }
 
@@ -69,18 +90,121 @@ struct MultiTenantResourceUsage {
     std::ostringstream oss;
     oss << (io_bytes_written_kb) << ","
         << (io_bytes_read_kb) << ","
-        << (mem_bytes_written_kb);
+        << (mem_bytes_written_kb) << ","
+        << (cpu_time_us) << ","
+        << (cache_usage_kb) << ","
+        << (blob_read_kb) << ","
+        << (blob_write_kb);
     return oss.str();
   }
 };
 
+// Per-tenant IO counters behind a seqlock: one writer publishes a
+// consistent cut, any number of readers copy it out without locking or
+// allocating. Sized once at construction. Blob counters are sampled on a
+// slower timer and published per tenant, outside the cut.
+class ResourceUsageSnapshot {
+  public:
+    explicit ResourceUsageSnapshot(size_t num_tenants)
+      : io_bytes_written_kb_(num_tenants), io_bytes_read_kb_(num_tenants),
+        blob_read_kb_(num_tenants), blob_write_kb_(num_tenants) {}
+
+    size_t size() const { return io_bytes_written_kb_.size(); }
+
+    // Returns false without publishing if another writer holds the lock;
+    // that writer's snapshot is at least as fresh as ours would be.
+    // `sample(i, &written_kb, &read_kb)` fills tenant i.
+    template <typename Sampler>
+    bool TryPublish(Sampler sample) {
+      if (writing_.test_and_set(std::memory_order_acquire)) {
+        return false;
+      }
+      seq_.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      for (size_t i = 0; i < size(); ++i) {
+        int64_t written_kb = 0, read_kb = 0;
+        sample(i, &written_kb, &read_kb);
+        io_bytes_written_kb_[i].store(written_kb, std::memory_order_relaxed);
+        io_bytes_read_kb_[i].store(read_kb, std::memory_order_relaxed);
+      }
+      seq_.fetch_add(1, std::memory_order_release);
+      writing_.clear(std::memory_order_release);
+      return true;
+    }
+
+    void PublishBlob(size_t i, int64_t read_kb, int64_t write_kb) {
+      blob_read_kb_[i].store(read_kb, std::memory_order_relaxed);
+      blob_write_kb_[i].store(write_kb, std::memory_order_relaxed);
+    }
+
+    // Copies the IO and blob fields of the latest snapshot into the first
+    // min(size(), usage.size()) entries of `usage`.
+    void Read(std::vector<MultiTenantResourceUsage> &usage) const {
+      const size_t n = std::min(size(), usage.size());
+      for (size_t i = 0; i < n; ++i) {
+        usage[i].blob_read_kb = blob_read_kb_[i].load(std::memory_order_relaxed);
+        usage[i].blob_write_kb = blob_write_kb_[i].load(std::memory_order_relaxed);
+      }
+      while (true) {
+        uint64_t begin = seq_.load(std::memory_order_acquire);
+        if (begin & 1) {
+          std::this_thread::yield();
+          continue;
+        }
+        for (size_t i = 0; i < n; ++i) {
+          usage[i].io_bytes_written_kb = io_bytes_written_kb_[i].load(std::memory_order_relaxed);
+          usage[i].io_bytes_read_kb = io_bytes_read_kb_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) == begin) {
+          return;
+        }
+      }
+    }
+
+  private:
+    std::atomic<uint64_t> seq_{0};
+    std::atomic_flag writing_ = ATOMIC_FLAG_INIT;
+    std::vector<std::atomic<int64_t>> io_bytes_written_kb_;
+    std::vector<std::atomic<int64_t>> io_bytes_read_kb_;
+    std::vector<std::atomic<int64_t>> blob_read_kb_;
+    std::vector<std::atomic<int64_t>> blob_write_kb_;
+};
+
+// Memtable options for one column family, applied by
+// DB::UpdateMemtableShares().
+struct MemtableShare {
+  int client_id;
+  int64_t write_buffer_size_bytes;
+  int max_write_buffer_number;
+};
+
+// Operations a tenant ran on a worker inside / outside the NUMA node its
+// memory is bound to, since the last call to DB::GetNumaStats().
+struct TenantNumaStats {
+  int node;
+  int64_t local_ops;
+  int64_t remote_ops;
+};
+
+// DB-wide write-ahead log activity since the last call to DB::GetWalStats().
+struct WalStats {
+  uint64_t bytes_written;
+  uint64_t syncs;
+  double avg_sync_us; // 0 without syncs
+};
+
 inline MultiTenantResourceUsage ComputeResourceUsageRateInInterval(
-  MultiTenantResourceUsage prev, MultiTenantResourceUsage cur, int interval_ms) {
+  MultiTenantResourceUsage prev, MultiTenantResourceUsage cur, double interval_ms) {
   MultiTenantResourceUsage diff;
   double interval_s = interval_ms / 1000.0;
   diff.io_bytes_written_kb = (cur.io_bytes_written_kb - prev.io_bytes_written_kb) / interval_s;
   diff.io_bytes_read_kb = (cur.io_bytes_read_kb - prev.io_bytes_read_kb) / interval_s;
   diff.mem_bytes_written_kb = (cur.mem_bytes_written_kb - prev.mem_bytes_written_kb ) / interval_s;
+  diff.cpu_time_us = (cur.cpu_time_us - prev.cpu_time_us) / interval_s;
+  diff.cache_usage_kb = cur.cache_usage_kb;
+  diff.blob_read_kb = (cur.blob_read_kb - prev.blob_read_kb) / interval_s;
+  diff.blob_write_kb = (cur.blob_write_kb - prev.blob_write_kb) / interval_s;
   return diff;
 }
 
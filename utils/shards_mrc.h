@@ -0,0 +1,228 @@
+//
+//  shards_mrc.h
+//  YCSB-cpp
+//
+//  Online miss-ratio-curve estimation with SHARDS (spatially hashed
+//  sampling of reuse distances, Waldspurger et al., FAST '15).
+//
+
+#ifndef YCSB_C_SHARDS_MRC_H_
+#define YCSB_C_SHARDS_MRC_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils.h"
+
+namespace ycsbc {
+
+namespace utils {
+
+///
+/// Per-tenant LRU miss-ratio curve. A key is sampled iff its hash falls
+/// below sample_rate of the hash space, so every access to a sampled key is
+/// seen and reuse distances among sampled keys, scaled by 1/sample_rate,
+/// estimate distances in the full stream. Unsampled accesses cost one hash.
+/// Distances are kept in log-spaced buckets (8 per doubling) and converted
+/// to bytes with the running mean entry size.
+///
+/// Each tracked key holds a 1 at the logical time of its last access in a
+/// Fenwick tree, so a reuse distance is the count of keys touched since,
+/// found in O(log n). Times are renumbered when the tree fills up.
+///
+class ShardsMrc {
+ public:
+  ShardsMrc(double sample_rate, size_t max_keys)
+      : threshold_(sample_rate >= 1.0 ? UINT64_MAX
+                                      : static_cast<uint64_t>(sample_rate * static_cast<double>(UINT64_MAX))),
+        scale_(1.0 / sample_rate), max_keys_(max_keys), histogram_(kNumBuckets, 0),
+        tree_(std::max<size_t>(2 * max_keys, 2) + 1, 0), time_keys_(tree_.size() - 1) {}
+
+  void Access(const std::string &key, size_t entry_bytes) {
+    uint64_t h = HashKey(key);
+    if (h >= threshold_) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    interval_sampled_++;
+    mean_entry_bytes_ += (entry_bytes - mean_entry_bytes_) / std::min<double>(++sampled_, 1024);
+    if (next_time_ == time_keys_.size()) {
+      Renumber();
+    }
+    auto it = index_.find(h);
+    if (it == index_.end()) {
+      cold_misses_++;
+      index_[h] = next_time_;
+      Touch(h, next_time_++);
+      if (index_.size() > max_keys_) {
+        size_t oldest = FindFirst();
+        TreeAdd(oldest, -1);
+        index_.erase(time_keys_[oldest]);
+      }
+      return;
+    }
+    size_t distance = index_.size() - TreePrefix(it->second);
+    histogram_[Bucket(distance * scale_)]++;
+    TreeAdd(it->second, -1);
+    it->second = next_time_;
+    Touch(h, next_time_++);
+  }
+
+  /// Estimated LRU miss ratio at `capacity_bytes`; 1 if nothing was seen.
+  double MissRatio(uint64_t capacity_bytes) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    double total = cold_misses_;
+    double misses = cold_misses_;
+    double capacity_keys = mean_entry_bytes_ > 0 ? capacity_bytes / mean_entry_bytes_ : 0;
+    for (int b = 0; b < kNumBuckets; ++b) {
+      total += histogram_[b];
+      if (BucketLow(b) >= capacity_keys) {
+        misses += histogram_[b];
+      }
+    }
+    return total > 0 ? misses / total : 1.0;
+  }
+
+  /// Estimated accesses in the full stream since the last Decay().
+  double Accesses() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return interval_sampled_ * scale_;
+  }
+
+  /// Halves the history so the curve follows workload shifts, and starts a
+  /// new access-count interval.
+  void Decay() {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (auto &count : histogram_) {
+      count /= 2;
+    }
+    cold_misses_ /= 2;
+    interval_sampled_ = 0;
+  }
+
+ private:
+  static constexpr int kBucketsPerDoubling = 8;
+  static constexpr int kNumBuckets = 48 * kBucketsPerDoubling;
+
+  static uint64_t HashKey(const std::string &key) {
+    uint64_t h = kFNVOffsetBasis64;
+    for (unsigned char c : key) {
+      h = (h ^ c) * kFNVPrime64;
+    }
+    return FNVHash64(h);
+  }
+
+  static int Bucket(double distance) {
+    if (distance < 1) {
+      return 0;
+    }
+    int b = static_cast<int>(std::log2(distance) * kBucketsPerDoubling) + 1;
+    return std::min(b, kNumBuckets - 1);
+  }
+
+  static double BucketLow(int b) {
+    return b == 0 ? 0 : std::exp2(static_cast<double>(b - 1) / kBucketsPerDoubling);
+  }
+
+  void Touch(uint64_t h, size_t time) {
+    time_keys_[time] = h;
+    TreeAdd(time, 1);
+  }
+
+  // Fenwick tree over times 0..n-1, stored 1-based in tree_.
+  void TreeAdd(size_t time, int delta) {
+    for (size_t i = time + 1; i < tree_.size(); i += i & (~i + 1)) {
+      tree_[i] += delta;
+    }
+  }
+
+  // Number of tracked keys last accessed at or before `time`.
+  size_t TreePrefix(size_t time) const {
+    int64_t sum = 0;
+    for (size_t i = time + 1; i > 0; i -= i & (~i + 1)) {
+      sum += tree_[i];
+    }
+    return static_cast<size_t>(sum);
+  }
+
+  // Time of the least recently accessed tracked key.
+  size_t FindFirst() const {
+    size_t pos = 0;
+    size_t step = 1;
+    while (step * 2 < tree_.size()) {
+      step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+      if (pos + step < tree_.size() && tree_[pos + step] < 1) {
+        pos += step;
+      }
+    }
+    return pos;
+  }
+
+  // Compacts the live keys onto times 0..n-1, keeping their order.
+  void Renumber() {
+    std::vector<uint64_t> live;
+    live.reserve(index_.size());
+    for (size_t t = 0; t < next_time_; ++t) {
+      auto it = index_.find(time_keys_[t]);
+      if (it != index_.end() && it->second == t) {
+        live.push_back(time_keys_[t]);
+      }
+    }
+    std::fill(tree_.begin(), tree_.end(), 0);
+    next_time_ = 0;
+    for (uint64_t h : live) {
+      index_[h] = next_time_;
+      Touch(h, next_time_++);
+    }
+  }
+
+  mutable std::mutex mu_;
+  const uint64_t threshold_;
+  const double scale_;
+  const size_t max_keys_;
+  std::unordered_map<uint64_t, size_t> index_;  // sampled key -> last access time
+  std::vector<double> histogram_;
+  std::vector<int64_t> tree_;
+  std::vector<uint64_t> time_keys_;  // key last accessed at each time
+  size_t next_time_ = 0;
+  double cold_misses_ = 0;
+  double mean_entry_bytes_ = 0;
+  uint64_t sampled_ = 0;
+  uint64_t interval_sampled_ = 0;
+};
+
+///
+/// One ShardsMrc per tenant, shared by every DBWrapper. `row_bytes` is the
+/// stored size of a row's value, which a read caches whatever fields it
+/// projects.
+///
+class TenantMrcs {
+ public:
+  TenantMrcs(size_t num_tenants, double sample_rate, size_t max_keys, size_t row_bytes) : row_bytes_(row_bytes) {
+    for (size_t i = 0; i < num_tenants; ++i) {
+      mrcs_.emplace_back(new ShardsMrc(sample_rate, max_keys));
+    }
+  }
+
+  size_t size() const { return mrcs_.size(); }
+  size_t row_bytes() const { return row_bytes_; }
+  ShardsMrc &operator[](size_t i) { return *mrcs_[i]; }
+
+ private:
+  std::vector<std::unique_ptr<ShardsMrc>> mrcs_;
+  size_t row_bytes_;
+};
+
+} // utils
+
+} // ycsbc
+
+#endif // YCSB_C_SHARDS_MRC_H_
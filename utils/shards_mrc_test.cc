@@ -0,0 +1,147 @@
+//
+//  shards_mrc_test.cc
+//  YCSB-cpp
+//
+//  ShardsMrc against traces with known LRU miss ratios.
+//
+
+#include <cmath>
+#include <iostream>
+#include <list>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/shards_mrc.h"
+#include "utils/test_util.h"
+
+using ycsbc::utils::ShardsMrc;
+
+namespace {
+
+std::string Key(int i) {
+  return "user" + std::to_string(i);
+}
+
+// Exact miss ratio of an LRU cache holding `capacity` entries.
+double LruMissRatio(const std::vector<int> &trace, size_t capacity) {
+  std::list<int> lru;
+  std::unordered_map<int, std::list<int>::iterator> pos;
+  size_t misses = 0;
+  for (int k : trace) {
+    auto it = pos.find(k);
+    if (it != pos.end()) {
+      lru.erase(it->second);
+    } else {
+      misses++;
+      if (lru.size() == capacity) {
+        pos.erase(lru.back());
+        lru.pop_back();
+      }
+    }
+    lru.push_front(k);
+    pos[k] = lru.begin();
+  }
+  return static_cast<double>(misses) / trace.size();
+}
+
+void TestCyclicTrace() {
+  // 20 passes over 100 keys: an LRU cache below 100 entries misses every
+  // access, one of 100 or more only takes the 100 cold misses.
+  ShardsMrc mrc(1.0, 1000);
+  for (int pass = 0; pass < 20; pass++) {
+    for (int k = 0; k < 100; k++) {
+      mrc.Access(Key(k), 1);
+    }
+  }
+  TEST_CHECK(mrc.MissRatio(0) == 1.0);
+  TEST_CHECK(mrc.MissRatio(50) == 1.0);
+  TEST_CHECK(mrc.MissRatio(90) == 1.0);
+  TEST_CHECK(std::abs(mrc.MissRatio(110) - 0.05) < 1e-9);
+  TEST_CHECK(std::abs(mrc.MissRatio(1000) - 0.05) < 1e-9);
+  TEST_CHECK(mrc.Accesses() == 2000);
+}
+
+void TestEntryBytes() {
+  // Same trace with 4 KB entries: capacities scale by the entry size.
+  ShardsMrc mrc(1.0, 1000);
+  for (int pass = 0; pass < 20; pass++) {
+    for (int k = 0; k < 100; k++) {
+      mrc.Access(Key(k), 4096);
+    }
+  }
+  TEST_CHECK(mrc.MissRatio(50 * 4096) == 1.0);
+  TEST_CHECK(std::abs(mrc.MissRatio(110 * 4096) - 0.05) < 1e-9);
+}
+
+void TestMatchesExactLru() {
+  std::mt19937 rng(42);
+  std::vector<int> trace;
+  for (int i = 0; i < 50000; i++) {
+    // Skewed: half the accesses go to the first 50 of 1000 keys.
+    trace.push_back(rng() % 2 ? rng() % 50 : rng() % 1000);
+  }
+  ShardsMrc mrc(1.0, 2000);
+  for (int k : trace) {
+    mrc.Access(Key(k), 1);
+  }
+  // Distances are bucketed 8 per doubling, so the curve is a close
+  // approximation rather than exact.
+  for (size_t capacity : {10, 50, 100, 250, 500, 900, 1200}) {
+    TEST_CHECK(std::abs(mrc.MissRatio(capacity) - LruMissRatio(trace, capacity)) < 0.05);
+  }
+}
+
+void TestRenumberKeepsDistances() {
+  // A tiny tree renumbers every few accesses; a cycle over 3 keys still
+  // needs 3 entries to hit.
+  ShardsMrc mrc(1.0, 4);
+  for (int i = 0; i < 3000; i++) {
+    mrc.Access(Key(i % 3), 1);
+  }
+  TEST_CHECK(mrc.MissRatio(2) == 1.0);
+  TEST_CHECK(std::abs(mrc.MissRatio(3) - 3.0 / 3000) < 1e-9);
+}
+
+void TestMaxKeysForgetsOldKeys() {
+  // Only 10 keys are tracked, so a cycle over 100 never sees a reuse.
+  ShardsMrc mrc(1.0, 10);
+  for (int pass = 0; pass < 5; pass++) {
+    for (int k = 0; k < 100; k++) {
+      mrc.Access(Key(k), 1);
+    }
+  }
+  TEST_CHECK(mrc.MissRatio(1000) == 1.0);
+}
+
+void TestSampling() {
+  // At a 10% sample rate, scaled counts and distances still land close to
+  // the full stream's.
+  ShardsMrc mrc(0.1, 100000);
+  for (int pass = 0; pass < 10; pass++) {
+    for (int k = 0; k < 10000; k++) {
+      mrc.Access(Key(k), 1);
+    }
+  }
+  TEST_CHECK(std::abs(mrc.Accesses() - 100000) < 20000);
+  TEST_CHECK(mrc.MissRatio(5000) == 1.0);
+  TEST_CHECK(std::abs(mrc.MissRatio(15000) - 0.1) < 1e-9);
+
+  mrc.Decay();
+  TEST_CHECK(mrc.Accesses() == 0);
+  TEST_CHECK(std::abs(mrc.MissRatio(15000) - 0.1) < 0.01);
+}
+
+}  // namespace
+
+int main() {
+  TestCyclicTrace();
+  TestEntryBytes();
+  TestMatchesExactLru();
+  TestRenumberKeepsDistances();
+  TestMaxKeysForgetsOldKeys();
+  TestSampling();
+  std::cout << "shards_mrc_test: OK" << std::endl;
+  return 0;
+}
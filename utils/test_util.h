@@ -0,0 +1,39 @@
+//
+//  test_util.h
+//  YCSB-cpp
+//
+//  Checks for the standalone *_test.cc programs run by `make check` and
+//  ctest. Unlike assert they stay active in NDEBUG builds.
+//
+
+#ifndef YCSB_C_TEST_UTIL_H_
+#define YCSB_C_TEST_UTIL_H_
+
+#include <cstdlib>
+#include <iostream>
+
+#define TEST_CHECK(cond)                                                    \
+  do {                                                                      \
+    if (!(cond)) {                                                          \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond  \
+                << std::endl;                                               \
+      std::exit(1);                                                         \
+    }                                                                       \
+  } while (0)
+
+#define TEST_CHECK_THROWS(stmt, exception_type)                             \
+  do {                                                                      \
+    bool thrown = false;                                                    \
+    try {                                                                   \
+      stmt;                                                                 \
+    } catch (const exception_type &) {                                      \
+      thrown = true;                                                        \
+    }                                                                       \
+    if (!thrown) {                                                          \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": expected " #stmt       \
+                << " to throw " #exception_type << std::endl;               \
+      std::exit(1);                                                         \
+    }                                                                       \
+  } while (0)
+
+#endif // YCSB_C_TEST_UTIL_H_